@@ -2,446 +2,5040 @@
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "arithmetic.h"
 
+// Assembly kernels for x86-64 are only written for 64-bit blocks
+#if BN_BLOCK_BITS == 64 && defined(__x86_64__)
+#define BN_X86_64_KERNELS 1
+#include <cpuid.h>
+#else
+#define BN_X86_64_KERNELS 0
+#endif
+
+// Unsigned integer type that can hold the product of two blocks
+#if BN_BLOCK_BITS == 64
+typedef unsigned __int128 bn_dblock_t;
+#else
+typedef uint64_t bn_dblock_t;
+#endif
+
+// Amount of hex chars needed for a single block
+#define BN_BLOCK_HEX_CHARS (BN_BLOCK_BITS / 4)
+
+// Returns the amount of leading 0-bits of `block`, which must not be 0.
+static inline int bn_block_clz(bn_block_t block) {
+#if BN_BLOCK_BITS == 64
+    return __builtin_clzll(block);
+#else
+    return __builtin_clz(block);
+#endif
+}
+
+// Returns the amount of trailing 0-bits of `block`, which must not be 0.
+static inline int bn_block_ctz(bn_block_t block) {
+#if BN_BLOCK_BITS == 64
+    return __builtin_ctzll(block);
+#else
+    return __builtin_ctz(block);
+#endif
+}
+
+static void *bn_system_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void *bn_system_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    (void)old_size;
+    return realloc(ptr, new_size);
+}
+
+static void bn_system_free(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+static const bn_Allocator bn_system_allocator = {
+    bn_system_alloc,
+    bn_system_realloc,
+    bn_system_free,
+    NULL,
+};
+
+// Allocator set by `bn_set_allocator`
+static const bn_Allocator *bn_global_allocator = &bn_system_allocator;
+
+// Allocator of the innermost arena scope of the current thread, if any
+static _Thread_local const bn_Allocator *bn_thread_allocator = NULL;
+
+// Returns the allocator for memory that is allocated now
+static inline const bn_Allocator *bn_current_allocator() {
+    return bn_thread_allocator ? bn_thread_allocator : bn_global_allocator;
+}
+
+#if BN_STATS
+// Counters of one thread. Only the thread itself writes them, with relaxed
+// atomic loads and stores (plain moves on common targets), so that
+// `bn_stats_snapshot` may read them at any time.
+typedef struct bn_ThreadStats {
+    bn_Stats stats;
+    struct bn_ThreadStats *next;
+    struct bn_ThreadStats *prev;
+} bn_ThreadStats;
+
+static pthread_mutex_t bn_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+// All threads that have counted anything and haven't exited yet
+static bn_ThreadStats *bn_stats_threads = NULL;
+// Sum of the counters of all exited threads
+static bn_Stats bn_stats_exited;
+// Sum of all counters at the last `bn_stats_reset`
+static bn_Stats bn_stats_baseline;
+
+static pthread_once_t bn_stats_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t bn_stats_key;
+static _Thread_local bn_ThreadStats *bn_thread_stats = NULL;
+
+#define BN_STATS_WORDS (sizeof(bn_Stats) / sizeof(uint64_t))
+
+// Adds all counters of `stats` to `sum`. `bn_stats_mutex` must be held.
+static void bn_stats_sum(bn_Stats *sum, bn_Stats *stats) {
+    uint64_t *sum_words = (uint64_t *)sum;
+    uint64_t *words = (uint64_t *)stats;
+    for (size_t i = 0; i < BN_STATS_WORDS; i++) {
+        sum_words[i] += __atomic_load_n(&words[i], __ATOMIC_RELAXED);
+    }
+}
+
+// Keeps the counters of an exiting thread in `bn_stats_exited`
+static void bn_stats_thread_exit(void *ptr) {
+    bn_ThreadStats *thread = ptr;
+    pthread_mutex_lock(&bn_stats_mutex);
+    bn_stats_sum(&bn_stats_exited, &thread->stats);
+    if (thread->prev) {
+        thread->prev->next = thread->next;
+    } else {
+        bn_stats_threads = thread->next;
+    }
+    if (thread->next) {
+        thread->next->prev = thread->prev;
+    }
+    pthread_mutex_unlock(&bn_stats_mutex);
+    bn_thread_stats = NULL;
+    // Not allocated with an allocator of the library, whose calls are counted
+    free(thread);
+}
+
+static void bn_stats_create_key() {
+    pthread_key_create(&bn_stats_key, bn_stats_thread_exit);
+}
+
+// Returns the counters of the current thread, creating them on first use
+static bn_ThreadStats *bn_stats_thread() {
+    if (!bn_thread_stats) {
+        pthread_once(&bn_stats_key_once, bn_stats_create_key);
+        bn_ThreadStats *thread = calloc(1, sizeof(bn_ThreadStats));
+        pthread_mutex_lock(&bn_stats_mutex);
+        thread->next = bn_stats_threads;
+        if (bn_stats_threads) {
+            bn_stats_threads->prev = thread;
+        }
+        bn_stats_threads = thread;
+        pthread_mutex_unlock(&bn_stats_mutex);
+        pthread_setspecific(bn_stats_key, thread);
+        bn_thread_stats = thread;
+    }
+    return bn_thread_stats;
+}
+
+static inline void bn_stats_count(uint64_t *counter, uint64_t value) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+// Returns the histogram class of `size`, see `bn_OpStats.sizes`
+static inline int bn_stats_size_class(size_t size) {
+    if (!size) {
+        return 0;
+    }
+    int size_class = 64 - __builtin_clzll(size);
+    return size_class < BN_STATS_SIZE_CLASSES ? size_class : BN_STATS_SIZE_CLASSES - 1;
+}
+
+static inline uint64_t bn_stats_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Call of an operation whose time is added when the scope ends
+typedef struct bn_StatsScope {
+    bn_OpStats *op;
+    uint64_t start;
+} bn_StatsScope;
+
+static inline bn_StatsScope bn_stats_scope_begin(bn_StatsOp op, size_t size) {
+    bn_OpStats *op_stats = &bn_stats_thread()->stats.ops[op];
+    bn_stats_count(&op_stats->calls, 1);
+    bn_stats_count(&op_stats->sizes[bn_stats_size_class(size)], 1);
+    bn_StatsScope scope = { op_stats, bn_stats_now() };
+    return scope;
+}
+
+static inline void bn_stats_scope_end(bn_StatsScope *scope) {
+    bn_stats_count(&scope->op->nanoseconds, bn_stats_now() - scope->start);
+}
+
+static inline void bn_stats_allocation(uint64_t *counter, size_t size) {
+    bn_Stats *stats = &bn_stats_thread()->stats;
+    bn_stats_count(counter == NULL ? &stats->allocations : &stats->reallocations, 1);
+    bn_stats_count(&stats->allocated_bytes, size);
+    bn_stats_count(&stats->allocation_sizes[bn_stats_size_class(size)], 1);
+}
+
+// Counts the call of the operation `op` with operands of `size` blocks and the
+// time until the end of the enclosing block, including all return paths
+#define BN_STATS_SCOPE(op, size) \
+    __attribute__((cleanup(bn_stats_scope_end))) bn_StatsScope bn_stats_scope = bn_stats_scope_begin(op, size)
+#define BN_STATS_ALLOCATION(size) bn_stats_allocation(NULL, size)
+#define BN_STATS_REALLOCATION(size) bn_stats_allocation(&bn_stats_thread()->stats.reallocations, size)
+#define BN_STATS_DEALLOCATION() bn_stats_count(&bn_stats_thread()->stats.deallocations, 1)
+#else
+#define BN_STATS_SCOPE(op, size) ((void)0)
+#define BN_STATS_ALLOCATION(size) ((void)0)
+#define BN_STATS_REALLOCATION(size) ((void)0)
+#define BN_STATS_DEALLOCATION() ((void)0)
+#endif
+
+void bn_stats_snapshot(bn_Stats *stats) {
+    memset(stats, 0, sizeof(bn_Stats));
+#if BN_STATS
+    pthread_mutex_lock(&bn_stats_mutex);
+    bn_stats_sum(stats, &bn_stats_exited);
+    for (bn_ThreadStats *thread = bn_stats_threads; thread; thread = thread->next) {
+        bn_stats_sum(stats, &thread->stats);
+    }
+    uint64_t *words = (uint64_t *)stats;
+    uint64_t *baseline = (uint64_t *)&bn_stats_baseline;
+    for (size_t i = 0; i < BN_STATS_WORDS; i++) {
+        words[i] -= baseline[i];
+    }
+    pthread_mutex_unlock(&bn_stats_mutex);
+#endif
+}
+
+void bn_stats_reset() {
+#if BN_STATS
+    // Other threads may be counting right now, so their counters stay and the
+    // snapshots subtract the current sums instead
+    pthread_mutex_lock(&bn_stats_mutex);
+    memset(&bn_stats_baseline, 0, sizeof(bn_Stats));
+    bn_stats_sum(&bn_stats_baseline, &bn_stats_exited);
+    for (bn_ThreadStats *thread = bn_stats_threads; thread; thread = thread->next) {
+        bn_stats_sum(&bn_stats_baseline, &thread->stats);
+    }
+    pthread_mutex_unlock(&bn_stats_mutex);
+#endif
+}
+
+const char *bn_stats_op_name(bn_StatsOp op) {
+    static const char *names[BN_STATS_OPS] = {
+        "add",
+        "subtract",
+        "multiply",
+        "square",
+        "divide",
+        "power_mod",
+        "power_mod_ctx",
+        "gcd",
+        "to_hex",
+        "to_decimal",
+    };
+    return op < BN_STATS_OPS ? names[op] : NULL;
+}
+
+// All memory of the library is allocated, reallocated and freed through these,
+// so that `bn_stats_snapshot` can count it
+static inline void *bn_allocate(const bn_Allocator *allocator, size_t size) {
+    BN_STATS_ALLOCATION(size);
+    return allocator->allocate(allocator->ctx, size);
+}
+
+static inline void *bn_reallocate(const bn_Allocator *allocator, void *ptr, size_t old_size, size_t new_size) {
+    BN_STATS_REALLOCATION(new_size);
+    return allocator->reallocate(allocator->ctx, ptr, old_size, new_size);
+}
+
+static inline void bn_deallocate(const bn_Allocator *allocator, void *ptr, size_t size) {
+    BN_STATS_DEALLOCATION();
+    allocator->deallocate(allocator->ctx, ptr, size);
+}
+
+// Allocates temporary memory with the current allocator. It has to be freed
+// with `bn_scratch_free` in the same function.
+static inline void *bn_scratch_alloc(size_t size) {
+    return bn_allocate(bn_current_allocator(), size);
+}
+
+static inline void bn_scratch_free(void *ptr, size_t size) {
+    if (ptr) {
+        bn_deallocate(bn_current_allocator(), ptr, size);
+    }
+}
+
+void bn_set_allocator(const bn_Allocator *allocator) {
+    bn_global_allocator = allocator ? allocator : &bn_system_allocator;
+}
+
+// The pool serves sizes up to `BN_POOL_MIN_SIZE << (BN_POOL_CLASSES - 1)`
+// bytes from free lists of power-of-two size classes. Larger sizes go to
+// malloc directly. At most `BN_POOL_MAX_CACHED` pieces of memory are kept per
+// class and thread.
+#define BN_POOL_MIN_SIZE 32
+#define BN_POOL_CLASSES 12
+#define BN_POOL_MAX_CACHED 64
+
+typedef struct bn_PoolEntry {
+    struct bn_PoolEntry *next;
+} bn_PoolEntry;
+
+typedef struct bn_Pool {
+    bn_PoolEntry *free_lists[BN_POOL_CLASSES];
+    size_t num_cached[BN_POOL_CLASSES];
+} bn_Pool;
+
+static _Thread_local bn_Pool bn_thread_pool;
+
+// Returns the size class of `size`, which is `BN_POOL_CLASSES` if `size` is
+// too large for the pool.
+static size_t bn_pool_class(size_t size) {
+    if (size <= BN_POOL_MIN_SIZE) {
+        return 0;
+    }
+    size_t class = 0;
+    for (size_t class_size = BN_POOL_MIN_SIZE; class_size < size && class < BN_POOL_CLASSES; class_size *= 2) {
+        class++;
+    }
+    return class;
+}
+
+static void *bn_pool_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    size_t class = bn_pool_class(size);
+    if (class == BN_POOL_CLASSES) {
+        return malloc(size);
+    }
+    bn_Pool *pool = &bn_thread_pool;
+    bn_PoolEntry *entry = pool->free_lists[class];
+    if (entry) {
+        pool->free_lists[class] = entry->next;
+        pool->num_cached[class]--;
+        return entry;
+    }
+    return malloc((size_t)BN_POOL_MIN_SIZE << class);
+}
+
+static void bn_pool_free(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    size_t class = bn_pool_class(size);
+    bn_Pool *pool = &bn_thread_pool;
+    if (class == BN_POOL_CLASSES || pool->num_cached[class] == BN_POOL_MAX_CACHED) {
+        free(ptr);
+        return;
+    }
+    bn_PoolEntry *entry = ptr;
+    entry->next = pool->free_lists[class];
+    pool->free_lists[class] = entry;
+    pool->num_cached[class]++;
+}
+
+static void *bn_pool_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    size_t old_class = bn_pool_class(old_size);
+    size_t new_class = bn_pool_class(new_size);
+    if (old_class == new_class) {
+        return old_class == BN_POOL_CLASSES ? realloc(ptr, new_size) : ptr;
+    }
+    void *result = bn_pool_alloc(ctx, new_size);
+    memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+    bn_pool_free(ctx, ptr, old_size);
+    return result;
+}
+
+static const bn_Allocator bn_pool = {
+    bn_pool_alloc,
+    bn_pool_realloc,
+    bn_pool_free,
+    NULL,
+};
+
+const bn_Allocator *bn_pool_allocator() {
+    return &bn_pool;
+}
+
+void bn_pool_release() {
+    bn_Pool *pool = &bn_thread_pool;
+    for (size_t class = 0; class < BN_POOL_CLASSES; class++) {
+        while (pool->free_lists[class]) {
+            bn_PoolEntry *entry = pool->free_lists[class];
+            pool->free_lists[class] = entry->next;
+            free(entry);
+        }
+        pool->num_cached[class] = 0;
+    }
+}
+
+// Arenas get their memory from malloc in chunks of at least this many bytes
+#define BN_ARENA_CHUNK_SIZE 65536
+// Alignment of all memory handed out by arenas
+#define BN_ARENA_ALIGN 16
+
+typedef struct bn_ArenaChunk {
+    struct bn_ArenaChunk *next;
+    // Usable bytes after the header
+    size_t size;
+    // Bytes handed out, always a multiple of `BN_ARENA_ALIGN`
+    size_t used;
+} bn_ArenaChunk;
+
+// Size of the chunk header, rounded up so that the memory after it is aligned
+#define BN_ARENA_HEADER_SIZE \
+    ((sizeof(bn_ArenaChunk) + BN_ARENA_ALIGN - 1) / BN_ARENA_ALIGN * BN_ARENA_ALIGN)
+
+struct bn_Arena {
+    // Allocator that hands out memory of this arena, with `ctx` pointing to
+    // the arena itself
+    bn_Allocator allocator;
+    // Chunk that memory is currently handed out from, followed by the chunks
+    // that are full
+    bn_ArenaChunk *chunks;
+    // Allocator to restore in `bn_arena_end`
+    const bn_Allocator *previous;
+};
+
+static inline size_t bn_arena_round(size_t size) {
+    return (size + BN_ARENA_ALIGN - 1) / BN_ARENA_ALIGN * BN_ARENA_ALIGN;
+}
+
+static inline unsigned char *bn_arena_chunk_data(bn_ArenaChunk *chunk) {
+    return (unsigned char *)chunk + BN_ARENA_HEADER_SIZE;
+}
+
+// Returns whether `ptr` with `size` bytes is the most recent allocation of
+// the current chunk, which can be grown or given back in place.
+static inline int bn_arena_is_last(bn_ArenaChunk *chunk, void *ptr, size_t size) {
+    return chunk && (unsigned char *)ptr + bn_arena_round(size) == bn_arena_chunk_data(chunk) + chunk->used;
+}
+
+static void *bn_arena_alloc(void *ctx, size_t size) {
+    bn_Arena *arena = ctx;
+    size = bn_arena_round(size);
+    bn_ArenaChunk *chunk = arena->chunks;
+    if (!chunk || chunk->size - chunk->used < size) {
+        size_t chunk_size = size > BN_ARENA_CHUNK_SIZE ? size : BN_ARENA_CHUNK_SIZE;
+        chunk = malloc(BN_ARENA_HEADER_SIZE + chunk_size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = arena->chunks;
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        arena->chunks = chunk;
+    }
+    void *ptr = bn_arena_chunk_data(chunk) + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+static void *bn_arena_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    bn_Arena *arena = ctx;
+    bn_ArenaChunk *chunk = arena->chunks;
+    if (bn_arena_is_last(chunk, ptr, old_size)) {
+        size_t start = (unsigned char *)ptr - bn_arena_chunk_data(chunk);
+        if (chunk->size - start >= bn_arena_round(new_size)) {
+            chunk->used = start + bn_arena_round(new_size);
+            return ptr;
+        }
+    }
+    void *result = bn_arena_alloc(ctx, new_size);
+    if (result) {
+        memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+    }
+    return result;
+}
+
+// Memory is only given back if it was the most recent allocation, which is
+// common for temporaries. Everything else is released by `bn_arena_reset`.
+static void bn_arena_free(void *ctx, void *ptr, size_t size) {
+    bn_Arena *arena = ctx;
+    bn_ArenaChunk *chunk = arena->chunks;
+    if (bn_arena_is_last(chunk, ptr, size)) {
+        chunk->used -= bn_arena_round(size);
+    }
+}
+
+bn_Arena *bn_arena_new() {
+    bn_Arena *arena = malloc(sizeof(bn_Arena));
+    if (!arena) {
+        return NULL;
+    }
+    arena->allocator.allocate = bn_arena_alloc;
+    arena->allocator.reallocate = bn_arena_realloc;
+    arena->allocator.deallocate = bn_arena_free;
+    arena->allocator.ctx = arena;
+    arena->chunks = NULL;
+    arena->previous = NULL;
+    return arena;
+}
+
+void bn_arena_begin(bn_Arena *arena) {
+    arena->previous = bn_thread_allocator;
+    bn_thread_allocator = &arena->allocator;
+}
+
+void bn_arena_end(bn_Arena *arena) {
+    bn_thread_allocator = arena->previous;
+    arena->previous = NULL;
+}
+
+void bn_arena_reset(bn_Arena *arena) {
+    bn_ArenaChunk *largest = NULL;
+    bn_ArenaChunk *chunk = arena->chunks;
+    while (chunk) {
+        bn_ArenaChunk *next = chunk->next;
+        if (!largest || chunk->size > largest->size) {
+            free(largest);
+            largest = chunk;
+        } else {
+            free(chunk);
+        }
+        chunk = next;
+    }
+    if (largest) {
+        largest->next = NULL;
+        largest->used = 0;
+    }
+    arena->chunks = largest;
+}
+
+void bn_arena_destroy(bn_Arena **arena) {
+    bn_ArenaChunk *chunk = (*arena)->chunks;
+    while (chunk) {
+        bn_ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(*arena);
+    *arena = NULL;
+}
+
+// Work is split into tasks, which are pushed to the queue of the thread that
+// creates them. Idle threads take tasks from their own queue first (newest
+// first) and otherwise steal the oldest task of another queue. Threads that
+// wait for their tasks to finish run queued tasks in the meantime, so nested
+// tasks can't deadlock. Queue 0 is shared by all threads that are not
+// workers.
+#define BN_MAX_THREADS 256
+#define BN_QUEUE_CAPACITY 64
+
+typedef struct bn_TaskGroup {
+    atomic_size_t pending;
+} bn_TaskGroup;
+
+typedef struct bn_Task {
+    void (*run)(struct bn_Task *task);
+    bn_TaskGroup *group;
+} bn_Task;
+
+typedef struct bn_TaskQueue {
+    pthread_mutex_t lock;
+    // Ring buffer of the tasks from `oldest` to `oldest + len`
+    bn_Task *tasks[BN_QUEUE_CAPACITY];
+    size_t oldest;
+    size_t len;
+} bn_TaskQueue;
+
+typedef struct bn_Workers {
+    // Queue 0 and one queue per worker
+    bn_TaskQueue queues[BN_MAX_THREADS];
+    pthread_t threads[BN_MAX_THREADS];
+    // Amount of queued tasks over all queues. Sleeping workers are woken up
+    // through `wake` when it becomes non-zero.
+    atomic_size_t queued;
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t wake;
+    int stop;
+} bn_Workers;
+
+static bn_Workers bn_workers = {
+    .queues = { [0] = { .lock = PTHREAD_MUTEX_INITIALIZER } },
+    .sleep_lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+};
+
+// Amount of running workers, which is the thread count of `bn_set_threads`
+// minus one. Only the work of large operands is split into tasks when it is
+// not 0.
+static size_t bn_worker_count = 0;
+
+// Operand length (in blocks) from which on multiplications are split into
+// tasks. See `bn_set_parallel_threshold`.
+static size_t bn_parallel_threshold = 2048;
+
+// Queue of the current thread
+static _Thread_local bn_TaskQueue *bn_own_queue = &bn_workers.queues[0];
+
+// Returns whether work on operands of `len` blocks should be split into tasks
+static inline int bn_in_parallel(size_t len) {
+    return bn_worker_count && len >= bn_parallel_threshold;
+}
+
+// Takes a task from the own queue or steals one from another queue. Returns a
+// null pointer if all queues are empty.
+static bn_Task *bn_task_take() {
+    if (!atomic_load(&bn_workers.queued)) {
+        return NULL;
+    }
+
+    bn_TaskQueue *queue = bn_own_queue;
+    pthread_mutex_lock(&queue->lock);
+    bn_Task *task = NULL;
+    if (queue->len) {
+        queue->len--;
+        task = queue->tasks[(queue->oldest + queue->len) % BN_QUEUE_CAPACITY];
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    size_t first = queue - bn_workers.queues;
+    for (size_t i = 1; !task && i <= bn_worker_count; i++) {
+        bn_TaskQueue *victim = &bn_workers.queues[(first + i) % (bn_worker_count + 1)];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->len) {
+            task = victim->tasks[victim->oldest];
+            victim->oldest = (victim->oldest + 1) % BN_QUEUE_CAPACITY;
+            victim->len--;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+
+    if (task) {
+        atomic_fetch_sub(&bn_workers.queued, 1);
+    }
+    return task;
+}
+
+static void bn_task_run(bn_Task *task) {
+    bn_TaskGroup *group = task->group;
+    task->run(task);
+    atomic_fetch_sub(&group->pending, 1);
+}
+
+// Adds `task` to `group` and queues it. The task runs right away if the queue
+// is full.
+static void bn_task_spawn(bn_TaskGroup *group, bn_Task *task) {
+    task->group = group;
+    atomic_fetch_add(&group->pending, 1);
+
+    bn_TaskQueue *queue = bn_own_queue;
+    pthread_mutex_lock(&queue->lock);
+    int queued = queue->len < BN_QUEUE_CAPACITY;
+    if (queued) {
+        queue->tasks[(queue->oldest + queue->len) % BN_QUEUE_CAPACITY] = task;
+        queue->len++;
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    if (!queued) {
+        bn_task_run(task);
+        return;
+    }
+    atomic_fetch_add(&bn_workers.queued, 1);
+    pthread_mutex_lock(&bn_workers.sleep_lock);
+    pthread_cond_signal(&bn_workers.wake);
+    pthread_mutex_unlock(&bn_workers.sleep_lock);
+}
+
+// Waits until all tasks of `group` have finished, running queued tasks in
+// the meantime.
+static void bn_task_wait(bn_TaskGroup *group) {
+    while (atomic_load(&group->pending)) {
+        bn_Task *task = bn_task_take();
+        if (task) {
+            bn_task_run(task);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+static void *bn_worker_main(void *arg) {
+    bn_own_queue = arg;
+    for (;;) {
+        bn_Task *task = bn_task_take();
+        if (task) {
+            bn_task_run(task);
+            continue;
+        }
+
+        pthread_mutex_lock(&bn_workers.sleep_lock);
+        while (!bn_workers.stop && !atomic_load(&bn_workers.queued)) {
+            pthread_cond_wait(&bn_workers.wake, &bn_workers.sleep_lock);
+        }
+        int stop = bn_workers.stop;
+        pthread_mutex_unlock(&bn_workers.sleep_lock);
+        if (stop) {
+            break;
+        }
+    }
+    bn_pool_release();
+    return NULL;
+}
+
+size_t bn_set_threads(size_t threads) {
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+    if (threads > BN_MAX_THREADS) {
+        threads = BN_MAX_THREADS;
+    }
+
+    // Stop the current workers. No tasks are queued when no operation is
+    // running.
+    pthread_mutex_lock(&bn_workers.sleep_lock);
+    bn_workers.stop = 1;
+    pthread_cond_broadcast(&bn_workers.wake);
+    pthread_mutex_unlock(&bn_workers.sleep_lock);
+    for (size_t i = 1; i <= bn_worker_count; i++) {
+        pthread_join(bn_workers.threads[i], NULL);
+        pthread_mutex_destroy(&bn_workers.queues[i].lock);
+    }
+    bn_workers.stop = 0;
+    bn_worker_count = 0;
+
+    while (bn_worker_count + 1 < threads) {
+        bn_TaskQueue *queue = &bn_workers.queues[bn_worker_count + 1];
+        pthread_mutex_init(&queue->lock, NULL);
+        queue->oldest = 0;
+        queue->len = 0;
+        if (pthread_create(&bn_workers.threads[bn_worker_count + 1], NULL, bn_worker_main, queue)) {
+            pthread_mutex_destroy(&queue->lock);
+            break;
+        }
+        bn_worker_count++;
+    }
+    return bn_worker_count + 1;
+}
+
+void bn_set_parallel_threshold(size_t len) {
+    // Tasks for tiny operands would cost more than they save
+    bn_parallel_threshold = len < 64 ? 64 : len;
+}
+
 // Returns the block with the `offset` from the start of the BigNum data. It
 // accesses memory that doesn't belong to the given BigNum when offset is out
 // of bounds.
-static inline uint32_t bn_get_block_unchecked(BigNum *n, size_t offset) {
-    return *((uint32_t *)n->data + offset);
+static inline bn_block_t bn_get_block_unchecked(BigNum *n, size_t offset) {
+    return *((bn_block_t *)n->data + offset);
+}
+
+// Returns whether `n` is 0.
+static inline int bn_is_zero(BigNum *n) {
+    return n->len == 1 && bn_get_block_unchecked(n, 0) == 0;
+}
+
+// Returns whether `n` is 1.
+static inline int bn_is_one(BigNum *n) {
+    return n->len == 1 && bn_get_block_unchecked(n, 0) == 1;
+}
+
+// Returns the block with the `offset` from the start of the BigNum data. It
+// returns 0 if the offset is out of bounds.
+static bn_block_t bn_get_block(BigNum *n, size_t offset) {
+    if (offset < n->len) {
+        return bn_get_block_unchecked(n, offset);
+    } else {
+        return 0;
+    }
+}
+
+// Writes the given `value` to the block with the given `offset`. This function
+// asserts that `offset` is in bounds.
+static inline void bn_write_block(BigNum *n, size_t offset, bn_block_t value) {
+    assert(offset < n->len);
+    *((bn_block_t *)n->data + offset) = value;
+}
+
+// Trims all leading 0-blocks of `n`. This will trim `n` at most to len 1.
+// The capacity of `n` is not changed, so the trimmed blocks can be reused when
+// `n` grows again.
+static void bn_trim(BigNum *n) {
+    size_t trimmed_len = n->len;
+    bn_block_t *block_ptr = (bn_block_t *)n->data + n->len - 1;
+    while (trimmed_len > 1 && *block_ptr == 0) {
+        trimmed_len--;
+        block_ptr--;
+    }
+    n->len = trimmed_len;
+}
+
+// Returns whether the blocks of `n` are stored inside of its struct
+static inline int bn_is_inline(BigNum *n) {
+    return n->data == n->inline_blocks;
+}
+
+// Returns a pointer to a BigNum with the given `len`, allocated with the
+// current allocator. The blocks are stored inline if they fit.
+static BigNum *bn_with_len(size_t len) {
+    const bn_Allocator *allocator = bn_current_allocator();
+    BigNum *bn = bn_allocate(allocator, sizeof(BigNum));
+    bn->len = len;
+    bn->allocator = allocator;
+    if (len <= BN_INLINE_BLOCKS) {
+        bn->capacity = BN_INLINE_BLOCKS;
+        bn->data = bn->inline_blocks;
+        memset(bn->inline_blocks, 0, sizeof(bn->inline_blocks));
+    } else {
+        bn->capacity = len;
+        bn->data = bn_allocate(allocator, len * sizeof(bn_block_t));
+        memset(bn->data, 0, len * sizeof(bn_block_t));
+    }
+    return bn;
+}
+
+// Sets the capacity of `n` to exactly `capacity` blocks, but at least
+// BN_INLINE_BLOCKS, in which case the blocks are moved inline. `capacity` must
+// not be less than `n->len`.
+static void bn_set_capacity(BigNum *n, size_t capacity) {
+    if (capacity < BN_INLINE_BLOCKS) {
+        capacity = BN_INLINE_BLOCKS;
+    }
+    if (capacity == n->capacity) {
+        return;
+    }
+    const bn_Allocator *allocator = n->allocator;
+    if (capacity == BN_INLINE_BLOCKS) {
+        memcpy(n->inline_blocks, n->data, n->len * sizeof(bn_block_t));
+        bn_deallocate(allocator, n->data, n->capacity * sizeof(bn_block_t));
+        n->data = n->inline_blocks;
+    } else if (bn_is_inline(n)) {
+        n->data = bn_allocate(allocator, capacity * sizeof(bn_block_t));
+        memcpy(n->data, n->inline_blocks, n->len * sizeof(bn_block_t));
+    } else {
+        n->data = bn_reallocate(
+            allocator,
+            n->data,
+            n->capacity * sizeof(bn_block_t),
+            capacity * sizeof(bn_block_t)
+        );
+    }
+    n->capacity = capacity;
+}
+
+// Resizes `n` to hold `len` blocks. Blocks that are added are set to 0,
+// blocks that are removed are lost. If the capacity of `n` is too small, it
+// is at least doubled, so repeatedly growing `n` only reallocates
+// logarithmically often.
+static void bn_resize(BigNum *n, size_t len) {
+    if (len > n->capacity) {
+        size_t capacity = 2 * n->capacity;
+        bn_set_capacity(n, capacity > len ? capacity : len);
+    }
+    if (len > n->len) {
+        memset((bn_block_t *)n->data + n->len, 0, (len - n->len) * sizeof(bn_block_t));
+    }
+    n->len = len;
+}
+
+// Moves the value of `*src` into `dst`, freeing the previous data of `dst`.
+// `*src` is destroyed afterwards. This is used by the `_into` functions to
+// hand over results that could not be computed in `dst` directly.
+static void bn_move(BigNum *dst, BigNum **src) {
+    if (bn_is_inline(*src) || (*src)->allocator != dst->allocator) {
+        // The blocks have to be copied, since they can't be handed over to
+        // the allocator of `dst`
+        if (dst->capacity < (*src)->len) {
+            dst->len = 0;
+            bn_set_capacity(dst, (*src)->len);
+        }
+        memcpy(dst->data, (*src)->data, (*src)->len * sizeof(bn_block_t));
+        dst->len = (*src)->len;
+        bn_destroy(src);
+        return;
+    }
+    if (!bn_is_inline(dst)) {
+        bn_deallocate(dst->allocator, dst->data, dst->capacity * sizeof(bn_block_t));
+    }
+    dst->data = (*src)->data;
+    dst->len = (*src)->len;
+    dst->capacity = (*src)->capacity;
+    bn_deallocate(dst->allocator, *src, sizeof(BigNum));
+    *src = NULL;
+}
+
+void bn_reserve(BigNum *n, size_t capacity) {
+    if (capacity > n->capacity) {
+        bn_set_capacity(n, capacity);
+    }
+}
+
+void bn_shrink_to_fit(BigNum *n) {
+    bn_set_capacity(n, n->len);
+}
+
+void bn_destroy(BigNum **n) {
+    const bn_Allocator *allocator = (*n)->allocator;
+    if (!bn_is_inline(*n)) {
+        bn_deallocate(allocator, (*n)->data, (*n)->capacity * sizeof(bn_block_t));
+    }
+    bn_deallocate(allocator, *n, sizeof(BigNum));
+    *n = NULL;
+}
+
+BigNum *bn_copy(BigNum *orig) {
+    if (!orig) {
+        return NULL;
+    }
+    BigNum *copy = bn_with_len(orig->len);
+    memcpy(copy->data, orig->data, copy->len * sizeof(bn_block_t));
+    return copy;
+}
+
+BigNum *bn_zero() {
+    return bn_with_len(1);
+}
+
+BigNum *bn_one() {
+    BigNum *bn = bn_with_len(1);
+    bn_write_block(bn, 0, 1);
+    return bn;
+}
+
+BigNum *bn_from_uint32_t(uint32_t n) {
+    BigNum *bn = bn_with_len(1);
+    bn_write_block(bn, 0, n);
+    return bn;
+}
+
+// Value + 1 of every hex char, BN_HEX_SPACE for spaces and 0 for all other
+// chars
+#define BN_HEX_SPACE 17
+static const unsigned char bn_hex_values[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6,
+    ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10, ['a'] = 11, ['b'] = 12,
+    ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16, ['A'] = 11, ['B'] = 12,
+    ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+    [' '] = BN_HEX_SPACE,
+};
+
+// Two hex chars for every byte
+static const char bn_hex_pairs[513] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+BigNum *bn_from_hex(const char *str) {
+    if (!str) {
+        return NULL;
+    }
+
+    size_t num_chars = 0;
+    size_t num_hex_chars = 0;
+    for (const unsigned char *c = (const unsigned char *)str; *c; c++) {
+        unsigned char value = bn_hex_values[*c];
+        if (!value) {
+            return NULL;
+        }
+        num_hex_chars += value != BN_HEX_SPACE;
+        num_chars++;
+    }
+
+    if (num_hex_chars == 0) {
+        return NULL;
+    }
+
+    size_t len = (num_hex_chars + BN_BLOCK_HEX_CHARS - 1) / BN_BLOCK_HEX_CHARS;
+    BigNum *result = bn_with_len(len);
+
+    bn_block_t block = 0;
+    int hex_chars_read = 0;
+    size_t offset = 0;
+
+    for (const unsigned char *c = (const unsigned char *)str + num_chars; c > (const unsigned char *)str; ) {
+        unsigned char value = bn_hex_values[*--c];
+        if (value != BN_HEX_SPACE) {
+            block |= (bn_block_t)(value - 1) << (4 * hex_chars_read);
+            hex_chars_read++;
+
+            if (hex_chars_read == BN_BLOCK_HEX_CHARS) {
+                bn_write_block(result, offset, block);
+                block = 0;
+                hex_chars_read = 0;
+                offset++;
+            }
+        }
+    }
+
+    if (hex_chars_read) {
+        bn_write_block(result, offset, block);
+    }
+
+    bn_trim(result);
+
+    return result;
+}
+
+size_t bn_hex_len(BigNum *n) {
+    bn_block_t top = bn_get_block_unchecked(n, n->len - 1);
+    if (!top) {
+        return 1;
+    }
+    return (n->len - 1) * BN_BLOCK_HEX_CHARS + (BN_BLOCK_BITS - bn_block_clz(top) + 3) / 4;
+}
+
+size_t bn_to_hex(BigNum *n, char *buf, size_t cap) {
+    BN_STATS_SCOPE(BN_STATS_TO_HEX, n->len);
+    size_t len = bn_hex_len(n);
+    if (cap <= len) {
+        return 0;
+    }
+
+    // All blocks but the most significant one are written completely, two
+    // chars per byte, from the end of the buffer
+    char *end = buf + len;
+    *end = 0;
+    for (size_t offset = 0; offset + 1 < n->len; offset++) {
+        bn_block_t block = bn_get_block_unchecked(n, offset);
+        for (size_t byte = 0; byte < sizeof(bn_block_t); byte++) {
+            end -= 2;
+            memcpy(end, bn_hex_pairs + 2 * (block & 0xff), 2);
+            block >>= 8;
+        }
+    }
+    bn_block_t top = bn_get_block_unchecked(n, n->len - 1);
+    while (end > buf) {
+        *--end = bn_hex_pairs[2 * (top & 0xf) + 1];
+        top >>= 4;
+    }
+    return len;
+}
+
+size_t bn_byte_len(BigNum *n) {
+    bn_block_t top = bn_get_block_unchecked(n, n->len - 1);
+    if (!top) {
+        return 0;
+    }
+    return (n->len - 1) * sizeof(bn_block_t) + (BN_BLOCK_BITS - bn_block_clz(top) + 7) / 8;
+}
+
+int bn_to_bytes(BigNum *n, unsigned char *buf, size_t len, bn_Endian endian) {
+    if (bn_byte_len(n) > len) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        bn_block_t block = bn_get_block(n, i / sizeof(bn_block_t));
+        unsigned char byte = block >> (8 * (i % sizeof(bn_block_t)));
+        buf[endian == BN_LITTLE_ENDIAN ? i : len - 1 - i] = byte;
+    }
+    return 1;
+}
+
+BigNum *bn_from_bytes(const unsigned char *buf, size_t len, bn_Endian endian) {
+    if (!buf && len) {
+        return NULL;
+    }
+    size_t num_blocks = (len + sizeof(bn_block_t) - 1) / sizeof(bn_block_t);
+    BigNum *result = bn_with_len(num_blocks ? num_blocks : 1);
+    bn_block_t *blocks = result->data;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char byte = buf[endian == BN_LITTLE_ENDIAN ? i : len - 1 - i];
+        blocks[i / sizeof(bn_block_t)] |= (bn_block_t)byte << (8 * (i % sizeof(bn_block_t)));
+    }
+    bn_trim(result);
+    return result;
+}
+
+// Files of `bn_save_file` start with these magic bytes, followed by the
+// amount of bytes of the blocks as 64-bit little endian integer and then the
+// blocks themselves in little endian
+#define BN_FILE_MAGIC "BIGNUM\x00\x01"
+#define BN_FILE_MAGIC_LEN 8
+#define BN_FILE_HEADER_SIZE 16
+// The blocks are padded with 0-bytes to a multiple of this, so that files can
+// be mapped with both block sizes
+#define BN_FILE_ALIGNMENT 8
+
+// The blocks of a file only match the memory layout on little endian hosts
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define BN_FILE_BIG_ENDIAN_HOST 1
+#else
+#define BN_FILE_BIG_ENDIAN_HOST 0
+#endif
+
+// Big number whose blocks are a private mapping of a file, see
+// `bn_map_file`. `n` comes first, so a pointer to `n` is a pointer to the
+// whole struct.
+typedef struct bn_MappedNum {
+    BigNum n;
+    // Allocator of `n`. It unmaps the blocks instead of deallocating them and
+    // passes everything else on to `parent`.
+    bn_Allocator allocator;
+    const bn_Allocator *parent;
+    // Start and size of the mapping, which includes the header. `map` is a
+    // null pointer once the blocks have been unmapped.
+    void *map;
+    size_t map_size;
+} bn_MappedNum;
+
+// Returns whether `ptr` points to the mapped blocks of `mapped`
+static int bn_mapped_contains(bn_MappedNum *mapped, void *ptr) {
+    return mapped->map && ptr == (unsigned char *)mapped->map + BN_FILE_HEADER_SIZE;
+}
+
+static void bn_mapped_unmap(bn_MappedNum *mapped) {
+    munmap(mapped->map, mapped->map_size);
+    mapped->map = NULL;
+}
+
+// The wrappers `bn_allocate` etc. have already counted the calls of these
+// functions, so they call `parent` directly
+static void *bn_mapped_allocate(void *ctx, size_t size) {
+    const bn_Allocator *parent = ((bn_MappedNum *)ctx)->parent;
+    return parent->allocate(parent->ctx, size);
+}
+
+static void *bn_mapped_reallocate(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    bn_MappedNum *mapped = ctx;
+    const bn_Allocator *parent = mapped->parent;
+    if (!bn_mapped_contains(mapped, ptr)) {
+        return parent->reallocate(parent->ctx, ptr, old_size, new_size);
+    }
+    // The mapping can't grow, so the blocks move to the heap
+    void *data = parent->allocate(parent->ctx, new_size);
+    memcpy(data, ptr, old_size < new_size ? old_size : new_size);
+    bn_mapped_unmap(mapped);
+    return data;
+}
+
+static void bn_mapped_deallocate(void *ctx, void *ptr, size_t size) {
+    bn_MappedNum *mapped = ctx;
+    const bn_Allocator *parent = mapped->parent;
+    if (bn_mapped_contains(mapped, ptr)) {
+        bn_mapped_unmap(mapped);
+    } else if (ptr == &mapped->n) {
+        // The struct of the number is always deallocated last
+        if (mapped->map) {
+            bn_mapped_unmap(mapped);
+        }
+        parent->deallocate(parent->ctx, mapped, sizeof(bn_MappedNum));
+    } else {
+        parent->deallocate(parent->ctx, ptr, size);
+    }
+}
+
+BigNum *bn_map_file(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size < BN_FILE_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    // A private writable mapping lets the number be modified like any other
+    // one. Only the pages that are written are copied and the file stays
+    // unchanged.
+    int flags = MAP_PRIVATE;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    size_t map_size = st.st_size;
+    unsigned char *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    uint64_t size = 0;
+    for (int i = 0; i < 8; i++) {
+        size |= (uint64_t)map[BN_FILE_MAGIC_LEN + i] << (8 * i);
+    }
+    if (memcmp(map, BN_FILE_MAGIC, BN_FILE_MAGIC_LEN) || size == 0 || size % BN_FILE_ALIGNMENT || size != map_size - BN_FILE_HEADER_SIZE) {
+        munmap(map, map_size);
+        return NULL;
+    }
+
+    size_t len = size / sizeof(bn_block_t);
+    if (len <= BN_INLINE_BLOCKS || BN_FILE_BIG_ENDIAN_HOST) {
+        // Small numbers are stored inline
+        BigNum *result = bn_from_bytes(map + BN_FILE_HEADER_SIZE, size, BN_LITTLE_ENDIAN);
+        munmap(map, map_size);
+        return result;
+    }
+
+    const bn_Allocator *parent = bn_current_allocator();
+    bn_MappedNum *mapped = bn_allocate(parent, sizeof(bn_MappedNum));
+    mapped->allocator.allocate = bn_mapped_allocate;
+    mapped->allocator.reallocate = bn_mapped_reallocate;
+    mapped->allocator.deallocate = bn_mapped_deallocate;
+    mapped->allocator.ctx = mapped;
+    mapped->parent = parent;
+    mapped->map = map;
+    mapped->map_size = map_size;
+    mapped->n.data = map + BN_FILE_HEADER_SIZE;
+    mapped->n.len = len;
+    mapped->n.capacity = len;
+    mapped->n.allocator = &mapped->allocator;
+    bn_trim(&mapped->n);
+    return &mapped->n;
+}
+
+int bn_save_file(BigNum *n, const char *path) {
+    size_t blocks_size = n->len * sizeof(bn_block_t);
+    size_t size = (blocks_size + BN_FILE_ALIGNMENT - 1) / BN_FILE_ALIGNMENT * BN_FILE_ALIGNMENT;
+    unsigned char header[BN_FILE_HEADER_SIZE];
+    memcpy(header, BN_FILE_MAGIC, BN_FILE_MAGIC_LEN);
+    for (int i = 0; i < 8; i++) {
+        header[BN_FILE_MAGIC_LEN + i] = (uint64_t)size >> (8 * i);
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return 0;
+    }
+    int success = fwrite(header, BN_FILE_HEADER_SIZE, 1, file) == 1;
+#if BN_FILE_BIG_ENDIAN_HOST
+    unsigned char *bytes = bn_scratch_alloc(size);
+    bn_to_bytes(n, bytes, size, BN_LITTLE_ENDIAN);
+    success = success && fwrite(bytes, size, 1, file) == 1;
+    bn_scratch_free(bytes, size);
+#else
+    // The blocks are written directly from `n`, so mapped numbers are
+    // streamed from one file to the other
+    static const unsigned char padding[BN_FILE_ALIGNMENT] = { 0 };
+    success = success && fwrite(n->data, sizeof(bn_block_t), n->len, file) == n->len;
+    success = success && fwrite(padding, 1, size - blocks_size, file) == size - blocks_size;
+#endif
+    success = fclose(file) == 0 && success;
+    return success;
+}
+
+void bn_print_hex(BigNum *n) {
+    // The output is always grouped in 32-bit ints, independent of the block
+    // size. With 64-bit blocks, the upper half of the most significant block
+    // is skipped if it is 0, which gives the same output as 32-bit blocks.
+    int groups_per_block = BN_BLOCK_BITS / 32;
+    size_t num_groups = n->len * groups_per_block;
+    while (num_groups > 1) {
+        size_t group = num_groups - 1;
+        bn_block_t block = bn_get_block_unchecked(n, group / groups_per_block);
+        if ((uint32_t)(block >> (32 * (group % groups_per_block)))) {
+            break;
+        }
+        num_groups--;
+    }
+
+    // size_t can't be negative, this we can't use offset >= 0 as condition.
+    // Because of that we count from `num_groups` to 1 and use `group - 1`.
+    for (size_t group = num_groups; group > 0; group--) {
+        bn_block_t block = bn_get_block_unchecked(n, (group - 1) / groups_per_block);
+        printf("%08x ", (uint32_t)(block >> (32 * ((group - 1) % groups_per_block))));
+    }
+    printf("\n");
+}
+
+int bn_compare(BigNum *n1, BigNum *n2) {
+    if (n1->len > n2->len) {
+        return 1;
+    } else if (n1->len < n2->len) {
+        return -1;
+    } else {
+        // Compare blocks, starting at the most significant block
+        for (size_t offset = n1->len; offset > 0; offset--) {
+            bn_block_t n1_block = bn_get_block_unchecked(n1, offset - 1);
+            bn_block_t n2_block = bn_get_block_unchecked(n2, offset - 1);
+            if (n1_block > n2_block) {
+                return 1;
+            } else if (n1_block < n2_block) {
+                return -1;
+            }
+        }
+
+        return 0;
+    }
+}
+
+int bn_greater_than(BigNum *n1, BigNum *n2) {
+    return bn_compare(n1, n2) > 0;
+}
+
+int bn_less_than(BigNum *n1, BigNum *n2) {
+    return bn_compare(n1, n2) < 0;
+}
+
+int bn_equal_to(BigNum *n1, BigNum *n2) {
+    return bn_compare(n1, n2) == 0;
+}
+
+static bn_block_t bn_blocks_add(bn_block_t *result, bn_block_t *a, size_t a_len, bn_block_t *b, size_t b_len);
+static bn_block_t bn_blocks_sub(bn_block_t *result, bn_block_t *a, size_t a_len, bn_block_t *b, size_t b_len);
+
+BigNum *bn_add_into(BigNum *dst, BigNum *n1, BigNum *n2) {
+    BN_STATS_SCOPE(BN_STATS_ADD, n1->len > n2->len ? n1->len : n2->len);
+    // The longer operand comes first for `bn_blocks_add`
+    if (n1->len < n2->len) {
+        BigNum *swap = n1;
+        n1 = n2;
+        n2 = swap;
+    }
+    size_t n1_len = n1->len;
+    size_t n2_len = n2->len;
+
+    // `bn_blocks_add` reads each block of the operands before it writes the
+    // block with the same offset, so `dst` may alias one or both operands.
+    // The lengths are taken before the resize, which may grow an aliased
+    // operand.
+    bn_resize(dst, n1_len + 1);
+    bn_block_t *result = dst->data;
+    result[n1_len] = bn_blocks_add(result, n1->data, n1_len, n2->data, n2_len);
+
+    bn_trim(dst);
+
+    return dst;
+}
+
+BigNum *bn_add_assign(BigNum *acc, BigNum *n) {
+    return bn_add_into(acc, acc, n);
+}
+
+BigNum *bn_add(BigNum *n1, BigNum *n2) {
+    size_t greater_len = n1->len > n2->len ? n1->len : n2->len;
+    return bn_add_into(bn_with_len(greater_len + 1), n1, n2);
+}
+
+BigNum *bn_subtract_into(BigNum *dst, BigNum *n1, BigNum *n2) {
+    BN_STATS_SCOPE(BN_STATS_SUBTRACT, n1->len);
+    if (bn_greater_than(n2, n1)) {
+        return NULL;
+    }
+
+    // n1 >= n2, so the result will be at most n1->len long and blocks of n2
+    // beyond that are 0. As in `bn_add_into`, `dst` may alias one or both
+    // operands.
+    size_t n1_len = n1->len;
+    size_t n2_len = n2->len < n1_len ? n2->len : n1_len;
+    bn_resize(dst, n1_len);
+    bn_blocks_sub(dst->data, n1->data, n1_len, n2->data, n2_len);
+
+    bn_trim(dst);
+
+    return dst;
+}
+
+BigNum *bn_subtract_assign(BigNum *acc, BigNum *n) {
+    return bn_subtract_into(acc, acc, n);
+}
+
+BigNum *bn_subtract(BigNum *n1, BigNum *n2) {
+    if (bn_greater_than(n2, n1)) {
+        return NULL;
+    }
+    return bn_subtract_into(bn_with_len(n1->len), n1, n2);
+}
+
+// Operand lengths (in blocks) from which on `bn_multiply` switches from the
+// schoolbook method to Karatsuba, Toom-3 and the NTT respectively. See
+// `bn_set_mul_thresholds`.
+static size_t bn_karatsuba_threshold = 32;
+static size_t bn_toom3_threshold = 240;
+static size_t bn_ntt_threshold = 4096;
+// Amount of blocks that the divisor and the quotient of a division need to
+// have for the division to be split recursively (Burnikel-Ziegler)
+static size_t bn_div_threshold = 64;
+
+// Kernels of the innermost loops. All of them may write `result` while they
+// read `a` and `b` at the same offset, so `result` may alias them.
+typedef struct bn_Kernels {
+    // Name for `BN_KERNELS` and `bn_kernels_name`
+    const char *name;
+    // Returns whether the CPU supports the instructions of the kernels
+    int (*supported)();
+    // Writes the sum of the `len` blocks at `a` and `b` to `result` and
+    // returns the carry
+    bn_block_t (*add)(bn_block_t *result, bn_block_t *a, bn_block_t *b, size_t len);
+    // Writes the difference of the `len` blocks at `a` and `b` to `result`
+    // and returns the borrow
+    bn_block_t (*sub)(bn_block_t *result, bn_block_t *a, bn_block_t *b, size_t len);
+    // Same as `bn_blocks_mul_add`
+    bn_block_t (*mul_add)(bn_block_t *result, bn_block_t *a, size_t len, bn_block_t b);
+} bn_Kernels;
+
+static int bn_kernels_always_supported() {
+    return 1;
+}
+
+static bn_block_t bn_kernel_add_portable(bn_block_t *result, bn_block_t *a, bn_block_t *b, size_t len) {
+    bn_dblock_t transfer = 0;
+    for (size_t offset = 0; offset < len; offset++) {
+        bn_dblock_t sum = (bn_dblock_t)a[offset] + b[offset] + transfer;
+        result[offset] = sum;
+        transfer = sum >> BN_BLOCK_BITS;
+    }
+    return transfer;
+}
+
+static bn_block_t bn_kernel_sub_portable(bn_block_t *result, bn_block_t *a, bn_block_t *b, size_t len) {
+    bn_dblock_t borrow = 0;
+    for (size_t offset = 0; offset < len; offset++) {
+        bn_dblock_t diff = (bn_dblock_t)a[offset] - b[offset] - borrow;
+        result[offset] = diff;
+        borrow = diff >> (2 * BN_BLOCK_BITS - 1);
+    }
+    return borrow;
+}
+
+static bn_block_t bn_kernel_mul_add_portable(bn_block_t *result, bn_block_t *a, size_t len, bn_block_t b) {
+    bn_block_t carry = 0;
+    for (size_t offset = 0; offset < len; offset++) {
+        // (B - 1)^2 + 2 * (B - 1) = B^2 - 1 for B = 2^BN_BLOCK_BITS, so this
+        // can't overflow
+        bn_dblock_t sum = (bn_dblock_t)a[offset] * b + result[offset] + carry;
+        result[offset] = sum;
+        carry = sum >> BN_BLOCK_BITS;
+    }
+    return carry;
+}
+
+#if BN_X86_64_KERNELS
+// The assembly loops process 4 blocks per iteration with an index that runs
+// from -len up to 0 in rcx. `lea` and `jrcxz` leave the flags alone, so the
+// carries stay in the flags for the whole loop. The remaining blocks are
+// handled by the portable kernels.
+
+static bn_block_t bn_kernel_add_x86_64(bn_block_t *result, bn_block_t *a, bn_block_t *b, size_t len) {
+    size_t loop_len = len - len % 4;
+    bn_block_t carry = 0;
+    if (loop_len) {
+        long index = -(long)loop_len;
+        bn_block_t tmp;
+        __asm__ volatile(
+            "clc\n\t"
+            "1:\n\t"
+            "mov (%[a],%[i],8), %[tmp]\n\t"
+            "adc (%[b],%[i],8), %[tmp]\n\t"
+            "mov %[tmp], (%[r],%[i],8)\n\t"
+            "mov 8(%[a],%[i],8), %[tmp]\n\t"
+            "adc 8(%[b],%[i],8), %[tmp]\n\t"
+            "mov %[tmp], 8(%[r],%[i],8)\n\t"
+            "mov 16(%[a],%[i],8), %[tmp]\n\t"
+            "adc 16(%[b],%[i],8), %[tmp]\n\t"
+            "mov %[tmp], 16(%[r],%[i],8)\n\t"
+            "mov 24(%[a],%[i],8), %[tmp]\n\t"
+            "adc 24(%[b],%[i],8), %[tmp]\n\t"
+            "mov %[tmp], 24(%[r],%[i],8)\n\t"
+            "lea 4(%[i]), %[i]\n\t"
+            "jrcxz 2f\n\t"
+            "jmp 1b\n\t"
+            "2:\n\t"
+            "setc %b[carry]\n\t"
+            : [i] "+c"(index), [tmp] "=&r"(tmp), [carry] "+r"(carry)
+            : [a] "r"(a + loop_len), [b] "r"(b + loop_len), [r] "r"(result + loop_len)
+            : "cc", "memory");
+    }
+    bn_dblock_t transfer = carry;
+    for (size_t offset = loop_len; offset < len; offset++) {
+        bn_dblock_t sum = (bn_dblock_t)a[offset] + b[offset] + transfer;
+        result[offset] = sum;
+        transfer = sum >> BN_BLOCK_BITS;
+    }
+    return transfer;
+}
+
+static bn_block_t bn_kernel_sub_x86_64(bn_block_t *result, bn_block_t *a, bn_block_t *b, size_t len) {
+    size_t loop_len = len - len % 4;
+    bn_block_t borrow = 0;
+    if (loop_len) {
+        long index = -(long)loop_len;
+        bn_block_t tmp;
+        __asm__ volatile(
+            "clc\n\t"
+            "1:\n\t"
+            "mov (%[a],%[i],8), %[tmp]\n\t"
+            "sbb (%[b],%[i],8), %[tmp]\n\t"
+            "mov %[tmp], (%[r],%[i],8)\n\t"
+            "mov 8(%[a],%[i],8), %[tmp]\n\t"
+            "sbb 8(%[b],%[i],8), %[tmp]\n\t"
+            "mov %[tmp], 8(%[r],%[i],8)\n\t"
+            "mov 16(%[a],%[i],8), %[tmp]\n\t"
+            "sbb 16(%[b],%[i],8), %[tmp]\n\t"
+            "mov %[tmp], 16(%[r],%[i],8)\n\t"
+            "mov 24(%[a],%[i],8), %[tmp]\n\t"
+            "sbb 24(%[b],%[i],8), %[tmp]\n\t"
+            "mov %[tmp], 24(%[r],%[i],8)\n\t"
+            "lea 4(%[i]), %[i]\n\t"
+            "jrcxz 2f\n\t"
+            "jmp 1b\n\t"
+            "2:\n\t"
+            "setc %b[borrow]\n\t"
+            : [i] "+c"(index), [tmp] "=&r"(tmp), [borrow] "+r"(borrow)
+            : [a] "r"(a + loop_len), [b] "r"(b + loop_len), [r] "r"(result + loop_len)
+            : "cc", "memory");
+    }
+    bn_dblock_t transfer = borrow;
+    for (size_t offset = loop_len; offset < len; offset++) {
+        bn_dblock_t diff = (bn_dblock_t)a[offset] - b[offset] - transfer;
+        result[offset] = diff;
+        transfer = diff >> (2 * BN_BLOCK_BITS - 1);
+    }
+    return transfer;
+}
+
+// One step of `bn_kernel_mul_add_adx` for the block at `offset` bytes: mulx
+// computes a[i] * b without touching the flags, adcx adds the upper half of
+// the previous product to the lower half in the carry flag chain, and adox
+// adds that to result[i] in the overflow flag chain.
+#define BN_MUL_ADD_ADX_STEP(offset) \
+    "mulx " offset "(%[a],%[i],8), %[low], %[high]\n\t" \
+    "adcx %[prev], %[low]\n\t" \
+    "mov " offset "(%[r],%[i],8), %[tmp]\n\t" \
+    "adox %[low], %[tmp]\n\t" \
+    "mov %[tmp], " offset "(%[r],%[i],8)\n\t" \
+    "mov %[high], %[prev]\n\t"
+
+static bn_block_t bn_kernel_mul_add_adx(bn_block_t *result, bn_block_t *a, size_t len, bn_block_t b) {
+    size_t loop_len = len - len % 4;
+    bn_block_t carry = 0;
+    if (loop_len) {
+        long index = -(long)loop_len;
+        bn_block_t low, high, tmp;
+        __asm__ volatile(
+            // Clears both flags
+            "xor %k[prev], %k[prev]\n\t"
+            "1:\n\t"
+            BN_MUL_ADD_ADX_STEP("0")
+            BN_MUL_ADD_ADX_STEP("8")
+            BN_MUL_ADD_ADX_STEP("16")
+            BN_MUL_ADD_ADX_STEP("24")
+            "lea 4(%[i]), %[i]\n\t"
+            "jrcxz 2f\n\t"
+            "jmp 1b\n\t"
+            "2:\n\t"
+            // The carry into the next block is the last upper half plus both
+            // flags, which can't overflow
+            "mov $0, %k[tmp]\n\t"
+            "adcx %[tmp], %[prev]\n\t"
+            "adox %[tmp], %[prev]\n\t"
+            : [i] "+c"(index), [prev] "=&r"(carry), [low] "=&r"(low), [high] "=&r"(high), [tmp] "=&r"(tmp)
+            : [a] "r"(a + loop_len), [r] "r"(result + loop_len), "d"(b)
+            : "cc", "memory");
+    }
+    for (size_t offset = loop_len; offset < len; offset++) {
+        bn_dblock_t sum = (bn_dblock_t)a[offset] * b + result[offset] + carry;
+        result[offset] = sum;
+        carry = sum >> BN_BLOCK_BITS;
+    }
+    return carry;
+}
+
+#undef BN_MUL_ADD_ADX_STEP
+
+// mulx needs BMI2, adcx and adox need ADX
+static int bn_kernels_adx_supported() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    return (ebx & bit_BMI2) && (ebx & bit_ADX);
+}
+#endif
+
+// All kernels, the fastest first
+static const bn_Kernels bn_kernels_list[] = {
+#if BN_X86_64_KERNELS
+    { "adx", bn_kernels_adx_supported, bn_kernel_add_x86_64, bn_kernel_sub_x86_64, bn_kernel_mul_add_adx },
+    { "x86-64", bn_kernels_always_supported, bn_kernel_add_x86_64, bn_kernel_sub_x86_64, bn_kernel_mul_add_portable },
+#endif
+    { "portable", bn_kernels_always_supported, bn_kernel_add_portable, bn_kernel_sub_portable, bn_kernel_mul_add_portable },
+};
+
+#define BN_KERNELS_COUNT (sizeof(bn_kernels_list) / sizeof(bn_kernels_list[0]))
+
+// Kernels in use. They are bound before `main` runs, so that the hot loops
+// don't need to check whether it happened.
+static const bn_Kernels *bn_kernels = &bn_kernels_list[BN_KERNELS_COUNT - 1];
+
+__attribute__((constructor)) static void bn_kernels_init() {
+    const char *name = getenv("BN_KERNELS");
+    for (size_t i = 0; i < BN_KERNELS_COUNT; i++) {
+        if (bn_kernels_list[i].supported() && (!name || strcmp(name, bn_kernels_list[i].name) == 0)) {
+            bn_kernels = &bn_kernels_list[i];
+            return;
+        }
+    }
+    // An unknown or unsupported name uses the fastest supported kernels
+    for (size_t i = 0; i < BN_KERNELS_COUNT; i++) {
+        if (bn_kernels_list[i].supported()) {
+            bn_kernels = &bn_kernels_list[i];
+            return;
+        }
+    }
+}
+
+const char *bn_kernels_name() {
+    return bn_kernels->name;
+}
+
+// Adds the `b_len` blocks at `b` to the `a_len` blocks at `a` and writes the
+// lower `a_len` blocks of the sum to `result`. `a_len` must be at least
+// `b_len`. Returns the carry out of the most significant block. `result` may
+// alias `a` or `b`.
+static bn_block_t bn_blocks_add(bn_block_t *result, bn_block_t *a, size_t a_len, bn_block_t *b, size_t b_len) {
+    bn_dblock_t transfer = bn_kernels->add(result, a, b, b_len);
+    for (size_t offset = b_len; offset < a_len; offset++) {
+        bn_dblock_t sum = (bn_dblock_t)a[offset] + transfer;
+        result[offset] = sum;
+        transfer = sum >> BN_BLOCK_BITS;
+    }
+    return transfer;
+}
+
+// Subtracts the `b_len` blocks at `b` from the `a_len` blocks at `a` and
+// writes the `a_len` blocks of the difference to `result`. `a_len` must be at
+// least `b_len`. Returns the borrow out of the most significant block, which
+// is 1 if `b` was greater than `a`. `result` may alias `a` or `b`.
+static bn_block_t bn_blocks_sub(bn_block_t *result, bn_block_t *a, size_t a_len, bn_block_t *b, size_t b_len) {
+    bn_dblock_t borrow = bn_kernels->sub(result, a, b, b_len);
+    for (size_t offset = b_len; offset < a_len; offset++) {
+        bn_dblock_t diff = (bn_dblock_t)a[offset] - borrow;
+        result[offset] = diff;
+        borrow = diff >> (2 * BN_BLOCK_BITS - 1);
+    }
+    return borrow;
+}
+
+// Adds `a` * `b` to the `len` blocks at `result`, carrying through the whole
+// row in registers. Returns the block that is carried out of the most
+// significant block. This is the inner kernel of the schoolbook
+// multiplication and of the Montgomery reduction.
+static inline bn_block_t bn_blocks_mul_add(bn_block_t *result, bn_block_t *a, size_t len, bn_block_t b) {
+    return bn_kernels->mul_add(result, a, len, b);
+}
+
+// Subtracts `a` * `b` from the `len` blocks at `result`. Returns the block that
+// has to be subtracted from the block after the most significant block. This
+// is the inner kernel of the long division.
+static bn_block_t bn_blocks_mul_sub(bn_block_t *result, bn_block_t *a, size_t len, bn_block_t b) {
+    bn_block_t carry = 0;
+    for (size_t offset = 0; offset < len; offset++) {
+        // At most B^2 - B for B = 2^BN_BLOCK_BITS, so the upper half is at
+        // most B - 2 and the borrow below can't overflow the carry.
+        bn_dblock_t product = (bn_dblock_t)a[offset] * b + carry;
+        bn_block_t lower_half = product;
+        carry = product >> BN_BLOCK_BITS;
+        bn_block_t block = result[offset];
+        result[offset] = block - lower_half;
+        carry += block < lower_half;
+    }
+    return carry;
+}
+
+// Compares the `len` blocks at `a` with the `len` blocks at `b`. Returns a
+// negative value if `a` is less, 0 if both are equal and a positive value if
+// `a` is greater than `b`.
+static int bn_blocks_compare(bn_block_t *a, bn_block_t *b, size_t len) {
+    for (size_t _offset = len; _offset > 0; _offset--) {
+        size_t offset = _offset - 1;
+        if (a[offset] != b[offset]) {
+            return a[offset] < b[offset] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// Adds the block `b` to the `len` blocks at `a` in place and stops as soon as
+// nothing is carried anymore. Returns the carry out of the most significant
+// block.
+static bn_block_t bn_blocks_increment(bn_block_t *a, size_t len, bn_block_t b) {
+    for (size_t offset = 0; offset < len && b; offset++) {
+        bn_block_t sum = a[offset] + b;
+        b = sum < b;
+        a[offset] = sum;
+    }
+    return b;
+}
+
+// Subtracts the block `b` from the `len` blocks at `a` in place and stops as
+// soon as nothing is borrowed anymore. Returns the borrow out of the most
+// significant block.
+static bn_block_t bn_blocks_decrement(bn_block_t *a, size_t len, bn_block_t b) {
+    for (size_t offset = 0; offset < len && b; offset++) {
+        bn_block_t block = a[offset];
+        a[offset] = block - b;
+        b = block < b;
+    }
+    return b;
+}
+
+// Shifts the `len` blocks at `a` left by `bits` (1 to BN_BLOCK_BITS - 1) bits and writes the
+// lower `len` blocks to `result`. Returns the bits shifted out of the most
+// significant block. `result` may alias `a`.
+static bn_block_t bn_blocks_shift_left(bn_block_t *result, bn_block_t *a, size_t len, int bits) {
+    bn_block_t out = 0;
+    for (size_t offset = 0; offset < len; offset++) {
+        bn_block_t block = a[offset];
+        result[offset] = (block << bits) | out;
+        out = block >> (BN_BLOCK_BITS - bits);
+    }
+    return out;
+}
+
+// Shifts the `len` blocks at `a` right by `bits` (1 to BN_BLOCK_BITS - 1)
+// bits and writes them to `result`. 0-bits are shifted into the most
+// significant block. `result` may alias `a` or lie below it.
+static void bn_blocks_shift_right(bn_block_t *result, bn_block_t *a, size_t len, int bits) {
+    for (size_t offset = 0; offset + 1 < len; offset++) {
+        result[offset] = (a[offset] >> bits) | (a[offset + 1] << (BN_BLOCK_BITS - bits));
+    }
+    result[len - 1] = a[len - 1] >> bits;
+}
+
+// Divides the `len` blocks at `a` by the single block `divisor` and writes the
+// quotient to `result`, which may alias `a`. Returns the remainder.
+static bn_block_t bn_blocks_divide_block(bn_block_t *result, bn_block_t *a, size_t len, bn_block_t divisor) {
+    bn_dblock_t rem = 0;
+    for (size_t _offset = len; _offset > 0; _offset--) {
+        size_t offset = _offset - 1;
+        bn_dblock_t num = (rem << BN_BLOCK_BITS) | a[offset];
+        result[offset] = num / divisor;
+        rem = num % divisor;
+    }
+    return rem;
+}
+
+// Returns the amount of scratch blocks that `bn_multiply_blocks` needs when the
+// longer operand has `len` blocks. Each recursion level always needs less
+// than 3 * `len` + 32 blocks and works on operands of at most `len` / 2 + 2
+// blocks.
+static size_t bn_multiply_scratch_len(size_t len) {
+    size_t scratch_len = 0;
+    while (len >= bn_karatsuba_threshold) {
+        scratch_len += 3 * len + 32;
+        len = len / 2 + 2;
+    }
+    return scratch_len;
+}
+
+static void bn_multiply_blocks(bn_block_t *result, bn_block_t *a, size_t a_len, bn_block_t *b, size_t b_len, bn_block_t *scratch);
+
+// A multiplication as a task, which allocates its own scratch space
+typedef struct bn_MultiplyTask {
+    bn_Task task;
+    bn_block_t *result;
+    bn_block_t *a;
+    size_t a_len;
+    bn_block_t *b;
+    size_t b_len;
+} bn_MultiplyTask;
+
+static void bn_multiply_task_run(bn_Task *task) {
+    bn_MultiplyTask *multiply = (bn_MultiplyTask *)task;
+    size_t longer_len = multiply->a_len > multiply->b_len ? multiply->a_len : multiply->b_len;
+    size_t scratch_len = bn_multiply_scratch_len(longer_len);
+    bn_block_t *scratch = scratch_len ? bn_scratch_alloc(scratch_len * sizeof(bn_block_t)) : NULL;
+    bn_multiply_blocks(multiply->result, multiply->a, multiply->a_len, multiply->b, multiply->b_len, scratch);
+    bn_scratch_free(scratch, scratch_len * sizeof(bn_block_t));
+}
+
+// Multiplies like `bn_multiply_blocks`. If `group` is not a null pointer, the
+// multiplication is spawned as the task `task` of `group` instead, which
+// doesn't use `scratch`.
+static void bn_multiply_fork(bn_TaskGroup *group, bn_MultiplyTask *task, bn_block_t *result, bn_block_t *a, size_t a_len, bn_block_t *b, size_t b_len, bn_block_t *scratch) {
+    if (!group) {
+        bn_multiply_blocks(result, a, a_len, b, b_len, scratch);
+        return;
+    }
+    *task = (bn_MultiplyTask){ { bn_multiply_task_run, NULL }, result, a, a_len, b, b_len };
+    bn_task_spawn(group, &task->task);
+}
+
+// Writes the product of `a` and `b` to the `a_len` + `b_len` blocks at
+// `result` using the schoolbook method.
+static void bn_multiply_schoolbook(bn_block_t *result, bn_block_t *a, size_t a_len, bn_block_t *b, size_t b_len) {
+    // Each row adds `b` * a[a_offset] at `a_offset` and its carry is the first
+    // block of the result that no earlier row has written.
+    memset(result, 0, b_len * sizeof(bn_block_t));
+    for (size_t a_offset = 0; a_offset < a_len; a_offset++) {
+        result[a_offset + b_len] = bn_blocks_mul_add(result + a_offset, b, b_len, a[a_offset]);
+    }
+}
+
+// Writes the product of `a` and `b` to the `a_len` + `b_len` blocks at
+// `result` using Karatsuba's method. `a_len` must be at least `b_len` and
+// 2 * `b_len` must be greater than `a_len`.
+//
+// With a = a1 * B^h + a0 and b = b1 * B^h + b0, the product is
+// a1 * b1 * B^2h + ((a0 + a1)(b0 + b1) - a0 * b0 - a1 * b1) * B^h + a0 * b0,
+// which needs only three half-sized multiplications.
+static void bn_multiply_karatsuba(bn_block_t *result, bn_block_t *a, size_t a_len, bn_block_t *b, size_t b_len, bn_block_t *scratch) {
+    size_t h = a_len / 2;
+    size_t a1_len = a_len - h;
+    size_t b1_len = b_len - h;
+
+    // a0 * b0 and a1 * b1 go straight to their place in the result. For
+    // large operands, they are computed by other threads while this one
+    // computes the middle term.
+    bn_TaskGroup tasks = { 0 };
+    bn_TaskGroup *group = bn_in_parallel(b_len) ? &tasks : NULL;
+    bn_MultiplyTask outer[2];
+    bn_multiply_fork(group, &outer[0], result, a, h, b, h, scratch);
+    bn_multiply_fork(group, &outer[1], result + 2 * h, a + h, a1_len, b + h, b1_len, scratch);
+
+    size_t a_sum_len = a1_len + 1;
+    size_t b_sum_len = (b1_len > h ? b1_len : h) + 1;
+    bn_block_t *a_sum = scratch;
+    bn_block_t *b_sum = a_sum + a_sum_len;
+    bn_block_t *middle = b_sum + b_sum_len;
+    size_t middle_len = a_sum_len + b_sum_len;
+    bn_block_t *rest = middle + middle_len;
+
+    a_sum[a1_len] = bn_blocks_add(a_sum, a + h, a1_len, a, h);
+    if (b1_len > h) {
+        b_sum[b1_len] = bn_blocks_add(b_sum, b + h, b1_len, b, h);
+    } else {
+        b_sum[h] = bn_blocks_add(b_sum, b, h, b + h, b1_len);
+    }
+
+    bn_multiply_blocks(middle, a_sum, a_sum_len, b_sum, b_sum_len, rest);
+    if (group) {
+        bn_task_wait(group);
+    }
+    bn_blocks_sub(middle, middle, middle_len, result, 2 * h);
+    bn_blocks_sub(middle, middle, middle_len, result + 2 * h, a1_len + b1_len);
+
+    // The middle term is less than B^(a_len + b_len - h), so its upper blocks
+    // beyond the result are 0.
+    size_t result_rest = a_len + b_len - h;
+    bn_blocks_add(result + h, result + h, result_rest, middle, middle_len < result_rest ? middle_len : result_rest);
+}
+
+// Writes the product of `a` and `b` to the `a_len` + `b_len` blocks at
+// `result` using Toom-Cook 3. `a_len` must be at least `b_len` and `b_len`
+// must be greater than 2 * ceil(`a_len` / 3).
+//
+// Both operands are split into three parts of k blocks, a = a2 * B^2k + a1 *
+// B^k + a0, and the product polynomial c4 x^4 + ... + c0 is interpolated from
+// its values at 0, 1, 2, 1/2 (scaled by 2^4) and infinity. These points keep
+// all intermediate values non-negative, so no signs need to be tracked.
+static void bn_multiply_toom3(bn_block_t *result, bn_block_t *a, size_t a_len, bn_block_t *b, size_t b_len, bn_block_t *scratch) {
+    size_t k = (a_len + 2) / 3;
+    size_t a2_len = a_len - 2 * k;
+    size_t b2_len = b_len - 2 * k;
+    bn_block_t *a1 = a + k;
+    bn_block_t *a2 = a + 2 * k;
+    bn_block_t *b1 = b + k;
+    bn_block_t *b2 = b + 2 * k;
+
+    size_t eval_len = k + 1;
+    size_t value_len = 2 * eval_len;
+    bn_block_t *a_eval = scratch;
+    bn_block_t *b_eval = a_eval + eval_len;
+    bn_block_t *v1 = b_eval + eval_len;
+    bn_block_t *v2 = v1 + value_len;
+    bn_block_t *v_half = v2 + value_len;
+    bn_block_t *rest = v_half + value_len;
+
+    // For large operands, the products are computed by other threads, except
+    // for the last one. Every evaluation then needs its own buffers.
+    bn_TaskGroup tasks = { 0 };
+    bn_TaskGroup *group = bn_in_parallel(b_len) ? &tasks : NULL;
+    bn_MultiplyTask products[4];
+    size_t evals_len = group ? 4 * eval_len : 0;
+    bn_block_t *evals = group ? bn_scratch_alloc(evals_len * sizeof(bn_block_t)) : NULL;
+    bn_block_t *a_eval2 = group ? evals : a_eval;
+    bn_block_t *b_eval2 = a_eval2 + eval_len;
+    bn_block_t *a_eval_half = group ? evals + 2 * eval_len : a_eval;
+    bn_block_t *b_eval_half = a_eval_half + eval_len;
+
+    // c0 = a0 * b0 and c4 = a2 * b2 go straight to their place in the result
+    bn_block_t *c0 = result;
+    bn_block_t *c4 = result + 4 * k;
+    size_t c4_len = a2_len + b2_len;
+    bn_multiply_fork(group, &products[0], c0, a, k, b, k, rest);
+    memset(result + 2 * k, 0, 2 * k * sizeof(bn_block_t));
+    bn_multiply_fork(group, &products[1], c4, a2, a2_len, b2, b2_len, rest);
+
+    // Value at 1: (a0 + a1 + a2)(b0 + b1 + b2)
+    a_eval[k] = bn_blocks_add(a_eval, a, k, a1, k);
+    a_eval[k] += bn_blocks_add(a_eval, a_eval, k, a2, a2_len);
+    b_eval[k] = bn_blocks_add(b_eval, b, k, b1, k);
+    b_eval[k] += bn_blocks_add(b_eval, b_eval, k, b2, b2_len);
+    bn_multiply_fork(group, &products[2], v1, a_eval, eval_len, b_eval, eval_len, rest);
+
+    // Value at 2: (4 a2 + 2 a1 + a0)(4 b2 + 2 b1 + b0)
+    memset(a_eval2, 0, 2 * eval_len * sizeof(bn_block_t));
+    memcpy(a_eval2, a2, a2_len * sizeof(bn_block_t));
+    memcpy(b_eval2, b2, b2_len * sizeof(bn_block_t));
+    bn_blocks_shift_left(a_eval2, a_eval2, eval_len, 1);
+    bn_blocks_add(a_eval2, a_eval2, eval_len, a1, k);
+    bn_blocks_shift_left(a_eval2, a_eval2, eval_len, 1);
+    bn_blocks_add(a_eval2, a_eval2, eval_len, a, k);
+    bn_blocks_shift_left(b_eval2, b_eval2, eval_len, 1);
+    bn_blocks_add(b_eval2, b_eval2, eval_len, b1, k);
+    bn_blocks_shift_left(b_eval2, b_eval2, eval_len, 1);
+    bn_blocks_add(b_eval2, b_eval2, eval_len, b, k);
+    bn_multiply_fork(group, &products[3], v2, a_eval2, eval_len, b_eval2, eval_len, rest);
+
+    // Value at 1/2, scaled by 2^4: (4 a0 + 2 a1 + a2)(4 b0 + 2 b1 + b2)
+    memcpy(a_eval_half, a, k * sizeof(bn_block_t));
+    a_eval_half[k] = 0;
+    memcpy(b_eval_half, b, k * sizeof(bn_block_t));
+    b_eval_half[k] = 0;
+    bn_blocks_shift_left(a_eval_half, a_eval_half, eval_len, 1);
+    bn_blocks_add(a_eval_half, a_eval_half, eval_len, a1, k);
+    bn_blocks_shift_left(a_eval_half, a_eval_half, eval_len, 1);
+    bn_blocks_add(a_eval_half, a_eval_half, eval_len, a2, a2_len);
+    bn_blocks_shift_left(b_eval_half, b_eval_half, eval_len, 1);
+    bn_blocks_add(b_eval_half, b_eval_half, eval_len, b1, k);
+    bn_blocks_shift_left(b_eval_half, b_eval_half, eval_len, 1);
+    bn_blocks_add(b_eval_half, b_eval_half, eval_len, b2, b2_len);
+    bn_multiply_blocks(v_half, a_eval_half, eval_len, b_eval_half, eval_len, rest);
+
+    if (group) {
+        bn_task_wait(group);
+        bn_scratch_free(evals, evals_len * sizeof(bn_block_t));
+    }
+
+    // The evaluation buffers are free again and hold 16 * c0 or 16 * c4
+    bn_block_t *shifted = a_eval;
+    size_t shifted_len = value_len;
+
+    // w1 = v1 - c0 - c4 = c1 + c2 + c3
+    bn_blocks_sub(v1, v1, value_len, c0, 2 * k);
+    bn_blocks_sub(v1, v1, value_len, c4, c4_len);
+
+    // w2 = (v2 - c0 - 16 c4) / 2 = c1 + 2 c2 + 4 c3
+    memset(shifted, 0, shifted_len * sizeof(bn_block_t));
+    shifted[c4_len] = bn_blocks_shift_left(shifted, c4, c4_len, 4);
+    bn_blocks_sub(v2, v2, value_len, c0, 2 * k);
+    bn_blocks_sub(v2, v2, value_len, shifted, c4_len + 1);
+    bn_blocks_divide_block(v2, v2, value_len, 2);
+
+    // w_half = (v_half - 16 c0 - c4) / 2 = 4 c1 + 2 c2 + c3
+    shifted[2 * k] = bn_blocks_shift_left(shifted, c0, 2 * k, 4);
+    bn_blocks_sub(v_half, v_half, value_len, shifted, 2 * k + 1);
+    bn_blocks_sub(v_half, v_half, value_len, c4, c4_len);
+    bn_blocks_divide_block(v_half, v_half, value_len, 2);
+
+    // A = w2 - w1 = c2 + 3 c3 and B = w_half - w1 = 3 c1 + c2
+    bn_blocks_sub(v2, v2, value_len, v1, value_len);
+    bn_blocks_sub(v_half, v_half, value_len, v1, value_len);
+
+    // c2 = 3 w1 - A - B
+    bn_blocks_add(shifted, v1, value_len, v1, value_len);
+    bn_blocks_add(v1, v1, value_len, shifted, value_len);
+    bn_blocks_sub(v1, v1, value_len, v2, value_len);
+    bn_blocks_sub(v1, v1, value_len, v_half, value_len);
+
+    // c3 = (A - c2) / 3 and c1 = (B - c2) / 3
+    bn_blocks_sub(v2, v2, value_len, v1, value_len);
+    bn_blocks_divide_block(v2, v2, value_len, 3);
+    bn_blocks_sub(v_half, v_half, value_len, v1, value_len);
+    bn_blocks_divide_block(v_half, v_half, value_len, 3);
+
+    // Add c1, c2 and c3 to the result. Their blocks beyond the end of the
+    // result are 0.
+    size_t result_len = a_len + b_len;
+    bn_block_t *coefficients[] = { v_half, v1, v2 };
+    for (size_t i = 1; i <= 3; i++) {
+        size_t offset = i * k;
+        size_t len = result_len - offset;
+        bn_blocks_add(result + offset, result + offset, len, coefficients[i - 1], value_len < len ? value_len : len);
+    }
+}
+
+// The NTT multiplication splits both operands into 32-bit coefficients and
+// computes their convolution modulo three primes p = c * 2^k + 1 < 2^30,
+// which is combined with the Chinese remainder theorem. Every coefficient of
+// the convolution is less than min(a, b coefficients) * 2^64, which is less
+// than the product of the primes for all supported lengths. A transform can
+// have at most 2^BN_NTT_MAX_LOG coefficients.
+#define BN_NTT_MAX_LOG 23
+#define BN_NTT_WORDS (BN_BLOCK_BITS / 32)
+
+// Transforms of at most this many coefficients fit into the L1 cache and are
+// computed level by level. Larger ones split into recursive halves.
+#define BN_NTT_BLOCK 4096
+
+typedef struct bn_NttPrime {
+    uint32_t p;
+    // -p^-1 mod 2^32
+    uint32_t p_inv;
+    // 2^64 mod p
+    uint32_t r_squared;
+} bn_NttPrime;
+
+// Returns `t` * 2^-32 mod p for `t` < p * 2^32 (Montgomery reduction)
+static inline uint32_t bn_ntt_reduce(uint64_t t, bn_NttPrime prime) {
+    uint32_t q = (uint32_t)t * prime.p_inv;
+    uint32_t u = (t + (uint64_t)q * prime.p) >> 32;
+    return u >= prime.p ? u - prime.p : u;
+}
+
+// Returns `a` * `b` * 2^-32 mod p, where only `b` needs to be less than p
+static inline uint32_t bn_ntt_mul(uint32_t a, uint32_t b, bn_NttPrime prime) {
+    return bn_ntt_reduce((uint64_t)a * b, prime);
+}
+
+static inline uint32_t bn_ntt_add(uint32_t a, uint32_t b, bn_NttPrime prime) {
+    uint32_t sum = a + b;
+    return sum >= prime.p ? sum - prime.p : sum;
+}
+
+static inline uint32_t bn_ntt_sub(uint32_t a, uint32_t b, bn_NttPrime prime) {
+    return a >= b ? a - b : a + prime.p - b;
+}
+
+// Returns `base` ^ `exp` mod `p` without Montgomery form, for the constants
+static uint32_t bn_ntt_pow(uint32_t base, uint64_t exp, uint32_t p) {
+    uint64_t result = 1;
+    uint64_t power = base % p;
+    for (; exp; exp >>= 1) {
+        if (exp & 1) {
+            result = result * power % p;
+        }
+        power = power * power % p;
+    }
+    return result;
+}
+
+static bn_NttPrime bn_ntt_prime(uint32_t p) {
+    // Newton iteration doubles the correct low bits of the inverse
+    uint32_t inv = p;
+    for (int i = 0; i < 4; i++) {
+        inv *= 2 - p * inv;
+    }
+    uint64_t r = ((uint64_t)1 << 32) % p;
+    bn_NttPrime prime = { p, -inv, r * r % p };
+    return prime;
+}
+
+// Writes the powers w^j of a primitive 2h-th root of unity w (or of its
+// inverse) to `roots[h + j]` in Montgomery form for all j < h and all powers
+// of two h < `n`. Butterflies on 2h coefficients use the h consecutive
+// entries from `roots[h]` on.
+static void bn_ntt_roots(uint32_t *roots, size_t n, bn_NttPrime prime, int inverse) {
+    uint32_t one = bn_ntt_mul(1, prime.r_squared, prime);
+    for (size_t h = 1; h < n; h *= 2) {
+        uint32_t w = bn_ntt_pow(3, (prime.p - 1) / (2 * h), prime.p);
+        if (inverse) {
+            w = bn_ntt_pow(w, prime.p - 2, prime.p);
+        }
+        w = bn_ntt_mul(w, prime.r_squared, prime);
+        roots[h] = one;
+        for (size_t j = 1; j < h; j++) {
+            roots[h + j] = bn_ntt_mul(roots[h + j - 1], w, prime);
+        }
+    }
+}
+
+// Forward transform of the `n` coefficients at `a` (decimation in
+// frequency). The output is in bit-reversed order.
+static void bn_ntt_forward(uint32_t *a, size_t n, const uint32_t *roots, bn_NttPrime prime) {
+    if (n > BN_NTT_BLOCK) {
+        size_t h = n / 2;
+        for (size_t j = 0; j < h; j++) {
+            uint32_t x = a[j];
+            uint32_t y = a[j + h];
+            a[j] = bn_ntt_add(x, y, prime);
+            a[j + h] = bn_ntt_mul(bn_ntt_sub(x, y, prime), roots[h + j], prime);
+        }
+        bn_ntt_forward(a, h, roots, prime);
+        bn_ntt_forward(a + h, h, roots, prime);
+        return;
+    }
+    for (size_t h = n / 2; h > 0; h /= 2) {
+        for (size_t start = 0; start < n; start += 2 * h) {
+            uint32_t *block = a + start;
+            for (size_t j = 0; j < h; j++) {
+                uint32_t x = block[j];
+                uint32_t y = block[j + h];
+                block[j] = bn_ntt_add(x, y, prime);
+                block[j + h] = bn_ntt_mul(bn_ntt_sub(x, y, prime), roots[h + j], prime);
+            }
+        }
+    }
+}
+
+// Inverse of `bn_ntt_forward` with the inverse roots (decimation in time),
+// but without the division by `n`. The input is in bit-reversed order.
+static void bn_ntt_inverse(uint32_t *a, size_t n, const uint32_t *roots, bn_NttPrime prime) {
+    if (n > BN_NTT_BLOCK) {
+        size_t h = n / 2;
+        bn_ntt_inverse(a, h, roots, prime);
+        bn_ntt_inverse(a + h, h, roots, prime);
+        for (size_t j = 0; j < h; j++) {
+            uint32_t x = a[j];
+            uint32_t y = bn_ntt_mul(a[j + h], roots[h + j], prime);
+            a[j] = bn_ntt_add(x, y, prime);
+            a[j + h] = bn_ntt_sub(x, y, prime);
+        }
+        return;
+    }
+    for (size_t h = 1; h < n; h *= 2) {
+        for (size_t start = 0; start < n; start += 2 * h) {
+            uint32_t *block = a + start;
+            for (size_t j = 0; j < h; j++) {
+                uint32_t x = block[j];
+                uint32_t y = bn_ntt_mul(block[j + h], roots[h + j], prime);
+                block[j] = bn_ntt_add(x, y, prime);
+                block[j + h] = bn_ntt_sub(x, y, prime);
+            }
+        }
+    }
+}
+
+// Writes the 32-bit coefficients of the `len` blocks at `a` to the `n`
+// entries of `coefficients` in Montgomery form, padded with zeros
+static void bn_ntt_load(uint32_t *coefficients, size_t n, bn_block_t *a, size_t len, bn_NttPrime prime) {
+    size_t words = len * BN_NTT_WORDS;
+    for (size_t i = 0; i < words; i++) {
+        uint32_t word = a[i / BN_NTT_WORDS] >> (32 * (i % BN_NTT_WORDS));
+        coefficients[i] = bn_ntt_mul(word, prime.r_squared, prime);
+    }
+    memset(coefficients + words, 0, (n - words) * sizeof(uint32_t));
+}
+
+// Returns whether `bn_multiply_ntt` supports operands of `a_len` and `b_len`
+// blocks
+static int bn_ntt_fits(size_t a_len, size_t b_len) {
+    return (a_len + b_len) * BN_NTT_WORDS <= ((size_t)1 << BN_NTT_MAX_LOG);
+}
+
+// Writes the product of `a` and `b` to the `a_len` + `b_len` blocks at
+// `result` with three number-theoretic transforms and the Chinese remainder
+// theorem. `bn_ntt_fits(a_len, b_len)` must hold. Squares (`a` == `b`) need
+// one forward transform less. Only one prime is worked on at a time, so the
+// temporary memory is six words per coefficient.
+static void bn_multiply_ntt(bn_block_t *result, bn_block_t *a, size_t a_len, bn_block_t *b, size_t b_len) {
+    size_t coefficients = (a_len + b_len) * BN_NTT_WORDS;
+    size_t n = 1;
+    while (n < coefficients - 1) {
+        n *= 2;
+    }
+    int square = a == b && a_len == b_len;
+
+    // The residues of the convolution for each prime, the transformed `b`
+    // and the roots
+    size_t scratch_len = 6 * n;
+    uint32_t *scratch = bn_scratch_alloc(scratch_len * sizeof(uint32_t));
+    uint32_t *residues[3] = { scratch, scratch + n, scratch + 2 * n };
+    uint32_t *b_transformed = scratch + 3 * n;
+    uint32_t *roots = scratch + 4 * n;
+    uint32_t *inverse_roots = scratch + 5 * n;
+
+    static const uint32_t moduli[3] = { 167772161, 469762049, 998244353 };
+    bn_NttPrime primes[3];
+    for (int i = 0; i < 3; i++) {
+        bn_NttPrime prime = bn_ntt_prime(moduli[i]);
+        primes[i] = prime;
+        bn_ntt_roots(roots, n, prime, 0);
+        bn_ntt_roots(inverse_roots, n, prime, 1);
+
+        uint32_t *c = residues[i];
+        bn_ntt_load(c, n, a, a_len, prime);
+        bn_ntt_forward(c, n, roots, prime);
+        if (square) {
+            for (size_t j = 0; j < n; j++) {
+                c[j] = bn_ntt_mul(c[j], c[j], prime);
+            }
+        } else {
+            bn_ntt_load(b_transformed, n, b, b_len, prime);
+            bn_ntt_forward(b_transformed, n, roots, prime);
+            for (size_t j = 0; j < n; j++) {
+                c[j] = bn_ntt_mul(c[j], b_transformed[j], prime);
+            }
+        }
+        bn_ntt_inverse(c, n, inverse_roots, prime);
+
+        // The coefficients are c * n * 2^32 now. Multiplying by n^-1 in
+        // Montgomery form removes both factors.
+        uint32_t n_inv = bn_ntt_pow(n % prime.p, prime.p - 2, prime.p);
+        for (size_t j = 0; j < n; j++) {
+            c[j] = bn_ntt_mul(c[j], n_inv, prime);
+        }
+    }
+
+    // Garner's algorithm: x = r1 + p1 * t2 + p1 * p2 * t3 with
+    // t2 = (r2 - r1) / p1 mod p2 and t3 = (r3 - r1 - p1 * t2) / (p1 * p2) mod p3.
+    // The constants are in Montgomery form, and t3 is computed from the
+    // reductions 2^-32 * r3 and 2^-32 * x12, which only contributes 2^-32.
+    bn_NttPrime p2 = primes[1];
+    bn_NttPrime p3 = primes[2];
+    uint64_t p12 = (uint64_t)moduli[0] * moduli[1];
+    uint32_t p1_inv = bn_ntt_mul(bn_ntt_pow(moduli[0], moduli[1] - 2, moduli[1]), p2.r_squared, p2);
+    uint32_t p12_inv = bn_ntt_pow(p12 % moduli[2], moduli[2] - 2, moduli[2]);
+    p12_inv = bn_ntt_mul(bn_ntt_mul(p12_inv, p3.r_squared, p3), p3.r_squared, p3);
+
+    uint64_t carry = 0;
+    for (size_t i = 0; i < coefficients; i++) {
+        uint64_t x12 = 0;
+        uint32_t t3 = 0;
+        if (i < n) {
+            uint32_t r1 = residues[0][i];
+            uint32_t t2 = bn_ntt_mul(bn_ntt_sub(residues[1][i], r1, p2), p1_inv, p2);
+            x12 = r1 + (uint64_t)moduli[0] * t2;
+            uint32_t difference = bn_ntt_sub(bn_ntt_reduce(residues[2][i], p3), bn_ntt_reduce(x12, p3), p3);
+            t3 = bn_ntt_mul(difference, p12_inv, p3);
+        }
+
+        // x + carry = x12 + t3 * p12_low + t3 * p12_high * 2^32 + carry
+        uint64_t low = (uint64_t)t3 * (uint32_t)p12;
+        uint64_t high = (uint64_t)t3 * (p12 >> 32);
+        uint64_t word = (x12 & 0xFFFFFFFF) + (low & 0xFFFFFFFF) + (carry & 0xFFFFFFFF);
+        carry = (word >> 32) + (x12 >> 32) + (low >> 32) + high + (carry >> 32);
+
+        if (i % BN_NTT_WORDS == 0) {
+            result[i / BN_NTT_WORDS] = 0;
+        }
+        result[i / BN_NTT_WORDS] |= (bn_block_t)(uint32_t)word << (32 * (i % BN_NTT_WORDS));
+    }
+
+    bn_scratch_free(scratch, scratch_len * sizeof(uint32_t));
+}
+
+// Writes the product of `a` and `b` to the `a_len` + `b_len` blocks at
+// `result`, which may not overlap the operands. Chooses an algorithm based on
+// the operand lengths. `scratch` must hold at least
+// `bn_multiply_scratch_len(max(a_len, b_len))` blocks.
+static void bn_multiply_blocks(bn_block_t *result, bn_block_t *a, size_t a_len, bn_block_t *b, size_t b_len, bn_block_t *scratch) {
+    if (a_len < b_len) {
+        bn_block_t *tmp = a;
+        a = b;
+        b = tmp;
+        size_t tmp_len = a_len;
+        a_len = b_len;
+        b_len = tmp_len;
+    }
+
+    if (b_len < bn_karatsuba_threshold) {
+        bn_multiply_schoolbook(result, a, a_len, b, b_len);
+    } else if (b_len >= bn_ntt_threshold && bn_ntt_fits(a_len, b_len)) {
+        bn_multiply_ntt(result, a, a_len, b, b_len);
+    } else if (2 * b_len <= a_len) {
+        // Very unbalanced operands are split into pieces of `b_len` blocks.
+        // Each piece is multiplied by `b` and added to the result.
+        bn_block_t *product = scratch;
+        bn_block_t *rest = scratch + 2 * b_len;
+        memset(result, 0, (a_len + b_len) * sizeof(bn_block_t));
+        for (size_t offset = 0; offset < a_len; offset += b_len) {
+            size_t piece_len = a_len - offset < b_len ? a_len - offset : b_len;
+            bn_multiply_blocks(product, a + offset, piece_len, b, b_len, rest);
+            bn_blocks_add(result + offset, result + offset, a_len + b_len - offset, product, piece_len + b_len);
+        }
+    } else if (b_len >= bn_toom3_threshold && b_len > 2 * ((a_len + 2) / 3)) {
+        bn_multiply_toom3(result, a, a_len, b, b_len, scratch);
+    } else {
+        bn_multiply_karatsuba(result, a, a_len, b, b_len, scratch);
+    }
+}
+
+// Writes the product of `n1` and `n2` to `result`, which must have a len of at
+// least n1->len + n2->len and must not alias `n1` or `n2`.
+static void bn_multiply_unaliased(BigNum *result, BigNum *n1, BigNum *n2) {
+    size_t longer_len = n1->len > n2->len ? n1->len : n2->len;
+    size_t scratch_len = bn_multiply_scratch_len(longer_len);
+    bn_block_t *scratch = scratch_len ? bn_scratch_alloc(scratch_len * sizeof(bn_block_t)) : NULL;
+    bn_multiply_blocks(result->data, n1->data, n1->len, n2->data, n2->len, scratch);
+    bn_scratch_free(scratch, scratch_len * sizeof(bn_block_t));
+}
+
+void bn_set_div_threshold(size_t len) {
+    // The recursion splits the divisor in halves, which need at least two
+    // blocks for the base case
+    bn_div_threshold = len < 4 ? 4 : len;
+}
+
+void bn_set_mul_thresholds(size_t karatsuba, size_t toom3, size_t ntt) {
+    // Karatsuba needs at least a few blocks to make progress when recursing
+    bn_karatsuba_threshold = karatsuba < 8 ? 8 : karatsuba;
+    bn_toom3_threshold = toom3 < bn_karatsuba_threshold ? bn_karatsuba_threshold : toom3;
+    bn_ntt_threshold = ntt < bn_toom3_threshold ? bn_toom3_threshold : ntt;
+}
+
+BigNum *bn_multiply_into(BigNum *dst, BigNum *n1, BigNum *n2) {
+    BN_STATS_SCOPE(BN_STATS_MULTIPLY, n1->len > n2->len ? n1->len : n2->len);
+    // New number is at most n1->len + n2->len long. We can trim the result at
+    // the end as in `bn_add` (maybe we need to trim more than one block).
+    size_t result_len = n1->len + n2->len;
+
+    if (dst == n1 || dst == n2) {
+        // The operands are read multiple times, so the product can't be built
+        // in place.
+        BigNum *result = bn_with_len(result_len);
+        bn_multiply_unaliased(result, n1, n2);
+        bn_move(dst, &result);
+    } else {
+        bn_resize(dst, result_len);
+        bn_multiply_unaliased(dst, n1, n2);
+    }
+
+    bn_trim(dst);
+
+    return dst;
+}
+
+BigNum *bn_multiply_assign(BigNum *acc, BigNum *n) {
+    return bn_multiply_into(acc, acc, n);
+}
+
+BigNum *bn_multiply(BigNum *n1, BigNum *n2) {
+    BN_STATS_SCOPE(BN_STATS_MULTIPLY, n1->len > n2->len ? n1->len : n2->len);
+    BigNum *result = bn_with_len(n1->len + n2->len);
+    bn_multiply_unaliased(result, n1, n2);
+    bn_trim(result);
+    return result;
+}
+
+// Adds (or subtracts if `subtract` is set) the product of `a` and `b` to the
+// `len` blocks at `result` row by row, so that no product is stored anywhere.
+// `len` must be at least `a_len` + `b_len` and `result` must not overlap the
+// operands. Returns the carry (or borrow) out of the most significant block.
+static bn_block_t bn_blocks_addmul_rows(bn_block_t *result, size_t len, bn_block_t *a, size_t a_len, bn_block_t *b, size_t b_len, int subtract) {
+    bn_block_t out = 0;
+    for (size_t i = 0; i < b_len; i++) {
+        if (subtract) {
+            bn_block_t borrow = bn_blocks_mul_sub(result + i, a, a_len, b[i]);
+            out |= bn_blocks_decrement(result + i + a_len, len - i - a_len, borrow);
+        } else {
+            bn_block_t carry = bn_blocks_mul_add(result + i, a, a_len, b[i]);
+            out |= bn_blocks_increment(result + i + a_len, len - i - a_len, carry);
+        }
+    }
+    return out;
+}
+
+// Writes the product of `n1` and `n2` to new scratch space and its length to
+// `*len`. The scratch space has to be freed with `bn_scratch_free(product,
+// *size)`.
+static bn_block_t *bn_multiply_to_scratch(BigNum *n1, BigNum *n2, size_t *len, size_t *size) {
+    size_t product_len = n1->len + n2->len;
+    size_t longer_len = n1->len > n2->len ? n1->len : n2->len;
+    *size = (product_len + bn_multiply_scratch_len(longer_len)) * sizeof(bn_block_t);
+    bn_block_t *product = bn_scratch_alloc(*size);
+    bn_multiply_blocks(product, n1->data, n1->len, n2->data, n2->len, product + product_len);
+    while (product_len > 1 && product[product_len - 1] == 0) {
+        product_len--;
+    }
+    *len = product_len;
+    return product;
+}
+
+BigNum *bn_addmul(BigNum *acc, BigNum *a, BigNum *b) {
+    if (a->len < b->len) {
+        BigNum *tmp = a;
+        a = b;
+        b = tmp;
+    }
+    size_t product_len = a->len + b->len;
+    size_t len = (acc->len > product_len ? acc->len : product_len) + 1;
+
+    if (acc == a || acc == b || b->len >= bn_karatsuba_threshold) {
+        // The rows would overwrite blocks of an operand that aliases `acc`,
+        // and long operands are multiplied faster than row by row
+        size_t size;
+        bn_block_t *product = bn_multiply_to_scratch(a, b, &product_len, &size);
+        bn_resize(acc, len);
+        bn_blocks_add(acc->data, acc->data, len, product, product_len);
+        bn_scratch_free(product, size);
+    } else {
+        bn_resize(acc, len);
+        bn_blocks_addmul_rows(acc->data, len, a->data, a->len, b->data, b->len, 0);
+    }
+
+    bn_trim(acc);
+    return acc;
+}
+
+BigNum *bn_submul(BigNum *acc, BigNum *a, BigNum *b) {
+    if (a->len < b->len) {
+        BigNum *tmp = a;
+        a = b;
+        b = tmp;
+    }
+    if (bn_is_zero(b)) {
+        return acc;
+    }
+    // The product is at least B^(a->len + b->len - 2)
+    size_t acc_len = acc->len;
+    if (a->len + b->len - 1 > acc_len) {
+        return NULL;
+    }
+
+    if (acc == a || acc == b || b->len >= bn_karatsuba_threshold) {
+        size_t product_len, size;
+        bn_block_t *product = bn_multiply_to_scratch(a, b, &product_len, &size);
+        bn_block_t *result = acc->data;
+        int less = product_len > acc_len || (product_len == acc_len && bn_blocks_compare(result, product, acc_len) < 0);
+        if (!less) {
+            bn_blocks_sub(result, result, acc_len, product, product_len);
+            bn_trim(acc);
+        }
+        bn_scratch_free(product, size);
+        return less ? NULL : acc;
+    }
+
+    // The product may have one block more than `acc`
+    size_t len = acc_len + 1;
+    bn_resize(acc, len);
+    if (bn_blocks_addmul_rows(acc->data, len, a->data, a->len, b->data, b->len, 1)) {
+        // The difference went negative. Adding the product back restores
+        // `acc`, since both passes wrap modulo B^len.
+        bn_blocks_addmul_rows(acc->data, len, a->data, a->len, b->data, b->len, 0);
+        bn_trim(acc);
+        return NULL;
+    }
+    bn_trim(acc);
+    return acc;
+}
+
+BigNum *bn_addmul_u32(BigNum *acc, BigNum *a, uint32_t m) {
+    size_t a_len = a->len;
+    size_t len = (acc->len > a_len ? acc->len : a_len) + 1;
+    // A single row reads each block of `a` right before it writes the block of
+    // `acc` with the same offset, so `acc` may alias `a`. `a` is only read
+    // after the resize, which may move its data.
+    bn_resize(acc, len);
+    bn_block_t *result = acc->data;
+    bn_block_t carry = bn_blocks_mul_add(result, a->data, a_len, m);
+    bn_blocks_increment(result + a_len, len - a_len, carry);
+    bn_trim(acc);
+    return acc;
+}
+
+// Additions that an accumulator can take between normalizations. Each adds
+// less than 2^32 to every slot and a normalized slot is less than 2^32, so a
+// slot can't overflow before.
+#define BN_ACCUMULATOR_MAX_ADDITIONS 0xffffffff
+
+// Amount of 32-bit digits of an accumulator per block
+#define BN_ACCUMULATOR_DIGITS (BN_BLOCK_BITS / 32)
+
+bn_Accumulator *bn_accumulator_new() {
+    const bn_Allocator *allocator = bn_current_allocator();
+    bn_Accumulator *acc = bn_allocate(allocator, sizeof(bn_Accumulator));
+    acc->slots = NULL;
+    acc->len = 0;
+    acc->capacity = 0;
+    acc->additions = 0;
+    acc->allocator = allocator;
+    return acc;
+}
+
+void bn_accumulator_destroy(bn_Accumulator **acc) {
+    const bn_Allocator *allocator = (*acc)->allocator;
+    if ((*acc)->slots) {
+        bn_deallocate(allocator, (*acc)->slots, (*acc)->capacity * sizeof(uint64_t));
+    }
+    bn_deallocate(allocator, *acc, sizeof(bn_Accumulator));
+    *acc = NULL;
+}
+
+void bn_accumulator_reset(bn_Accumulator *acc) {
+    acc->len = 0;
+    acc->additions = 0;
+}
+
+// Makes `acc` at least `len` slots long. New slots are 0.
+static void bn_accumulator_extend(bn_Accumulator *acc, size_t len) {
+    if (len <= acc->len) {
+        return;
+    }
+    if (len > acc->capacity) {
+        // Grow exponentially, so that slowly growing sums don't reallocate
+        // each time
+        size_t capacity = 2 * acc->capacity > len ? 2 * acc->capacity : len;
+        const bn_Allocator *allocator = acc->allocator;
+        uint64_t *slots = bn_allocate(allocator, capacity * sizeof(uint64_t));
+        if (acc->slots) {
+            memcpy(slots, acc->slots, acc->len * sizeof(uint64_t));
+            bn_deallocate(allocator, acc->slots, acc->capacity * sizeof(uint64_t));
+        }
+        acc->slots = slots;
+        acc->capacity = capacity;
+    }
+    memset(acc->slots + acc->len, 0, (len - acc->len) * sizeof(uint64_t));
+    acc->len = len;
+}
+
+// Propagates the carries of all slots of `acc`, so that each is less than
+// 2^32 again
+static void bn_accumulator_normalize(bn_Accumulator *acc) {
+    // A slot is at most (2^32 - 1) * 2^32 and the carry into it less than
+    // 2^32, so the sum can't overflow
+    uint64_t carry = 0;
+    for (size_t i = 0; i < acc->len; i++) {
+        uint64_t sum = acc->slots[i] + carry;
+        acc->slots[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+    if (carry) {
+        bn_accumulator_extend(acc, acc->len + 1);
+        acc->slots[acc->len - 1] = carry;
+    }
+    acc->additions = 0;
+}
+
+// Normalizes `acc` if `additions` more additions would exceed its headroom
+static void bn_accumulator_make_room(bn_Accumulator *acc, uint64_t additions) {
+    if (acc->additions + additions > BN_ACCUMULATOR_MAX_ADDITIONS) {
+        bn_accumulator_normalize(acc);
+    }
+    acc->additions += additions;
+}
+
+void bn_accumulator_add(bn_Accumulator *acc, BigNum *n) {
+    bn_accumulator_make_room(acc, 1);
+    bn_accumulator_extend(acc, n->len * BN_ACCUMULATOR_DIGITS);
+
+    uint64_t *slots = acc->slots;
+    bn_block_t *data = n->data;
+    for (size_t i = 0; i < n->len; i++) {
+#if BN_BLOCK_BITS == 64
+        slots[2 * i] += (uint32_t)data[i];
+        slots[2 * i + 1] += data[i] >> 32;
+#else
+        slots[i] += data[i];
+#endif
+    }
+}
+
+// Adds `a` * `m` * 2^(32 * `offset`) to `acc`. The low half of each digit
+// product goes to the slot of the digit and the high half to the next slot,
+// which counts as two additions.
+static void bn_accumulator_addmul_row(bn_Accumulator *acc, BigNum *a, uint32_t m, size_t offset) {
+    bn_accumulator_make_room(acc, 2);
+    bn_accumulator_extend(acc, offset + a->len * BN_ACCUMULATOR_DIGITS + 1);
+
+    uint64_t *slots = acc->slots + offset;
+    bn_block_t *data = a->data;
+    for (size_t i = 0; i < a->len * BN_ACCUMULATOR_DIGITS; i++) {
+#if BN_BLOCK_BITS == 64
+        uint64_t product = (uint64_t)(uint32_t)(data[i / 2] >> (32 * (i % 2))) * m;
+#else
+        uint64_t product = (uint64_t)data[i] * m;
+#endif
+        slots[i] += (uint32_t)product;
+        slots[i + 1] += product >> 32;
+    }
+}
+
+void bn_accumulator_addmul_u32(bn_Accumulator *acc, BigNum *a, uint32_t m) {
+    bn_accumulator_addmul_row(acc, a, m, 0);
+}
+
+void bn_accumulator_addmul(bn_Accumulator *acc, BigNum *a, BigNum *b) {
+    bn_block_t *data = b->data;
+    for (size_t j = 0; j < b->len * BN_ACCUMULATOR_DIGITS; j++) {
+#if BN_BLOCK_BITS == 64
+        uint32_t digit = data[j / 2] >> (32 * (j % 2));
+#else
+        uint32_t digit = data[j];
+#endif
+        if (digit) {
+            bn_accumulator_addmul_row(acc, a, digit, j);
+        }
+    }
+}
+
+BigNum *bn_accumulator_value_into(BigNum *dst, bn_Accumulator *acc) {
+    bn_accumulator_normalize(acc);
+
+    size_t len = (acc->len + BN_ACCUMULATOR_DIGITS - 1) / BN_ACCUMULATOR_DIGITS;
+    bn_resize(dst, len ? len : 1);
+    bn_block_t *data = dst->data;
+    data[0] = 0;
+    for (size_t i = 0; i < len; i++) {
+#if BN_BLOCK_BITS == 64
+        uint64_t high = 2 * i + 1 < acc->len ? acc->slots[2 * i + 1] : 0;
+        data[i] = acc->slots[2 * i] | high << 32;
+#else
+        data[i] = acc->slots[i];
+#endif
+    }
+    bn_trim(dst);
+    return dst;
+}
+
+BigNum *bn_accumulator_value(bn_Accumulator *acc) {
+    return bn_accumulator_value_into(bn_zero(), acc);
+}
+
+static void bn_square_blocks(bn_block_t *result, bn_block_t *a, size_t len, bn_block_t *scratch);
+
+// Writes the square of `a` to the 2 * `len` blocks at `result` using the
+// schoolbook method. Each product a[i] * a[j] with i != j is only computed
+// once and doubled afterwards.
+static void bn_square_schoolbook(bn_block_t *result, bn_block_t *a, size_t len) {
+    // Sum of a[i] * a[j] for i < j. As in `bn_multiply_schoolbook`, the carry
+    // of each row is the first block that no earlier row has written.
+    memset(result, 0, (len + 1) * sizeof(bn_block_t));
+    for (size_t i = 0; i + 1 < len; i++) {
+        result[i + len] = bn_blocks_mul_add(result + 2 * i + 1, a + i + 1, len - i - 1, a[i]);
+    }
+    result[2 * len - 1] = 0;
+
+    // The sum is less than B^(2 * len) / 2, so doubling it can't overflow
+    bn_blocks_shift_left(result, result, 2 * len, 1);
+
+    // Add the diagonal a[i] * a[i]
+    bn_dblock_t carry = 0;
+    for (size_t i = 0; i < len; i++) {
+        bn_dblock_t product = (bn_dblock_t)a[i] * a[i];
+        bn_dblock_t sum = (bn_dblock_t)result[2 * i] + (bn_block_t)product + carry;
+        result[2 * i] = sum;
+        carry = sum >> BN_BLOCK_BITS;
+        sum = (bn_dblock_t)result[2 * i + 1] + (bn_block_t)(product >> BN_BLOCK_BITS) + carry;
+        result[2 * i + 1] = sum;
+        carry = sum >> BN_BLOCK_BITS;
+    }
+}
+
+// Writes the square of `a` to the 2 * `len` blocks at `result` using
+// Karatsuba's method. With a = a1 * B^h + a0, the square is
+// a1^2 * B^2h + ((a0 + a1)^2 - a0^2 - a1^2) * B^h + a0^2.
+static void bn_square_karatsuba(bn_block_t *result, bn_block_t *a, size_t len, bn_block_t *scratch) {
+    size_t h = len / 2;
+    size_t a1_len = len - h;
+
+    bn_square_blocks(result, a, h, scratch);
+    bn_square_blocks(result + 2 * h, a + h, a1_len, scratch);
+
+    size_t sum_len = a1_len + 1;
+    bn_block_t *sum = scratch;
+    bn_block_t *middle = sum + sum_len;
+    size_t middle_len = 2 * sum_len;
+    bn_block_t *rest = middle + middle_len;
+
+    sum[a1_len] = bn_blocks_add(sum, a + h, a1_len, a, h);
+    bn_square_blocks(middle, sum, sum_len, rest);
+    bn_blocks_sub(middle, middle, middle_len, result, 2 * h);
+    bn_blocks_sub(middle, middle, middle_len, result + 2 * h, 2 * a1_len);
+
+    size_t result_rest = 2 * len - h;
+    bn_blocks_add(result + h, result + h, result_rest, middle, middle_len < result_rest ? middle_len : result_rest);
+}
+
+// Writes the square of `a` to the 2 * `len` blocks at `result`, which may not
+// overlap `a`. `scratch` must hold at least `bn_multiply_scratch_len(len)`
+// blocks.
+static void bn_square_blocks(bn_block_t *result, bn_block_t *a, size_t len, bn_block_t *scratch) {
+    if (len < bn_karatsuba_threshold) {
+        bn_square_schoolbook(result, a, len);
+    } else if (len >= bn_ntt_threshold && bn_ntt_fits(len, len)) {
+        bn_multiply_ntt(result, a, len, a, len);
+    } else if (len >= bn_toom3_threshold) {
+        bn_multiply_toom3(result, a, len, a, len, scratch);
+    } else {
+        bn_square_karatsuba(result, a, len, scratch);
+    }
+}
+
+// Writes the square of `n` to `result`, which must have a len of at least
+// 2 * n->len and must not alias `n`.
+static void bn_square_unaliased(BigNum *result, BigNum *n) {
+    size_t scratch_len = bn_multiply_scratch_len(n->len);
+    bn_block_t *scratch = scratch_len ? bn_scratch_alloc(scratch_len * sizeof(bn_block_t)) : NULL;
+    bn_square_blocks(result->data, n->data, n->len, scratch);
+    bn_scratch_free(scratch, scratch_len * sizeof(bn_block_t));
+}
+
+BigNum *bn_square_into(BigNum *dst, BigNum *n) {
+    BN_STATS_SCOPE(BN_STATS_SQUARE, n->len);
+    size_t result_len = 2 * n->len;
+
+    if (dst == n) {
+        BigNum *result = bn_with_len(result_len);
+        bn_square_unaliased(result, n);
+        bn_move(dst, &result);
+    } else {
+        bn_resize(dst, result_len);
+        bn_square_unaliased(dst, n);
+    }
+
+    bn_trim(dst);
+
+    return dst;
+}
+
+BigNum *bn_square(BigNum *n) {
+    BN_STATS_SCOPE(BN_STATS_SQUARE, n->len);
+    BigNum *result = bn_with_len(2 * n->len);
+    bn_square_unaliased(result, n);
+    bn_trim(result);
+    return result;
+}
+
+// Divides the normalized dividend `un` (`u_len` + 1 blocks) by the normalized
+// divisor `vn` (`v_len` blocks), using Knuth's Algorithm D (TAOCP Vol. 2,
+// 4.3.1). Normalized means that the most significant bit of `vn` is set. The
+// `u_len` - `v_len` + 1 blocks of the quotient are written to `q`, unless `q`
+// is a null pointer. The normalized remainder is left in the lower `v_len`
+// blocks of `un`.
+static void bn_divide_normalized(bn_block_t *q, bn_block_t *un, size_t u_len, bn_block_t *vn, size_t v_len) {
+    bn_block_t v_top = vn[v_len - 1];
+
+    if (v_len == 1) {
+        // A single block divisor can be divided out directly, since each step
+        // divides a double block by a block.
+        bn_dblock_t rem = un[u_len];
+        for (size_t _offset = u_len; _offset > 0; _offset--) {
+            size_t offset = _offset - 1;
+            bn_dblock_t num = (rem << BN_BLOCK_BITS) | un[offset];
+            if (q) {
+                q[offset] = num / v_top;
+            }
+            rem = num % v_top;
+        }
+        un[0] = rem;
+        return;
+    }
+
+    bn_block_t v_second = vn[v_len - 2];
+
+    for (size_t _j = u_len - v_len + 1; _j > 0; _j--) {
+        size_t j = _j - 1;
+        bn_block_t *u_window = un + j;
+
+        // Estimate the quotient block from the top two blocks of the current
+        // remainder. Because `vn` is normalized, the estimate is at most 2
+        // too large and the correction loop fixes almost all of these cases.
+        bn_dblock_t num = ((bn_dblock_t)u_window[v_len] << BN_BLOCK_BITS) | u_window[v_len - 1];
+        bn_dblock_t q_hat = num / v_top;
+        bn_dblock_t r_hat = num % v_top;
+        while (q_hat > BN_BLOCK_MAX || q_hat * v_second > ((r_hat << BN_BLOCK_BITS) | u_window[v_len - 2])) {
+            q_hat--;
+            r_hat += v_top;
+            if (r_hat > BN_BLOCK_MAX) {
+                break;
+            }
+        }
+
+        // Multiply and subtract q_hat * vn from the current window
+        bn_block_t borrow = bn_blocks_mul_sub(u_window, vn, v_len, q_hat);
+        bn_block_t top = u_window[v_len];
+        u_window[v_len] = top - borrow;
+
+        // The subtraction went negative, so q_hat was still one too large. Add
+        // the divisor back once.
+        if (top < borrow) {
+            q_hat--;
+            u_window[v_len] += bn_blocks_add(u_window, u_window, v_len, vn, v_len);
+        }
+
+        if (q) {
+            q[j] = q_hat;
+        }
+    }
+}
+
+static bn_block_t bn_divide_dc(bn_block_t *q, bn_block_t *un, bn_block_t *vn, size_t n, bn_block_t *scratch);
+
+// Computes the `k` (at most `n`) quotient blocks of the `n` + `k` blocks at
+// `un` divided by the normalized `n` blocks at `vn`, following Burnikel and
+// Ziegler. The quotient is estimated from the top 2 * `k` blocks of `un` and
+// the top `k` blocks of `vn`, which is at most 2 too large, and then corrected
+// with the product of the estimate and the lower `n` - `k` blocks of `vn`.
+// Writes the quotient to `q` and returns the carry out of its most
+// significant block. The remainder is left in the lower `n` blocks of `un`.
+// `scratch` must hold `n` + `bn_multiply_scratch_len(n)` blocks.
+static bn_block_t bn_divide_dc_part(bn_block_t *q, size_t k, bn_block_t *un, bn_block_t *vn, size_t n, bn_block_t *scratch) {
+    bn_block_t qh = bn_divide_dc(q, un + n - k, vn + n - k, k, scratch);
+    bn_block_t *product = scratch;
+    bn_multiply_blocks(product, vn, n - k, q, k, scratch + n);
+
+    // Both subtractions wrap modulo B^n, so `cy` counts how many times the
+    // divisor has to be added back
+    bn_block_t cy = bn_blocks_sub(un, un, n, product, n);
+    if (qh) {
+        cy += bn_blocks_sub(un + k, un + k, n - k, vn, n - k);
+    }
+    while (cy) {
+        qh -= bn_blocks_decrement(q, k, 1);
+        cy -= bn_blocks_add(un, un, n, vn, n);
+    }
+    return qh;
+}
+
+// Divides the 2 * `n` blocks at `un` by the normalized `n` blocks at `vn` and
+// writes the lower `n` blocks of the quotient to `q`. Returns the most
+// significant block of the quotient, which is 0 or 1. The remainder is left in
+// the lower `n` blocks of `un`. Above `bn_div_threshold` blocks each half of
+// the quotient is computed by `bn_divide_dc_part`, so the division mostly
+// consists of multiplications of half the length. `scratch` must hold `n` +
+// `bn_multiply_scratch_len(n)` blocks.
+static bn_block_t bn_divide_dc(bn_block_t *q, bn_block_t *un, bn_block_t *vn, size_t n, bn_block_t *scratch) {
+    if (n < bn_div_threshold) {
+        bn_block_t qh = bn_blocks_compare(un + n, vn, n) >= 0;
+        if (qh) {
+            bn_blocks_sub(un + n, un + n, n, vn, n);
+        }
+        bn_divide_normalized(q, un, 2 * n - 1, vn, n);
+        return qh;
+    }
+
+    size_t lo = n / 2;
+    size_t hi = n - lo;
+    bn_block_t qh = bn_divide_dc_part(q + lo, hi, un + lo, vn, n, scratch);
+    bn_divide_dc_part(q, lo, un, vn, n, scratch);
+    return qh;
+}
+
+// Divides the normalized dividend `un` (`u_len` + 1 blocks) by the normalized
+// divisor `vn` (`v_len` blocks) like `bn_divide_normalized`, but computes the
+// quotient in pieces of `v_len` blocks with `bn_divide_dc`.
+static void bn_divide_bz(bn_block_t *q, bn_block_t *un, size_t u_len, bn_block_t *vn, size_t v_len) {
+    size_t q_len = u_len - v_len + 1;
+    size_t scratch_len = v_len + bn_multiply_scratch_len(v_len) + (q ? 0 : q_len);
+    bn_block_t *scratch = bn_scratch_alloc(scratch_len * sizeof(bn_block_t));
+    if (!q) {
+        // The quotient is needed for the corrections
+        q = scratch + scratch_len - q_len;
+    }
+
+    // The top `v_len` blocks of each window are the remainder of the previous
+    // one, so they are less than `vn` and the quotient of each window fits
+    // into `v_len` blocks
+    size_t offset = q_len;
+    while (offset >= v_len) {
+        offset -= v_len;
+        bn_divide_dc(q + offset, un + offset, vn, v_len, scratch);
+    }
+    if (offset >= bn_div_threshold) {
+        bn_divide_dc_part(q, offset, un, vn, v_len, scratch);
+    } else if (offset) {
+        bn_divide_normalized(q, un, v_len + offset - 1, vn, v_len);
+    }
+
+    bn_scratch_free(scratch, scratch_len * sizeof(bn_block_t));
+}
+
+// Writes the quotient and the remainder of the division `n1` / `n2` to
+// `quotient` and `remainder`. Either of them may be a null pointer if the
+// caller is not interested in it. `quotient` and `remainder` may alias `n1` or
+// `n2`, but not each other. `n2` must not be 0.
+static void bn_divide_with_remainder_unchecked(BigNum *quotient, BigNum *remainder, BigNum *n1, BigNum *n2) {
+    BN_STATS_SCOPE(BN_STATS_DIVIDE, n1->len);
+    if (bn_less_than(n1, n2)) {
+        // Set the remainder first, since `quotient` may alias `n1`
+        if (remainder && remainder != n1) {
+            bn_resize(remainder, n1->len);
+            memcpy(remainder->data, n1->data, n1->len * sizeof(bn_block_t));
+        }
+        if (quotient) {
+            bn_resize(quotient, 1);
+            bn_write_block(quotient, 0, 0);
+        }
+        return;
+    }
+
+    size_t u_len = n1->len;
+    size_t v_len = n2->len;
+
+    // The normalized dividend gets one extra block, the normalized divisor is
+    // stored right after it.
+    size_t scratch_len = u_len + 1 + v_len;
+    bn_block_t *scratch = bn_scratch_alloc(scratch_len * sizeof(bn_block_t));
+    bn_block_t *un = scratch;
+    bn_block_t *vn = scratch + u_len + 1;
+
+    // Shift both operands left, so that the most significant bit of the
+    // divisor is set. This doesn't change the quotient and the remainder can
+    // be shifted back at the end.
+    bn_block_t *u = n1->data;
+    bn_block_t *v = n2->data;
+    int shift = bn_block_clz(v[v_len - 1]);
+    if (shift) {
+        bn_blocks_shift_left(vn, v, v_len, shift);
+        un[u_len] = bn_blocks_shift_left(un, u, u_len, shift);
+    } else {
+        memcpy(vn, v, v_len * sizeof(bn_block_t));
+        memcpy(un, u, u_len * sizeof(bn_block_t));
+        un[u_len] = 0;
+    }
+
+    // The operands are not needed anymore, so the results can be written even
+    // if they alias them.
+    bn_block_t *q = NULL;
+    if (quotient) {
+        bn_resize(quotient, u_len - v_len + 1);
+        q = quotient->data;
+    }
+
+    if (v_len >= bn_div_threshold && u_len - v_len + 1 >= bn_div_threshold) {
+        bn_divide_bz(q, un, u_len, vn, v_len);
+    } else {
+        bn_divide_normalized(q, un, u_len, vn, v_len);
+    }
+
+    if (quotient) {
+        bn_trim(quotient);
+    }
+
+    if (remainder) {
+        bn_resize(remainder, v_len);
+        bn_block_t *r = remainder->data;
+        if (shift) {
+            bn_blocks_shift_right(r, un, v_len, shift);
+        } else {
+            memcpy(r, un, v_len * sizeof(bn_block_t));
+        }
+        bn_trim(remainder);
+    }
+
+    bn_scratch_free(scratch, scratch_len * sizeof(bn_block_t));
+}
+
+bn_DivideWithRemainderResult *bn_divide_with_remainder(BigNum *n1, BigNum *n2) {
+    // Catch division by zero
+    if (bn_is_zero(n2)) {
+        return NULL;
+    }
+
+    bn_DivideWithRemainderResult *result = malloc(sizeof(bn_DivideWithRemainderResult));
+    result->quotient = bn_zero();
+    result->remainder = bn_zero();
+    bn_divide_with_remainder_unchecked(result->quotient, result->remainder, n1, n2);
+    return result;
+}
+
+BigNum *bn_divide(BigNum *n1, BigNum *n2) {
+    if (bn_is_zero(n2)) {
+        return NULL;
+    }
+    BigNum *quotient = bn_zero();
+    bn_divide_with_remainder_unchecked(quotient, NULL, n1, n2);
+    return quotient;
+}
+
+BigNum *bn_divide_into(BigNum *dst, BigNum *n1, BigNum *n2) {
+    if (bn_is_zero(n2)) {
+        return NULL;
+    }
+    bn_divide_with_remainder_unchecked(dst, NULL, n1, n2);
+    return dst;
+}
+
+BigNum *bn_divide_assign(BigNum *acc, BigNum *n) {
+    return bn_divide_into(acc, acc, n);
+}
+
+BigNum *bn_mod(BigNum *n1, BigNum *n2) {
+    if (bn_is_zero(n2)) {
+        return NULL;
+    }
+    BigNum *remainder = bn_zero();
+    bn_divide_with_remainder_unchecked(NULL, remainder, n1, n2);
+    return remainder;
+}
+
+BigNum *bn_mod_into(BigNum *dst, BigNum *n1, BigNum *n2) {
+    if (bn_is_zero(n2)) {
+        return NULL;
+    }
+    bn_divide_with_remainder_unchecked(NULL, dst, n1, n2);
+    return dst;
+}
+
+BigNum *bn_mod_assign(BigNum *acc, BigNum *n) {
+    return bn_mod_into(acc, acc, n);
+}
+
+BigNum *bn_add_u32_into(BigNum *dst, BigNum *n, uint32_t m) {
+    size_t len = n->len;
+    // As in `bn_add_into`, every block is read before it is written
+    bn_resize(dst, len + 1);
+    bn_block_t *data = n->data;
+    bn_block_t *result = dst->data;
+    bn_block_t transfer = m;
+    for (size_t offset = 0; offset < len; offset++) {
+        bn_block_t sum = data[offset] + transfer;
+        transfer = sum < transfer;
+        result[offset] = sum;
+    }
+    result[len] = transfer;
+    bn_trim(dst);
+    return dst;
+}
+
+BigNum *bn_add_u32(BigNum *n, uint32_t m) {
+    return bn_add_u32_into(bn_with_len(n->len + 1), n, m);
+}
+
+BigNum *bn_sub_u32_into(BigNum *dst, BigNum *n, uint32_t m) {
+    size_t len = n->len;
+    if (len == 1 && bn_get_block_unchecked(n, 0) < m) {
+        return NULL;
+    }
+    bn_resize(dst, len);
+    bn_block_t *data = n->data;
+    bn_block_t *result = dst->data;
+    bn_block_t borrow = m;
+    for (size_t offset = 0; offset < len; offset++) {
+        bn_block_t block = data[offset];
+        result[offset] = block - borrow;
+        borrow = block < borrow;
+    }
+    bn_trim(dst);
+    return dst;
+}
+
+BigNum *bn_sub_u32(BigNum *n, uint32_t m) {
+    if (n->len == 1 && bn_get_block_unchecked(n, 0) < m) {
+        return NULL;
+    }
+    return bn_sub_u32_into(bn_with_len(n->len), n, m);
+}
+
+BigNum *bn_mul_u32_into(BigNum *dst, BigNum *n, uint32_t m) {
+    size_t len = n->len;
+    bn_resize(dst, len + 1);
+    bn_block_t *data = n->data;
+    bn_block_t *result = dst->data;
+    bn_block_t carry = 0;
+    for (size_t offset = 0; offset < len; offset++) {
+        bn_dblock_t product = (bn_dblock_t)data[offset] * m + carry;
+        result[offset] = product;
+        carry = product >> BN_BLOCK_BITS;
+    }
+    result[len] = carry;
+    bn_trim(dst);
+    return dst;
+}
+
+BigNum *bn_mul_u32(BigNum *n, uint32_t m) {
+    return bn_mul_u32_into(bn_with_len(n->len + 1), n, m);
+}
+
+BigNum *bn_divmod_u32_into(BigNum *dst, BigNum *n, uint32_t d, uint32_t *remainder) {
+    if (d == 0) {
+        return NULL;
+    }
+    // The blocks are divided from the most significant one down, and each of
+    // them is read before the quotient block with the same offset is written
+    size_t len = n->len;
+    if (dst != n) {
+        bn_resize(dst, len);
+    }
+    bn_block_t rem = bn_blocks_divide_block(dst->data, n->data, len, d);
+    if (remainder) {
+        *remainder = rem;
+    }
+    bn_trim(dst);
+    return dst;
+}
+
+BigNum *bn_divmod_u32(BigNum *n, uint32_t d, uint32_t *remainder) {
+    if (d == 0) {
+        return NULL;
+    }
+    return bn_divmod_u32_into(bn_with_len(n->len), n, d, remainder);
+}
+
+uint32_t bn_mod_u32(BigNum *n, uint32_t d) {
+    if (d == 0) {
+        return 0;
+    }
+    bn_block_t *data = n->data;
+    bn_dblock_t rem = 0;
+    for (size_t _offset = n->len; _offset > 0; _offset--) {
+        size_t offset = _offset - 1;
+        rem = ((rem << BN_BLOCK_BITS) | data[offset]) % d;
+    }
+    return rem;
+}
+
+BigNum *bn_shift_left_into(BigNum *dst, BigNum *n, size_t bits) {
+    if (bn_is_zero(n)) {
+        bn_resize(dst, 1);
+        bn_write_block(dst, 0, 0);
+        return dst;
+    }
+
+    size_t len = n->len;
+    size_t blocks = bits / BN_BLOCK_BITS;
+    int shift = bits % BN_BLOCK_BITS;
+    // `n` may alias `dst`, so its data is only read after the resize. The
+    // blocks are moved up, so they are written from the most significant one
+    // down.
+    bn_resize(dst, len + blocks + 1);
+    bn_block_t *a = n->data;
+    bn_block_t *result = dst->data;
+    if (shift) {
+        result[len + blocks] = a[len - 1] >> (BN_BLOCK_BITS - shift);
+        for (size_t offset = len - 1; offset > 0; offset--) {
+            result[offset + blocks] = (a[offset] << shift) | (a[offset - 1] >> (BN_BLOCK_BITS - shift));
+        }
+        result[blocks] = a[0] << shift;
+    } else {
+        memmove(result + blocks, a, len * sizeof(bn_block_t));
+        result[len + blocks] = 0;
+    }
+    memset(result, 0, blocks * sizeof(bn_block_t));
+    bn_trim(dst);
+    return dst;
+}
+
+BigNum *bn_shift_left(BigNum *n, size_t bits) {
+    BigNum *result = bn_zero();
+    return bn_shift_left_into(result, n, bits);
+}
+
+BigNum *bn_shift_left_assign(BigNum *acc, size_t bits) {
+    return bn_shift_left_into(acc, acc, bits);
+}
+
+BigNum *bn_shift_right_into(BigNum *dst, BigNum *n, size_t bits) {
+    size_t len = n->len;
+    size_t blocks = bits / BN_BLOCK_BITS;
+    if (blocks >= len) {
+        bn_resize(dst, 1);
+        bn_write_block(dst, 0, 0);
+        return dst;
+    }
+
+    size_t result_len = len - blocks;
+    int shift = bits % BN_BLOCK_BITS;
+    // The blocks are moved down, so they can be written from the least
+    // significant one up even if `dst` aliases `n`. Shrinking `dst` first
+    // would cut off blocks of `n` that are still needed.
+    if (dst != n) {
+        bn_resize(dst, result_len);
+    }
+    bn_block_t *a = n->data;
+    bn_block_t *result = dst->data;
+    if (shift) {
+        bn_blocks_shift_right(result, a + blocks, result_len, shift);
+    } else {
+        memmove(result, a + blocks, result_len * sizeof(bn_block_t));
+    }
+    dst->len = result_len;
+    bn_trim(dst);
+    return dst;
+}
+
+BigNum *bn_shift_right(BigNum *n, size_t bits) {
+    BigNum *result = bn_zero();
+    return bn_shift_right_into(result, n, bits);
+}
+
+BigNum *bn_shift_right_assign(BigNum *acc, size_t bits) {
+    return bn_shift_right_into(acc, acc, bits);
+}
+
+BigNum *bn_and_into(BigNum *dst, BigNum *n1, BigNum *n2) {
+    size_t len = n1->len < n2->len ? n1->len : n2->len;
+    // The result is not longer than either operand, so shrinking `dst` keeps
+    // the blocks that are still read if it aliases one of them
+    bn_resize(dst, len);
+    bn_block_t *a = n1->data;
+    bn_block_t *b = n2->data;
+    bn_block_t *result = dst->data;
+    for (size_t offset = 0; offset < len; offset++) {
+        result[offset] = a[offset] & b[offset];
+    }
+    bn_trim(dst);
+    return dst;
+}
+
+BigNum *bn_and(BigNum *n1, BigNum *n2) {
+    BigNum *result = bn_zero();
+    return bn_and_into(result, n1, n2);
+}
+
+BigNum *bn_and_assign(BigNum *acc, BigNum *n) {
+    return bn_and_into(acc, acc, n);
+}
+
+// Writes `n1` | `n2`, or `n1` ^ `n2` if `xor` is set, to `dst`. The shorter
+// operand is extended with 0-blocks. `dst` may alias `n1` and/or `n2`.
+static void bn_bitwise_extending_into(BigNum *dst, BigNum *n1, BigNum *n2, int xor) {
+    size_t n1_len = n1->len;
+    size_t n2_len = n2->len;
+    size_t min_len = n1_len < n2_len ? n1_len : n2_len;
+    size_t max_len = n1_len < n2_len ? n2_len : n1_len;
+    // An operand that aliases `dst` is zero-extended by the resize, the others
+    // are only read within their length
+    bn_resize(dst, max_len);
+    bn_block_t *a = n1->data;
+    bn_block_t *b = n2->data;
+    bn_block_t *longer = n1_len < n2_len ? b : a;
+    bn_block_t *result = dst->data;
+    if (xor) {
+        for (size_t offset = 0; offset < min_len; offset++) {
+            result[offset] = a[offset] ^ b[offset];
+        }
+    } else {
+        for (size_t offset = 0; offset < min_len; offset++) {
+            result[offset] = a[offset] | b[offset];
+        }
+    }
+    if (longer != result) {
+        memcpy(result + min_len, longer + min_len, (max_len - min_len) * sizeof(bn_block_t));
+    }
+    bn_trim(dst);
+}
+
+BigNum *bn_or_into(BigNum *dst, BigNum *n1, BigNum *n2) {
+    bn_bitwise_extending_into(dst, n1, n2, 0);
+    return dst;
+}
+
+BigNum *bn_or(BigNum *n1, BigNum *n2) {
+    BigNum *result = bn_zero();
+    return bn_or_into(result, n1, n2);
+}
+
+BigNum *bn_or_assign(BigNum *acc, BigNum *n) {
+    return bn_or_into(acc, acc, n);
+}
+
+BigNum *bn_xor_into(BigNum *dst, BigNum *n1, BigNum *n2) {
+    bn_bitwise_extending_into(dst, n1, n2, 1);
+    return dst;
+}
+
+BigNum *bn_xor(BigNum *n1, BigNum *n2) {
+    BigNum *result = bn_zero();
+    return bn_xor_into(result, n1, n2);
+}
+
+BigNum *bn_xor_assign(BigNum *acc, BigNum *n) {
+    return bn_xor_into(acc, acc, n);
+}
+
+size_t bn_bit_length(BigNum *n) {
+    bn_block_t top = bn_get_block_unchecked(n, n->len - 1);
+    if (!top) {
+        return 0;
+    }
+    return n->len * BN_BLOCK_BITS - bn_block_clz(top);
+}
+
+int bn_test_bit(BigNum *n, size_t bit) {
+    return (bn_get_block(n, bit / BN_BLOCK_BITS) >> (bit % BN_BLOCK_BITS)) & 1;
+}
+
+// Returns the `count` (at most BN_BLOCK_BITS) bits of `n` starting at bit
+// `offset` as an integer. Bits beyond the end of `n` are 0.
+static bn_block_t bn_get_bits(BigNum *n, size_t offset, int count) {
+    size_t block_offset = offset / BN_BLOCK_BITS;
+    int bit_offset = offset % BN_BLOCK_BITS;
+    bn_dblock_t window = bn_get_block(n, block_offset);
+    window |= (bn_dblock_t)bn_get_block(n, block_offset + 1) << BN_BLOCK_BITS;
+    return (window >> bit_offset) & (((bn_dblock_t)1 << count) - 1);
+}
+
+size_t bn_trailing_zeros(BigNum *n) {
+    bn_block_t *data = n->data;
+    for (size_t offset = 0; offset < n->len; offset++) {
+        if (data[offset]) {
+            return offset * BN_BLOCK_BITS + bn_block_ctz(data[offset]);
+        }
+    }
+    return 0;
+}
+
+// Amount of bits of the leading parts that Lehmer's algorithm simulates the
+// Euclidean algorithm on. Two bits are left free in a double block for the
+// cofactors that are added to them.
+#define BN_LEHMER_BITS (2 * BN_BLOCK_BITS - 2)
+
+// Simulates steps of the Euclidean algorithm on the leading BN_LEHMER_BITS
+// bits `ah` and `bh` of a and b, as in Knuth's Algorithm L (TAOCP Vol. 2,
+// 4.5.2). A step is only taken if both bounds of the leading parts give the
+// same quotient, so it is also a step of the Euclidean algorithm on a and b.
+// It stops before any cofactor exceeds a block. Writes the magnitudes of the
+// cofactors to `m`, so that the next a and b are m[0] * a - m[1] * b and
+// m[3] * b - m[2] * a after an even amount of steps and m[1] * b - m[0] * a
+// and m[2] * a - m[3] * b after an odd amount. Returns the amount of steps.
+static size_t bn_lehmer_simulate(bn_dblock_t ah, bn_dblock_t bh, bn_block_t m[4]) {
+    bn_dblock_t a = 1, b = 0, c = 0, d = 1;
+    size_t steps = 0;
+    for (;; steps++) {
+        // The bounds of a are ah + A and ah + B and the bounds of b are bh + C
+        // and bh + D, where A and D are positive after an even amount of steps
+        // and B and C negative, and the other way around after an odd amount
+        int even = steps % 2 == 0;
+        bn_dblock_t a_low, a_high, b_low, b_high;
+        if (even) {
+            if (bh <= c || ah < b) {
+                break;
+            }
+            a_low = ah - b;
+            a_high = ah + a;
+            b_low = bh - c;
+            b_high = bh + d;
+        } else {
+            if (bh <= d || ah < a) {
+                break;
+            }
+            a_low = ah - a;
+            a_high = ah + b;
+            b_low = bh - d;
+            b_high = bh + c;
+        }
+        bn_dblock_t q = a_high / b_low;
+        // The leading part of the next b must not go negative either
+        if (q != a_low / b_high || q > ah / bh) {
+            break;
+        }
+        // The next cofactors have the opposite sign of the current ones, so
+        // their magnitudes are a + q * c and b + q * d
+        if ((c && q > (BN_BLOCK_MAX - a) / c) || (d && q > (BN_BLOCK_MAX - b) / d)) {
+            break;
+        }
+        bn_dblock_t next_c = a + q * c;
+        bn_dblock_t next_d = b + q * d;
+        a = c;
+        b = d;
+        c = next_c;
+        d = next_d;
+        bn_dblock_t next_bh = ah - q * bh;
+        ah = bh;
+        bh = next_bh;
+    }
+    m[0] = a;
+    m[1] = b;
+    m[2] = c;
+    m[3] = d;
+    return steps;
+}
+
+// Writes `mx` * `x` - `my` * `y`, which must not be negative, or `mx` * `x` +
+// `my` * `y` if `add` is set, to `dst`, which must not alias `x` or `y`.
+static void bn_lehmer_combine(BigNum *dst, BigNum *x, bn_block_t mx, BigNum *y, bn_block_t my, int add) {
+    size_t len = (x->len > y->len ? x->len : y->len) + 1;
+    bn_resize(dst, len);
+    memset(dst->data, 0, len * sizeof(bn_block_t));
+    bn_blocks_addmul_rows(dst->data, len, x->data, x->len, &mx, 1, 0);
+    bn_blocks_addmul_rows(dst->data, len, y->data, y->len, &my, 1, !add);
+    bn_trim(dst);
+}
+
+// Returns the leading BN_LEHMER_BITS bits of `n` from bit `offset` on.
+static bn_dblock_t bn_lehmer_leading_bits(BigNum *n, size_t offset) {
+    bn_dblock_t low = bn_get_bits(n, offset, BN_BLOCK_BITS);
+    bn_dblock_t high = bn_get_bits(n, offset + BN_BLOCK_BITS, BN_LEHMER_BITS - BN_BLOCK_BITS);
+    return (high << BN_BLOCK_BITS) | low;
+}
+
+// Computes the greatest common divisor of `n1` and `n2` with Lehmer's
+// algorithm and writes it to `gcd`. Each round replaces a and b by linear
+// combinations with cofactors of a block, which are found from their leading
+// bits and advance the Euclidean algorithm by about a block at once. If no
+// step can be simulated, a single division step is done instead. Unless `s` is
+// a null pointer, the magnitude of the cofactor s with `gcd` = s * `n1` + t *
+// `n2` is written to `s` and whether s is negative to `*s_negative`. `gcd` and
+// `s` may alias `n1` or `n2`, but not each other.
+static void bn_gcd_unchecked(BigNum *gcd, BigNum *n1, BigNum *n2, BigNum *s, int *s_negative) {
+    BN_STATS_SCOPE(BN_STATS_GCD, n1->len > n2->len ? n1->len : n2->len);
+    int swap = bn_less_than(n1, n2);
+    BigNum *a = bn_copy(swap ? n2 : n1);
+    BigNum *b = bn_copy(swap ? n1 : n2);
+    BigNum *next_a = bn_zero();
+    BigNum *next_b = bn_zero();
+    // Cofactors of `n1` in a and b. They alternate in sign, so only the
+    // magnitudes and the sign of the one of a are stored. If `n1` is the
+    // smaller number, it is b = 0 * n2 + 1 * n1.
+    BigNum *sa = NULL, *sb = NULL, *next_sa = NULL, *next_sb = NULL;
+    int sa_negative = swap;
+    if (s) {
+        sa = swap ? bn_zero() : bn_one();
+        sb = swap ? bn_one() : bn_zero();
+        next_sa = bn_zero();
+        next_sb = bn_zero();
+    }
+
+    while (!bn_is_zero(b)) {
+        size_t bits = bn_bit_length(a);
+        size_t offset = bits > BN_LEHMER_BITS ? bits - BN_LEHMER_BITS : 0;
+        bn_block_t m[4];
+        size_t steps = bn_lehmer_simulate(bn_lehmer_leading_bits(a, offset), bn_lehmer_leading_bits(b, offset), m);
+
+        BigNum *tmp;
+        if (steps == 0 || m[1] == 0) {
+            // Division step (a, b) = (b, a % b), where the quotient goes to
+            // `next_a` for the cofactors
+            bn_divide_with_remainder_unchecked(next_a, next_b, a, b);
+            if (s) {
+                // (sa, sb) = (sb, sa + q * sb)
+                bn_addmul(sa, next_a, sb);
+                tmp = sa;
+                sa = sb;
+                sb = tmp;
+                sa_negative = !sa_negative;
+            }
+            tmp = a;
+            a = b;
+            b = next_b;
+            next_b = tmp;
+            continue;
+        }
+
+        int even = steps % 2 == 0;
+        if (even) {
+            bn_lehmer_combine(next_a, a, m[0], b, m[1], 0);
+            bn_lehmer_combine(next_b, b, m[3], a, m[2], 0);
+        } else {
+            bn_lehmer_combine(next_a, b, m[1], a, m[0], 0);
+            bn_lehmer_combine(next_b, a, m[2], b, m[3], 0);
+        }
+        tmp = a;
+        a = next_a;
+        next_a = tmp;
+        tmp = b;
+        b = next_b;
+        next_b = tmp;
+
+        if (s) {
+            bn_lehmer_combine(next_sa, sa, m[0], sb, m[1], 1);
+            bn_lehmer_combine(next_sb, sa, m[2], sb, m[3], 1);
+            tmp = sa;
+            sa = next_sa;
+            next_sa = tmp;
+            tmp = sb;
+            sb = next_sb;
+            next_sb = tmp;
+            if (!even) {
+                sa_negative = !sa_negative;
+            }
+        }
+    }
+
+    bn_move(gcd, &a);
+    bn_destroy(&b);
+    bn_destroy(&next_a);
+    bn_destroy(&next_b);
+    if (s) {
+        bn_move(s, &sa);
+        *s_negative = sa_negative && !bn_is_zero(s);
+        bn_destroy(&sb);
+        bn_destroy(&next_sa);
+        bn_destroy(&next_sb);
+    }
+}
+
+BigNum *bn_gcd_into(BigNum *dst, BigNum *n1, BigNum *n2) {
+    bn_gcd_unchecked(dst, n1, n2, NULL, NULL);
+    return dst;
+}
+
+BigNum *bn_gcd(BigNum *n1, BigNum *n2) {
+    BigNum *result = bn_zero();
+    bn_gcd_unchecked(result, n1, n2, NULL, NULL);
+    return result;
+}
+
+BigNum *bn_gcdext(BigNum *n1, BigNum *n2, BigNum *x, BigNum *y) {
+    if (bn_is_zero(n1) || bn_is_zero(n2)) {
+        // gcd(n, 0) = n = 1 * n + 0 * 0
+        int n1_zero = bn_is_zero(n1);
+        int n2_zero = bn_is_zero(n2);
+        BigNum *gcd = bn_copy(n1_zero ? n2 : n1);
+        bn_resize(x, 1);
+        bn_write_block(x, 0, !n1_zero);
+        bn_resize(y, 1);
+        bn_write_block(y, 0, n1_zero && !n2_zero);
+        return gcd;
+    }
+
+    BigNum *gcd = bn_zero();
+    BigNum *s = bn_zero();
+    int s_negative;
+    bn_gcd_unchecked(gcd, n1, n2, s, &s_negative);
+
+    // gcd = s * n1 + t * n2, so x = s mod n2 / gcd. y follows from
+    // n1 * x - gcd = k * n2 as y = -k mod n1 / gcd. Only x = 0, which means
+    // that n2 divides n1, gives k = -1.
+    BigNum *n1_reduced = bn_with_len(n1->len);
+    BigNum *n2_reduced = bn_with_len(n2->len);
+    bn_divide_with_remainder_unchecked(n1_reduced, NULL, n1, gcd);
+    bn_divide_with_remainder_unchecked(n2_reduced, NULL, n2, gcd);
+    BigNum *result_x = bn_mod(s, n2_reduced);
+    if (s_negative && !bn_is_zero(result_x)) {
+        bn_subtract_into(result_x, n2_reduced, result_x);
+    }
+    BigNum *k;
+    if (bn_is_zero(result_x)) {
+        k = bn_from_uint32_t(!bn_is_one(n1_reduced));
+    } else {
+        k = bn_multiply(n1, result_x);
+        bn_subtract_assign(k, gcd);
+        bn_divide_with_remainder_unchecked(k, NULL, k, n2);
+        bn_mod_assign(k, n1_reduced);
+        if (!bn_is_zero(k)) {
+            bn_subtract_into(k, n1_reduced, k);
+        }
+    }
+
+    bn_move(x, &result_x);
+    bn_move(y, &k);
+    bn_destroy(&s);
+    bn_destroy(&n1_reduced);
+    bn_destroy(&n2_reduced);
+    return gcd;
+}
+
+BigNum *bn_modinv_into(BigNum *dst, BigNum *n, BigNum *mod) {
+    if (bn_is_zero(mod)) {
+        return NULL;
+    }
+    BigNum *x = bn_zero();
+    BigNum *y = bn_zero();
+    BigNum *gcd = bn_gcdext(n, mod, x, y);
+    int invertible = bn_is_one(gcd);
+    bn_destroy(&gcd);
+    bn_destroy(&y);
+    if (!invertible) {
+        bn_destroy(&x);
+        return NULL;
+    }
+    bn_move(dst, &x);
+    return dst;
+}
+
+BigNum *bn_modinv(BigNum *n, BigNum *mod) {
+    BigNum *result = bn_zero();
+    if (!bn_modinv_into(result, n, mod)) {
+        bn_destroy(&result);
+        return NULL;
+    }
+    return result;
+}
+
+bn_BarrettCtx *bn_barrett_ctx_new(BigNum *mod) {
+    if (bn_is_zero(mod)) {
+        return NULL;
+    }
+
+    // Allocated like the copy of `mod`, as in `bn_mont_ctx_new`
+    const bn_Allocator *allocator = bn_current_allocator();
+    bn_BarrettCtx *ctx = bn_allocate(allocator, sizeof(bn_BarrettCtx));
+    ctx->mod = bn_copy(mod);
+
+    // B^(2k) is a 1 followed by 2k 0-blocks
+    BigNum *power = bn_with_len(2 * mod->len + 1);
+    bn_write_block(power, 2 * mod->len, 1);
+    ctx->mu = bn_divide(power, mod);
+    bn_destroy(&power);
+
+    return ctx;
+}
+
+void bn_barrett_ctx_destroy(bn_BarrettCtx **ctx) {
+    const bn_Allocator *allocator = (*ctx)->mod->allocator;
+    bn_destroy(&(*ctx)->mod);
+    bn_destroy(&(*ctx)->mu);
+    bn_deallocate(allocator, *ctx, sizeof(bn_BarrettCtx));
+    *ctx = NULL;
+}
+
+// Returns the amount of scratch blocks that `bn_barrett_reduce` needs
+static size_t bn_barrett_scratch_len(bn_BarrettCtx *ctx) {
+    size_t k = ctx->mod->len;
+    return 2 * (2 * k + 3) + bn_multiply_scratch_len(k + 2);
+}
+
+// Writes `x` mod m to the k = m->len blocks at `result` for the 2k blocks at
+// `x` (Handbook of Applied Cryptography, algorithm 14.42). Small moduli only
+// compute the needed parts of the products. `scratch` must hold
+// `bn_barrett_scratch_len(ctx)` blocks.
+static void bn_barrett_reduce(bn_block_t *result, bn_block_t *x, bn_BarrettCtx *ctx, bn_block_t *scratch) {
+    size_t k = ctx->mod->len;
+    bn_block_t *m = ctx->mod->data;
+    bn_block_t *q2 = scratch;
+    bn_block_t *qm = q2 + 2 * k + 3;
+    bn_block_t *rest = qm + 2 * k + 3;
+
+    // q3 = floor(floor(x / B^(k - 1)) * mu / B^(k + 1)) is at most 2 less than
+    // floor(x / m) and has at most k + 1 blocks. mu has k + 1 blocks, or k + 2
+    // if m = B^(k - 1).
+    bn_block_t *q1 = x + k - 1;
+    bn_block_t *mu = ctx->mu->data;
+    size_t mu_len = ctx->mu->len;
+    bn_block_t *q3 = q2 + k + 1;
+    if (k + 1 < 4 * bn_karatsuba_threshold) {
+        // Only the blocks from k - 1 on are computed. The missing ones are
+        // less than k * B^k, so q3 is at most one less and r less than 4m.
+        memset(q2, 0, (k + 1 + mu_len) * sizeof(bn_block_t));
+        for (size_t i = 0; i <= k; i++) {
+            size_t j = i < k - 1 ? k - 1 - i : 0;
+            q2[i + mu_len] = bn_blocks_mul_add(q2 + i + j, mu + j, mu_len - j, q1[i]);
+        }
+
+        // Only the lower k + 1 blocks of q3 * m are needed
+        memset(qm, 0, k * sizeof(bn_block_t));
+        qm[k] = bn_blocks_mul_add(qm, m, k, q3[0]);
+        for (size_t i = 1; i <= k; i++) {
+            bn_blocks_mul_add(qm + i, m, k + 1 - i, q3[i]);
+        }
+    } else {
+        bn_multiply_blocks(q2, q1, k + 1, mu, mu_len, rest);
+        bn_multiply_blocks(qm, q3, k + 1, m, k, rest);
+    }
+
+    // r = x - q3 * m, computed modulo B^(k + 1) since it is less than 4m
+    bn_block_t *r = q2;
+    bn_blocks_sub(r, x, k + 1, qm, k + 1);
+    for (;;) {
+        int less = r[k] == 0;
+        if (less) {
+            less = 0;
+            for (size_t _i = k; _i > 0; _i--) {
+                size_t i = _i - 1;
+                if (r[i] != m[i]) {
+                    less = r[i] < m[i];
+                    break;
+                }
+            }
+        }
+        if (less) {
+            break;
+        }
+        bn_blocks_sub(r, r, k + 1, m, k);
+    }
+    memcpy(result, r, k * sizeof(bn_block_t));
+}
+
+// Writes the `len` blocks at `n` mod m to the k = m->len blocks at `result`.
+// Numbers with more than 2k blocks are reduced from the most significant
+// end, k blocks at a time. `scratch` must hold `bn_barrett_scratch_len(ctx)`
+// + 2k blocks.
+static void bn_barrett_mod_blocks(bn_block_t *result, bn_block_t *n, size_t len, bn_BarrettCtx *ctx, bn_block_t *scratch) {
+    size_t k = ctx->mod->len;
+    bn_block_t *x = scratch;
+    bn_block_t *rest = x + 2 * k;
+
+    size_t offset = len > 2 * k ? len - 2 * k : 0;
+    memcpy(x, n + offset, (len - offset) * sizeof(bn_block_t));
+    memset(x + len - offset, 0, (2 * k - (len - offset)) * sizeof(bn_block_t));
+    bn_barrett_reduce(result, x, ctx, rest);
+
+    while (offset > 0) {
+        size_t chunk_len = offset < k ? offset : k;
+        offset -= chunk_len;
+        memcpy(x, n + offset, chunk_len * sizeof(bn_block_t));
+        memcpy(x + chunk_len, result, k * sizeof(bn_block_t));
+        memset(x + chunk_len + k, 0, (k - chunk_len) * sizeof(bn_block_t));
+        bn_barrett_reduce(result, x, ctx, rest);
+    }
+}
+
+BigNum *bn_mod_ctx_into(BigNum *dst, BigNum *n, bn_BarrettCtx *ctx) {
+    size_t k = ctx->mod->len;
+    size_t scratch_len = 3 * k + bn_barrett_scratch_len(ctx);
+    bn_block_t *scratch = bn_scratch_alloc(scratch_len * sizeof(bn_block_t));
+    bn_block_t *result = scratch + 2 * k + bn_barrett_scratch_len(ctx);
+
+    bn_barrett_mod_blocks(result, n->data, n->len, ctx, scratch);
+    bn_resize(dst, k);
+    memcpy(dst->data, result, k * sizeof(bn_block_t));
+    bn_trim(dst);
+
+    bn_scratch_free(scratch, scratch_len * sizeof(bn_block_t));
+    return dst;
+}
+
+BigNum *bn_mod_ctx(BigNum *n, bn_BarrettCtx *ctx) {
+    return bn_mod_ctx_into(bn_with_len(ctx->mod->len), n, ctx);
+}
+
+BigNum *bn_mulmod_ctx_into(BigNum *dst, BigNum *n1, BigNum *n2, bn_BarrettCtx *ctx) {
+    size_t k = ctx->mod->len;
+    size_t product_len = n1->len + n2->len;
+    size_t longer_len = n1->len > n2->len ? n1->len : n2->len;
+    size_t multiply_scratch_len = bn_multiply_scratch_len(longer_len);
+    size_t reduce_scratch_len = 2 * k + bn_barrett_scratch_len(ctx);
+    size_t rest_len = multiply_scratch_len > reduce_scratch_len ? multiply_scratch_len : reduce_scratch_len;
+
+    // The product, the result and the scratch space of either step
+    size_t scratch_len = product_len + k + rest_len;
+    bn_block_t *scratch = bn_scratch_alloc(scratch_len * sizeof(bn_block_t));
+    bn_block_t *product = scratch;
+    bn_block_t *result = product + product_len;
+    bn_block_t *rest = result + k;
+
+    bn_multiply_blocks(product, n1->data, n1->len, n2->data, n2->len, rest);
+    bn_barrett_mod_blocks(result, product, product_len, ctx, rest);
+    bn_resize(dst, k);
+    memcpy(dst->data, result, k * sizeof(bn_block_t));
+    bn_trim(dst);
+
+    bn_scratch_free(scratch, scratch_len * sizeof(bn_block_t));
+    return dst;
+}
+
+BigNum *bn_mulmod_ctx(BigNum *n1, BigNum *n2, bn_BarrettCtx *ctx) {
+    return bn_mulmod_ctx_into(bn_with_len(ctx->mod->len), n1, n2, ctx);
+}
+
+// Returns the window size for a sliding window exponentiation with an
+// exponent of `bits` bits. Larger windows save multiplications, but need a
+// table of 2^(window size - 1) precomputed powers.
+static int bn_exp_window_bits(size_t bits) {
+    if (bits > 671) {
+        return 6;
+    } else if (bits > 239) {
+        return 5;
+    } else if (bits > 79) {
+        return 4;
+    } else if (bits > 23) {
+        return 3;
+    } else {
+        return 1;
+    }
+}
+
+// Finds the window of at most `window_bits` bits of `exp` that starts with the
+// set bit `top` and ends with a set bit. Returns the offset of the lowest bit
+// of the window and writes the (odd) value of the window to `value`.
+static size_t bn_exp_window(BigNum *exp, size_t top, int window_bits, size_t *value) {
+    size_t low = top + 1 >= (size_t)window_bits ? top + 1 - window_bits : 0;
+    while (!bn_test_bit(exp, low)) {
+        low++;
+    }
+    *value = bn_get_bits(exp, low, top - low + 1);
+    return low;
+}
+
+// Allocates a Montgomery context for the odd modulus `mod` with everything
+// but R^2 mod m
+static bn_MontCtx *bn_mont_ctx_alloc(BigNum *mod) {
+    // The context is allocated like the copy of `mod`, whose allocator then
+    // frees it again
+    const bn_Allocator *allocator = bn_current_allocator();
+    bn_MontCtx *ctx = bn_allocate(allocator, sizeof(bn_MontCtx));
+    ctx->mod = bn_copy(mod);
+    ctx->r_squared = NULL;
+
+    // Newton iteration for the inverse modulo 2^BN_BLOCK_BITS. Every odd number
+    // is its own inverse modulo 2^3 and each step doubles the amount of correct
+    // bits.
+    bn_block_t mod_0 = bn_get_block_unchecked(mod, 0);
+    bn_block_t inv = mod_0;
+    for (int correct_bits = 3; correct_bits < BN_BLOCK_BITS; correct_bits *= 2) {
+        inv *= 2 - mod_0 * inv;
+    }
+    ctx->mod_inv = -inv;
+
+    return ctx;
+}
+
+bn_MontCtx *bn_mont_ctx_new(BigNum *mod) {
+    if (!(bn_get_block_unchecked(mod, 0) & 1)) {
+        return NULL;
+    }
+
+    size_t len = mod->len;
+    bn_MontCtx *ctx = bn_mont_ctx_alloc(mod);
+
+    // R^2 = 2^(2 * BN_BLOCK_BITS * len), which is a 1 followed by 2 * len
+    // 0-blocks
+    BigNum *r_squared = bn_with_len(2 * len + 1);
+    bn_write_block(r_squared, 2 * len, 1);
+    bn_mod_assign(r_squared, mod);
+    // Montgomery multiplication expects operands of exactly `len` blocks
+    bn_resize(r_squared, len);
+    ctx->r_squared = r_squared;
+
+    return ctx;
+}
+
+void bn_mont_ctx_destroy(bn_MontCtx **ctx) {
+    const bn_Allocator *allocator = (*ctx)->mod->allocator;
+    bn_destroy(&(*ctx)->mod);
+    bn_destroy(&(*ctx)->r_squared);
+    bn_deallocate(allocator, *ctx, sizeof(bn_MontCtx));
+    *ctx = NULL;
+}
+
+// Writes `t` + `top` * B^len mod m to `result`, where `t` has `len` blocks and
+// the whole value is less than 2 * m. This is the last step of every
+// Montgomery reduction. The difference t - m is always computed and then
+// selected with a mask, so the running time doesn't depend on the values.
+// `result` may not alias `t`.
+static void bn_mont_final_subtract(bn_block_t *result, bn_block_t *t, bn_block_t top, bn_MontCtx *ctx) {
+    size_t len = ctx->mod->len;
+    bn_block_t *m = ctx->mod->data;
+
+    // The difference is negative if the subtraction borrows more than `top`
+    // provides. Then `t` is kept.
+    bn_block_t borrow = bn_blocks_sub(result, t, len, m, len);
+    bn_block_t mask = (bn_block_t)0 - (borrow & ~top & 1);
+    for (size_t j = 0; j < len; j++) {
+        result[j] ^= (result[j] ^ t[j]) & mask;
+    }
+}
+
+// Computes the Montgomery product a * b * R^-1 mod m of the `len` block
+// operands `a` and `b` and writes it to `result`, using the Coarsely
+// Integrated Operand Scanning (CIOS) method. Both operands must be less than
+// the modulus of `ctx`. `t` is scratch space of 2 * `len` + 2 blocks. `result`
+// may alias `a` or `b`.
+static void bn_mont_multiply(bn_block_t *result, bn_block_t *a, bn_block_t *b, bn_block_t *t, bn_MontCtx *ctx) {
+    size_t len = ctx->mod->len;
+    bn_block_t *m = ctx->mod->data;
+
+    memset(t, 0, (len + 2) * sizeof(bn_block_t));
+
+    // Instead of dividing the intermediate result by B after each step, the
+    // window `w` into `t` moves up by one block.
+    bn_block_t *w = t;
+    for (size_t i = 0; i < len; i++, w++) {
+        // w += a * b[i]
+        bn_block_t carry = bn_blocks_mul_add(w, a, len, b[i]);
+        bn_dblock_t sum = (bn_dblock_t)w[len] + carry;
+        w[len] = sum;
+        w[len + 1] = sum >> BN_BLOCK_BITS;
+
+        // w += q * m, where q is chosen so that the lowest block of w becomes 0
+        bn_block_t q = w[0] * ctx->mod_inv;
+        carry = bn_blocks_mul_add(w, m, len, q);
+        sum = (bn_dblock_t)w[len] + carry;
+        w[len] = sum;
+        w[len + 1] += sum >> BN_BLOCK_BITS;
+    }
+
+    bn_mont_final_subtract(result, w, w[len], ctx);
+}
+
+// Computes the Montgomery reduction t * R^-1 mod m of the 2 * `len` blocks at
+// `t` and writes the `len` blocks of the result to `result`. `t` must be less
+// than m * R and is destroyed.
+static void bn_mont_reduce(bn_block_t *result, bn_block_t *t, bn_MontCtx *ctx) {
+    size_t len = ctx->mod->len;
+    bn_block_t *m = ctx->mod->data;
+
+    // Add q * m * B^i for each block i, where q is chosen so that block i of
+    // t becomes 0. `top` is the carry out of block i + `len`.
+    bn_block_t top = 0;
+    for (size_t i = 0; i < len; i++) {
+        bn_block_t q = t[i] * ctx->mod_inv;
+        bn_block_t carry = bn_blocks_mul_add(t + i, m, len, q);
+        bn_dblock_t sum = (bn_dblock_t)t[i + len] + carry + top;
+        t[i + len] = sum;
+        top = sum >> BN_BLOCK_BITS;
+    }
+
+    bn_mont_final_subtract(result, t + len, top, ctx);
+}
+
+// Computes the Montgomery square a * a * R^-1 mod m of the `len` block operand
+// `a` and writes it to `result`. `t` is scratch space of 2 * `len` +
+// `bn_multiply_scratch_len(len)` blocks. `result` may alias `a`.
+static void bn_mont_square(bn_block_t *result, bn_block_t *a, bn_block_t *t, bn_MontCtx *ctx) {
+    size_t len = ctx->mod->len;
+    bn_square_blocks(t, a, len, t + 2 * len);
+    bn_mont_reduce(result, t, ctx);
+}
+
+// Same as `bn_mont_square`, but the running time doesn't depend on the value
+// of `a`. The schoolbook and Karatsuba squarings only add and subtract whole
+// rows, but Toom-Cook 3 and the NTT depend on signs and reductions of their
+// intermediate values, so longer operands use the Montgomery multiplication.
+static void bn_mont_square_ct(bn_block_t *result, bn_block_t *a, bn_block_t *t, bn_MontCtx *ctx) {
+    if (ctx->mod->len < bn_toom3_threshold) {
+        bn_mont_square(result, a, t, ctx);
+    } else {
+        bn_mont_multiply(result, a, a, t, ctx);
+    }
+}
+
+// Writes the Montgomery form n * R mod m of `n` to the `len` blocks at
+// `result`. Unlike `bn_mod`, the running time only depends on `n->len`: The
+// pieces c_k of `len` blocks of n are combined with Horner's scheme, as
+// (... (c_top * R + c_(top - 1)) * R + ...) * R. Since every piece is less
+// than R, the Montgomery multiplication by R^2 brings each piece into range.
+// `operand` is scratch space of `len` blocks and `t` of 2 * `len` + 2 blocks.
+static void bn_mont_convert_ct(bn_block_t *result, BigNum *n, bn_block_t *operand, bn_block_t *t, bn_MontCtx *ctx) {
+    size_t len = ctx->mod->len;
+    bn_block_t *r_squared = ctx->r_squared->data;
+
+    memset(result, 0, len * sizeof(bn_block_t));
+    for (size_t _k = (n->len + len - 1) / len; _k > 0; _k--) {
+        size_t offset = (_k - 1) * len;
+        size_t piece_len = n->len - offset < len ? n->len - offset : len;
+        memset(operand, 0, len * sizeof(bn_block_t));
+        memcpy(operand, (bn_block_t *)n->data + offset, piece_len * sizeof(bn_block_t));
+
+        // result = result * R + piece * R, where the sum is less than 2 * m
+        bn_mont_multiply(result, result, r_squared, t, ctx);
+        bn_mont_multiply(operand, operand, r_squared, t, ctx);
+        bn_block_t top = bn_blocks_add(t, result, len, operand, len);
+        bn_mont_final_subtract(result, t, top, ctx);
+    }
+}
+
+bn_MontCtx *bn_mont_ctx_new_ct(BigNum *mod) {
+    if (!(bn_get_block_unchecked(mod, 0) & 1)) {
+        return NULL;
+    }
+
+    size_t len = mod->len;
+    bn_MontCtx *ctx = bn_mont_ctx_alloc(mod);
+    size_t t_len = 2 * len + 2 + bn_multiply_scratch_len(len);
+    bn_block_t *t = bn_scratch_alloc((len + t_len) * sizeof(bn_block_t));
+    bn_block_t *shifted = t + t_len;
+
+    // Doubling 1 (or 0 for m = 1) BN_BLOCK_BITS * len + len times with one
+    // conditional subtraction each results in 2^len * R mod m, the Montgomery
+    // form of 2^len. Each squaring in Montgomery form doubles the exponent, so
+    // log2(BN_BLOCK_BITS) of them result in the Montgomery form of
+    // 2^(BN_BLOCK_BITS * len) = R, which is R^2 mod m.
+    ctx->r_squared = bn_with_len(len);
+    bn_block_t *x = ctx->r_squared->data;
+    x[0] = !bn_is_one(mod);
+    for (size_t i = 0; i < (BN_BLOCK_BITS + 1) * len; i++) {
+        bn_block_t top = bn_blocks_shift_left(shifted, x, len, 1);
+        bn_mont_final_subtract(x, shifted, top, ctx);
+    }
+    for (int bits = 1; bits < BN_BLOCK_BITS; bits *= 2) {
+        bn_mont_square_ct(x, x, t, ctx);
+    }
+
+    bn_scratch_free(t, (len + t_len) * sizeof(bn_block_t));
+    return ctx;
+}
+
+// Computes (`base` ^ `exp`) % m for the modulus of `ctx` with a sliding window
+// exponentiation in Montgomery form and writes it to `result`.
+static void bn_power_mod_ctx_unchecked(BigNum *result, BigNum *base, BigNum *exp, bn_MontCtx *ctx) {
+    BN_STATS_SCOPE(BN_STATS_POWER_MOD_CTX, ctx->mod->len);
+    size_t len = ctx->mod->len;
+
+    size_t exp_bits = bn_bit_length(exp);
+    int window_bits = bn_exp_window_bits(exp_bits);
+    size_t table_len = (size_t)1 << (window_bits - 1);
+
+    // Reduce the base and bring it to exactly `len` blocks
+    BigNum *reduced = bn_mod(base, ctx->mod);
+    bn_resize(reduced, len);
+
+    // Everything else is done in fixed-width scratch space: the odd powers of
+    // the base and the accumulator in Montgomery form, one operand for
+    // conversions and the scratch space of the multiplication and the
+    // squaring.
+    size_t t_len = 2 * len + 2 + bn_multiply_scratch_len(len);
+    size_t scratch_len = (table_len + 2) * len + t_len;
+    bn_block_t *scratch = bn_scratch_alloc(scratch_len * sizeof(bn_block_t));
+    bn_block_t *table = scratch;
+    bn_block_t *acc = table + table_len * len;
+    bn_block_t *operand = acc + len;
+    bn_block_t *t = operand + len;
+
+    // Convert the base to Montgomery form: base * R^2 * R^-1. Then fill the
+    // table with base^1, base^3, base^5, ...
+    bn_mont_multiply(table, reduced->data, ctx->r_squared->data, t, ctx);
+    bn_destroy(&reduced);
+    if (table_len > 1) {
+        bn_mont_square(acc, table, t, ctx);
+        for (size_t i = 1; i < table_len; i++) {
+            bn_mont_multiply(table + i * len, table + (i - 1) * len, acc, t, ctx);
+        }
+    }
+
+    memset(operand, 0, len * sizeof(bn_block_t));
+    operand[0] = 1;
+
+    if (exp_bits == 0) {
+        // 1 in Montgomery form is R mod m
+        bn_mont_multiply(acc, operand, ctx->r_squared->data, t, ctx);
+    }
+
+    int first_window = 1;
+    size_t bit = exp_bits;
+    while (bit > 0) {
+        if (!bn_test_bit(exp, bit - 1)) {
+            bn_mont_square(acc, acc, t, ctx);
+            bit--;
+            continue;
+        }
+
+        size_t value;
+        size_t low = bn_exp_window(exp, bit - 1, window_bits, &value);
+        bn_block_t *power = table + (value / 2) * len;
+        if (first_window) {
+            memcpy(acc, power, len * sizeof(bn_block_t));
+            first_window = 0;
+        } else {
+            for (size_t i = low; i < bit; i++) {
+                bn_mont_square(acc, acc, t, ctx);
+            }
+            bn_mont_multiply(acc, acc, power, t, ctx);
+        }
+        bit = low;
+    }
+
+    // Convert back from Montgomery form: acc * 1 * R^-1
+    bn_mont_multiply(acc, acc, operand, t, ctx);
+
+    bn_resize(result, len);
+    memcpy(result->data, acc, len * sizeof(bn_block_t));
+    bn_trim(result);
+
+    bn_scratch_free(scratch, scratch_len * sizeof(bn_block_t));
+}
+
+BigNum *bn_power_mod_ctx(BigNum *base, BigNum *exp, bn_MontCtx *ctx) {
+    BigNum *result = bn_with_len(ctx->mod->len);
+    bn_power_mod_ctx_unchecked(result, base, exp, ctx);
+    return result;
+}
+
+BigNum *bn_power_mod_ctx_into(BigNum *dst, BigNum *base, BigNum *exp, bn_MontCtx *ctx) {
+    // The operands are only read before `dst` is written, so it may alias
+    // them.
+    bn_power_mod_ctx_unchecked(dst, base, exp, ctx);
+    return dst;
+}
+
+// Copies the entry `index` of the `table_len` entries of `len` blocks at
+// `table` to `result`. Every entry is read, so the memory access pattern
+// doesn't depend on `index`.
+static void bn_table_select(bn_block_t *result, bn_block_t *table, size_t table_len, size_t len, size_t index) {
+    memset(result, 0, len * sizeof(bn_block_t));
+    for (size_t i = 0; i < table_len; i++) {
+        bn_block_t mask = (bn_block_t)0 - (bn_block_t)(i == index);
+        bn_block_t *entry = table + i * len;
+        for (size_t j = 0; j < len; j++) {
+            result[j] |= entry[j] & mask;
+        }
+    }
+}
+
+// Computes (`base` ^ `exp`) % m for the modulus of `ctx` with a fixed window
+// exponentiation in Montgomery form and writes it to `result`, treating `exp`
+// as a number of `exp_bits` bits, which must be at least `exp` bit length. The
+// running time only depends on `exp_bits`, `base->len` and the modulus. Only
+// the result is trimmed at the end.
+static void bn_power_mod_ctx_fixed_window_unchecked(BigNum *result, BigNum *base, BigNum *exp, size_t exp_bits, bn_MontCtx *ctx) {
+    size_t len = ctx->mod->len;
+
+    int window_bits = bn_exp_window_bits(exp_bits);
+    if (window_bits < 2) {
+        window_bits = 2;
+    }
+    size_t table_len = (size_t)1 << window_bits;
+
+    // All powers base^0 to base^(table_len - 1) in Montgomery form, the
+    // accumulator, the selected power and the multiplication scratch space
+    size_t t_len = 2 * len + 2 + bn_multiply_scratch_len(len);
+    size_t scratch_len = (table_len + 2) * len + t_len;
+    bn_block_t *scratch = bn_scratch_alloc(scratch_len * sizeof(bn_block_t));
+    bn_block_t *table = scratch;
+    bn_block_t *acc = table + table_len * len;
+    bn_block_t *power = acc + len;
+    bn_block_t *t = power + len;
+
+    memset(power, 0, len * sizeof(bn_block_t));
+    power[0] = 1;
+    bn_mont_multiply(table, power, ctx->r_squared->data, t, ctx);
+    bn_mont_convert_ct(table + len, base, power, t, ctx);
+    for (size_t i = 2; i < table_len; i++) {
+        bn_mont_multiply(table + i * len, table + (i - 1) * len, table + len, t, ctx);
+    }
+
+    // The most significant window may be shorter than the others
+    size_t num_windows = (exp_bits + window_bits - 1) / window_bits;
+    size_t offset = (num_windows - 1) * window_bits;
+    bn_table_select(acc, table, table_len, len, bn_get_bits(exp, offset, exp_bits - offset));
+
+    while (offset > 0) {
+        offset -= window_bits;
+        for (int i = 0; i < window_bits; i++) {
+            bn_mont_square_ct(acc, acc, t, ctx);
+        }
+        bn_table_select(power, table, table_len, len, bn_get_bits(exp, offset, window_bits));
+        bn_mont_multiply(acc, acc, power, t, ctx);
+    }
+
+    // Convert back from Montgomery form: acc * 1 * R^-1
+    memset(power, 0, len * sizeof(bn_block_t));
+    power[0] = 1;
+    bn_mont_multiply(acc, acc, power, t, ctx);
+
+    bn_resize(result, len);
+    memcpy(result->data, acc, len * sizeof(bn_block_t));
+    bn_trim(result);
+
+    bn_scratch_free(scratch, scratch_len * sizeof(bn_block_t));
+}
+
+BigNum *bn_power_mod_ctx_fixed_window(BigNum *base, BigNum *exp, bn_MontCtx *ctx) {
+    BigNum *result = bn_with_len(ctx->mod->len);
+    bn_power_mod_ctx_fixed_window_unchecked(result, base, exp, exp->len * BN_BLOCK_BITS, ctx);
+    return result;
+}
+
+// Amount of bits that the constant time exponentiations treat `exp` as: the
+// length of the modulus, or of `exp` if it is longer
+static size_t bn_power_mod_ct_bits(BigNum *exp, bn_MontCtx *ctx) {
+    size_t len = exp->len > ctx->mod->len ? exp->len : ctx->mod->len;
+    return len * BN_BLOCK_BITS;
+}
+
+BigNum *bn_power_mod_ctx_ct(BigNum *base, BigNum *exp, bn_MontCtx *ctx) {
+    BigNum *result = bn_with_len(ctx->mod->len);
+    bn_power_mod_ctx_fixed_window_unchecked(result, base, exp, bn_power_mod_ct_bits(exp, ctx), ctx);
+    return result;
+}
+
+BigNum *bn_power_mod_ctx_ct_into(BigNum *dst, BigNum *base, BigNum *exp, bn_MontCtx *ctx) {
+    // The operands are only read before `dst` is written, so it may alias
+    // them.
+    bn_power_mod_ctx_fixed_window_unchecked(dst, base, exp, bn_power_mod_ct_bits(exp, ctx), ctx);
+    return dst;
+}
+
+BigNum *bn_power_mod_ct_into(BigNum *dst, BigNum *base, BigNum *exp, BigNum *mod) {
+    bn_MontCtx *ctx = bn_mont_ctx_new_ct(mod);
+    if (!ctx) {
+        return NULL;
+    }
+    bn_power_mod_ctx_ct_into(dst, base, exp, ctx);
+    bn_mont_ctx_destroy(&ctx);
+    return dst;
+}
+
+BigNum *bn_power_mod_ct(BigNum *base, BigNum *exp, BigNum *mod) {
+    bn_MontCtx *ctx = bn_mont_ctx_new_ct(mod);
+    if (!ctx) {
+        return NULL;
+    }
+    BigNum *result = bn_power_mod_ctx_ct(base, exp, ctx);
+    bn_mont_ctx_destroy(&ctx);
+    return result;
+}
+
+// State of one base of `bn_multi_power_mod_ctx_unchecked`
+typedef struct bn_MultiPowerState {
+    // base^1, base^3, base^5, ... in Montgomery form
+    bn_block_t *table;
+    int window_bits;
+    // All bits of the exponent below `scan` are still to be looked at
+    size_t scan;
+    // Whether the window with the lowest bit `low` and the value `value` has
+    // yet to be multiplied into the accumulator
+    int pending;
+    size_t low;
+    size_t value;
+} bn_MultiPowerState;
+
+// Computes the product of (`bases[i]` ^ `exps[i]`) % m for the `count` items
+// and the modulus of `ctx` and writes it to `result`. All exponents are
+// scanned with sliding windows at the same time (Straus' method), so the
+// accumulator is only squared once per bit of the longest exponent.
+static void bn_multi_power_mod_ctx_unchecked(BigNum *result, BigNum **bases, BigNum **exps, size_t count, bn_MontCtx *ctx) {
+    size_t len = ctx->mod->len;
+
+    bn_MultiPowerState *states = bn_scratch_alloc(count * sizeof(bn_MultiPowerState));
+    size_t tables_len = 0;
+    size_t max_bits = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t bits = bn_bit_length(exps[i]);
+        states[i].window_bits = bn_exp_window_bits(bits);
+        states[i].scan = bits;
+        states[i].pending = 0;
+        tables_len += ((size_t)1 << (states[i].window_bits - 1)) * len;
+        if (bits > max_bits) {
+            max_bits = bits;
+        }
+    }
+
+    // The tables of all bases, the accumulator, one operand for conversions
+    // and the scratch space of the multiplication and the squaring
+    size_t t_len = 2 * len + 2 + bn_multiply_scratch_len(len);
+    size_t scratch_len = tables_len + 2 * len + t_len;
+    bn_block_t *scratch = bn_scratch_alloc(scratch_len * sizeof(bn_block_t));
+    bn_block_t *acc = scratch + tables_len;
+    bn_block_t *operand = acc + len;
+    bn_block_t *t = operand + len;
+
+    BigNum *reduced = bn_with_len(len);
+    bn_block_t *table = scratch;
+    for (size_t i = 0; i < count; i++) {
+        size_t table_len = (size_t)1 << (states[i].window_bits - 1);
+        states[i].table = table;
+        bn_mod_into(reduced, bases[i], ctx->mod);
+        bn_resize(reduced, len);
+        bn_mont_multiply(table, reduced->data, ctx->r_squared->data, t, ctx);
+        if (table_len > 1) {
+            bn_mont_square(acc, table, t, ctx);
+            for (size_t j = 1; j < table_len; j++) {
+                bn_mont_multiply(table + j * len, table + (j - 1) * len, acc, t, ctx);
+            }
+        }
+        table += table_len * len;
+    }
+    bn_destroy(&reduced);
+
+    memset(operand, 0, len * sizeof(bn_block_t));
+    operand[0] = 1;
+    // 1 in Montgomery form is R mod m
+    bn_mont_multiply(acc, operand, ctx->r_squared->data, t, ctx);
+
+    int first_window = 1;
+    for (size_t bit = max_bits; bit > 0; bit--) {
+        if (!first_window) {
+            bn_mont_square(acc, acc, t, ctx);
+        }
+        for (size_t i = 0; i < count; i++) {
+            bn_MultiPowerState *state = &states[i];
+            if (state->scan == bit) {
+                if (bn_test_bit(exps[i], bit - 1)) {
+                    state->low = bn_exp_window(exps[i], bit - 1, state->window_bits, &state->value);
+                    state->pending = 1;
+                    state->scan = state->low;
+                } else {
+                    state->scan = bit - 1;
+                }
+            }
+            if (state->pending && state->low == bit - 1) {
+                bn_block_t *power = state->table + (state->value / 2) * len;
+                if (first_window) {
+                    memcpy(acc, power, len * sizeof(bn_block_t));
+                    first_window = 0;
+                } else {
+                    bn_mont_multiply(acc, acc, power, t, ctx);
+                }
+                state->pending = 0;
+            }
+        }
+    }
+
+    // Convert back from Montgomery form: acc * 1 * R^-1
+    bn_mont_multiply(acc, acc, operand, t, ctx);
+
+    bn_resize(result, len);
+    memcpy(result->data, acc, len * sizeof(bn_block_t));
+    bn_trim(result);
+
+    bn_scratch_free(scratch, scratch_len * sizeof(bn_block_t));
+    bn_scratch_free(states, count * sizeof(bn_MultiPowerState));
 }
 
-// Returns the block with the `offset` from the start of the BigNum data. It
-// returns 0 if the offset is out of bounds.
-static uint32_t bn_get_block(BigNum *n, size_t offset) {
-    if (offset < n->len) {
-        return bn_get_block_unchecked(n, offset);
-    } else {
-        return 0;
-    }
+BigNum *bn_multi_power_mod_ctx(BigNum **bases, BigNum **exps, size_t count, bn_MontCtx *ctx) {
+    BigNum *result = bn_with_len(ctx->mod->len);
+    bn_multi_power_mod_ctx_unchecked(result, bases, exps, count, ctx);
+    return result;
 }
 
-// Writes the given `value` to the block with the given `offset`. This function
-// asserts that `offset` is in bounds.
-static inline void bn_write_block(BigNum *n, size_t offset, uint32_t value) {
-    assert(offset < n->len);
-    *((uint32_t *)n->data + offset) = value;
+BigNum *bn_multi_power_mod_ctx_into(BigNum *dst, BigNum **bases, BigNum **exps, size_t count, bn_MontCtx *ctx) {
+    // The operands are only read before `dst` is written, so it may alias
+    // them.
+    bn_multi_power_mod_ctx_unchecked(dst, bases, exps, count, ctx);
+    return dst;
 }
 
-// Trims all leading 0-blocks of `n`. This will trim `n` at most to len 1.
-static void bn_trim(BigNum *n) {
-    size_t trimmed_len = n->len;
-    uint32_t *block_ptr = (uint32_t *)n->data + n->len - 1;
-    while (trimmed_len > 1 && *block_ptr == 0) {
-        trimmed_len--;
-        block_ptr--;
-    }
-    if (trimmed_len < n->len) {
-        n->data = realloc(n->data, trimmed_len * sizeof(uint32_t));
-        n->len = trimmed_len;
+// Returns the window size for `bn_fixed_base_table_new` with exponents of up
+// to `bits` bits. An exponentiation with windows of w bits takes one
+// multiplication per window and 2^w more to combine them.
+static int bn_fixed_base_window_bits(size_t bits) {
+    int best = 1;
+    size_t best_cost = bits + 2;
+    for (int w = 2; w <= 16; w++) {
+        size_t cost = (bits + w - 1) / w + ((size_t)1 << w);
+        if (cost < best_cost) {
+            best = w;
+            best_cost = cost;
+        }
     }
+    return best;
 }
 
-// Adds the `value` to the big number `n` with the `offset`.
-//
-// The lower half of `value` is added to the block at `offset`. The overflow of
-// this addition is then accumulated with the higher half of `value` and added
-// to the next block of `n`. This continues until no overflow occurs when
-// adding the `value` to the block of `n`. The caller needs to make sure that
-// `n` is large enough to hold the result.
-static void bn_add_block_cascading_unchecked(BigNum *n, size_t offset, uint64_t value) {
-    if (value > 0) {
-        uint32_t lower_half = value;
-        uint32_t upper_half = value >> 32;
-
-        uint32_t block = bn_get_block_unchecked(n, offset);
-        // Cast to uint64_t necessary since both operands are uint32_t, but we
-        // don't want to lose the overflow.
-        uint64_t block_result_64 = (uint64_t)lower_half + block;
-        uint32_t block_result_32 = block_result_64;
-        bn_write_block(n, offset, block_result_32);
-
-        uint32_t block_overflow = block_result_64 >> 32;
-        uint64_t overflow = upper_half + block_overflow;
-        // Recursion stops when overflow is 0
-        bn_add_block_cascading_unchecked(n, offset + 1, overflow);
-    }
-}
-
-// Returns a pointer to a BigNum with the given `len`.
-static BigNum *bn_with_len(size_t len) {
-    BigNum *bn = malloc(sizeof(BigNum));
-    bn->len = len;
-    bn->data = calloc(len, sizeof(uint32_t));
-    return bn;
+bn_FixedBaseTable *bn_fixed_base_table_new(BigNum *base, size_t max_exp_bits, bn_MontCtx *ctx) {
+    size_t len = ctx->mod->len;
+    if (max_exp_bits == 0) {
+        max_exp_bits = 1;
+    }
+    int window_bits = bn_fixed_base_window_bits(max_exp_bits);
+    size_t count = (max_exp_bits + window_bits - 1) / window_bits;
+
+    // The table is allocated like its powers, whose allocator then frees it
+    // again
+    const bn_Allocator *allocator = bn_current_allocator();
+    bn_FixedBaseTable *table = bn_allocate(allocator, sizeof(bn_FixedBaseTable));
+    table->ctx = ctx;
+    table->window_bits = window_bits;
+    table->count = count;
+    table->powers = bn_with_len(count * len);
+
+    size_t t_len = 2 * len + 2 + bn_multiply_scratch_len(len);
+    bn_block_t *t = bn_scratch_alloc(t_len * sizeof(bn_block_t));
+
+    // base^(2^(w * i)) in Montgomery form, each from the previous one by w
+    // squarings
+    bn_block_t *powers = table->powers->data;
+    BigNum *reduced = bn_mod(base, ctx->mod);
+    bn_resize(reduced, len);
+    bn_mont_multiply(powers, reduced->data, ctx->r_squared->data, t, ctx);
+    bn_destroy(&reduced);
+    for (size_t i = 1; i < count; i++) {
+        bn_block_t *power = powers + i * len;
+        memcpy(power, power - len, len * sizeof(bn_block_t));
+        for (int j = 0; j < window_bits; j++) {
+            bn_mont_square(power, power, t, ctx);
+        }
+    }
+
+    bn_scratch_free(t, t_len * sizeof(bn_block_t));
+    return table;
 }
 
-void bn_destroy(BigNum **n) {
-    free((*n)->data);
-    free(*n);
-    *n = NULL;
+void bn_fixed_base_table_destroy(bn_FixedBaseTable **table) {
+    const bn_Allocator *allocator = (*table)->powers->allocator;
+    bn_destroy(&(*table)->powers);
+    bn_deallocate(allocator, *table, sizeof(bn_FixedBaseTable));
+    *table = NULL;
 }
 
-BigNum *bn_copy(BigNum *orig) {
-    if (!orig) {
+BigNum *bn_power_mod_fixed_base_into(BigNum *dst, BigNum *exp, bn_FixedBaseTable *table) {
+    int window_bits = table->window_bits;
+    size_t count = table->count;
+    if (bn_bit_length(exp) > count * window_bits) {
         return NULL;
     }
-    BigNum *copy = malloc(sizeof(BigNum));
-    copy->len = orig->len;
-    copy->data = malloc(copy->len * sizeof(uint32_t));
-    memcpy(copy->data, orig->data, copy->len * sizeof(uint32_t));
-    return copy;
-}
 
-BigNum *bn_zero() {
-    BigNum *bn = malloc(sizeof(BigNum));
-    bn->len = 1;
-    bn->data = calloc(1, sizeof(uint32_t));
-    return bn;
-}
+    bn_MontCtx *ctx = table->ctx;
+    size_t len = ctx->mod->len;
+    bn_block_t *powers = table->powers->data;
 
-BigNum *bn_one() {
-    BigNum *bn = malloc(sizeof(BigNum));
-    bn->len = 1;
-    bn->data = malloc(sizeof(uint32_t));
-    *((uint32_t *)bn->data) = 1;
-    return bn;
+    // exp = sum of digits[i] * 2^(w * i), so base^exp is the product of
+    // powers[i]^digits[i]. Yao's method collects the powers with the digit d
+    // in `partial` for d from the largest digit down to 1 and multiplies
+    // `partial` into `acc` for each d, which raises each power to its digit
+    // without any squarings.
+    size_t t_len = 2 * len + 2 + bn_multiply_scratch_len(len);
+    size_t scratch_len = 3 * len + t_len;
+    // The digits come first to keep them aligned
+    size_t *digits = bn_scratch_alloc(count * sizeof(size_t) + scratch_len * sizeof(bn_block_t));
+    bn_block_t *acc = (bn_block_t *)(digits + count);
+    bn_block_t *partial = acc + len;
+    bn_block_t *operand = partial + len;
+    bn_block_t *t = operand + len;
+
+    size_t max_digit = 0;
+    for (size_t i = 0; i < count; i++) {
+        digits[i] = bn_get_bits(exp, i * window_bits, window_bits);
+        if (digits[i] > max_digit) {
+            max_digit = digits[i];
+        }
+    }
+
+    int acc_one = 1;
+    int partial_one = 1;
+    for (size_t d = max_digit; d > 0; d--) {
+        for (size_t i = 0; i < count; i++) {
+            if (digits[i] != d) {
+                continue;
+            }
+            bn_block_t *power = powers + i * len;
+            if (partial_one) {
+                memcpy(partial, power, len * sizeof(bn_block_t));
+                partial_one = 0;
+            } else {
+                bn_mont_multiply(partial, partial, power, t, ctx);
+            }
+        }
+        if (acc_one) {
+            memcpy(acc, partial, len * sizeof(bn_block_t));
+            acc_one = 0;
+        } else {
+            bn_mont_multiply(acc, acc, partial, t, ctx);
+        }
+    }
+
+    memset(operand, 0, len * sizeof(bn_block_t));
+    operand[0] = 1;
+    if (acc_one) {
+        // exp = 0, and 1 in Montgomery form is R mod m
+        bn_mont_multiply(acc, operand, ctx->r_squared->data, t, ctx);
+    }
+    // Convert back from Montgomery form: acc * 1 * R^-1
+    bn_mont_multiply(acc, acc, operand, t, ctx);
+
+    bn_resize(dst, len);
+    memcpy(dst->data, acc, len * sizeof(bn_block_t));
+    bn_trim(dst);
+
+    bn_scratch_free(digits, count * sizeof(size_t) + scratch_len * sizeof(bn_block_t));
+    return dst;
 }
 
-BigNum *bn_from_uint32_t(uint32_t n) {
-    BigNum *bn = bn_zero();
-    uint32_t *data_ptr = bn->data;
-    *data_ptr = n;
-    return bn;
+BigNum *bn_power_mod_fixed_base(BigNum *exp, bn_FixedBaseTable *table) {
+    BigNum *result = bn_with_len(table->ctx->mod->len);
+    if (!bn_power_mod_fixed_base_into(result, exp, table)) {
+        bn_destroy(&result);
+        return NULL;
+    }
+    return result;
 }
 
-BigNum *bn_from_hex(const char *str) {
-    if (!str) {
+BigNum *bn_power_mod(BigNum *base, BigNum *exp, BigNum *mod) {
+    BN_STATS_SCOPE(BN_STATS_POWER_MOD, mod->len);
+    if (bn_is_zero(mod)) {
         return NULL;
     }
 
-    size_t num_chars = 0;
-    size_t num_hex_chars = 0;
-    for (const char *c = str; *c; c++) {
-        if ((*c >= '0' && *c <= '9') || (*c >= 'a' && *c <= 'f') || (*c >= 'A' && *c <= 'F')) {
-            num_hex_chars++;
-        } else if (*c != ' ') {
-            fprintf(stderr, "warning in bn_from_hex: found invalid hex char '%c' at pos %zu\n", *c, num_chars);
-            return NULL;
-        }
-        num_chars++;
+    // Odd moduli don't need any division in the main loop
+    bn_MontCtx *ctx = bn_mont_ctx_new(mod);
+    if (ctx) {
+        BigNum *result = bn_power_mod_ctx(base, exp, ctx);
+        bn_mont_ctx_destroy(&ctx);
+        return result;
     }
 
-    if (num_hex_chars == 0) {
-        return NULL;
+    size_t exp_bits = bn_bit_length(exp);
+    if (exp_bits == 0) {
+        return bn_one();
     }
 
-    size_t len = (num_hex_chars + 7) / 8;
-    BigNum *result = bn_with_len(len);
+    // Sliding window exponentiation as in `bn_power_mod_ctx_unchecked`, but
+    // every product is reduced with a division.
+    int window_bits = bn_exp_window_bits(exp_bits);
+    size_t table_len = (size_t)1 << (window_bits - 1);
 
-    uint32_t block = 0;
-    int hex_chars_read = 0;
-    size_t offset = 0;
+    BigNum *result = bn_zero();
+    // Holds the intermediate products, so they don't have to be allocated
+    // for every bit of `exp`.
+    BigNum *product = bn_zero();
 
-    for (const char *c = str + num_chars - 1; c >= str; c--) {
-        if (*c != ' ') {
-            uint32_t c_val;
-            if (*c >= '0' && *c <= '9') {
-                c_val =  *c - '0';
-            } else if (*c >= 'a' && *c <= 'f') {
-                c_val =  10 + *c - 'a';
-            } else {
-                c_val = 10 + *c - 'A';
-            }
-            block += (c_val << (4 * hex_chars_read));
-            hex_chars_read++;
+    // base^1, base^3, base^5, ...
+    BigNum **table = bn_scratch_alloc(table_len * sizeof(BigNum *));
+    table[0] = bn_mod(base, mod);
+    if (table_len > 1) {
+        bn_square_into(product, table[0]);
+        bn_mod_into(result, product, mod);
+        for (size_t i = 1; i < table_len; i++) {
+            bn_multiply_into(product, table[i - 1], result);
+            table[i] = bn_mod(product, mod);
+        }
+    }
 
-            if (hex_chars_read == 8) {
-                bn_write_block(result, offset, block);
-                block = 0;
-                hex_chars_read = 0;
-                offset++;
+    int first_window = 1;
+    size_t bit = exp_bits;
+    while (bit > 0) {
+        if (!bn_test_bit(exp, bit - 1)) {
+            bn_square_into(product, result);
+            bn_mod_into(result, product, mod);
+            bit--;
+            continue;
+        }
+
+        size_t value;
+        size_t low = bn_exp_window(exp, bit - 1, window_bits, &value);
+        BigNum *power = table[value / 2];
+        if (first_window) {
+            bn_resize(result, power->len);
+            memcpy(result->data, power->data, power->len * sizeof(bn_block_t));
+            first_window = 0;
+        } else {
+            for (size_t i = low; i < bit; i++) {
+                bn_square_into(product, result);
+                bn_mod_into(result, product, mod);
             }
+            bn_multiply_into(product, result, power);
+            bn_mod_into(result, product, mod);
         }
+        bit = low;
     }
 
-    if (hex_chars_read) {
-        bn_write_block(result, offset, block);
+    for (size_t i = 0; i < table_len; i++) {
+        bn_destroy(&table[i]);
     }
-
-    bn_trim(result);
+    bn_scratch_free(table, table_len * sizeof(BigNum *));
+    bn_destroy(&product);
 
     return result;
 }
 
-void bn_print_hex(BigNum *n) {
-    // size_t can't be negative, this we can't use offset >= 0 as condition.
-    // Because of that we count from `n->len` to 1 and use `offset - 1`.
-    for (size_t offset = n->len; offset > 0; offset--) {
-        printf("%08x ", *((uint32_t *)n->data + offset - 1));
+BigNum *bn_power_mod_into(BigNum *dst, BigNum *base, BigNum *exp, BigNum *mod) {
+    // `dst` may alias any of the operands, which are needed until the end.
+    BigNum *result = bn_power_mod(base, exp, mod);
+    if (!result) {
+        return NULL;
     }
-    printf("\n");
+    bn_move(dst, &result);
+    return dst;
 }
 
-int bn_compare(BigNum *n1, BigNum *n2) {
-    if (n1->len > n2->len) {
-        return 1;
-    } else if (n1->len < n2->len) {
-        return -1;
-    } else {
-        // Compare blocks, starting at the most significant block
-        for (size_t offset = n1->len; offset > 0; offset--) {
-            uint32_t n1_block = bn_get_block_unchecked(n1, offset - 1);
-            uint32_t n2_block = bn_get_block_unchecked(n2, offset - 1);
-            if (n1_block > n2_block) {
-                return 1;
-            } else if (n1_block < n2_block) {
-                return -1;
-            }
-        }
+BigNum *bn_multi_power_mod(BigNum **bases, BigNum **exps, size_t count, BigNum *mod) {
+    if (bn_is_zero(mod)) {
+        return NULL;
+    }
 
-        return 0;
+    bn_MontCtx *ctx = bn_mont_ctx_new(mod);
+    if (ctx) {
+        BigNum *result = bn_multi_power_mod_ctx(bases, exps, count, ctx);
+        bn_mont_ctx_destroy(&ctx);
+        return result;
     }
-}
 
-int bn_greater_than(BigNum *n1, BigNum *n2) {
-    return bn_compare(n1, n2) > 0;
+    // Even moduli multiply the single powers
+    BigNum *result = bn_one();
+    bn_mod_assign(result, mod);
+    BigNum *power = bn_zero();
+    for (size_t i = 0; i < count; i++) {
+        bn_power_mod_into(power, bases[i], exps[i], mod);
+        bn_multiply_assign(result, power);
+        bn_mod_assign(result, mod);
+    }
+    bn_destroy(&power);
+    return result;
 }
 
-int bn_less_than(BigNum *n1, BigNum *n2) {
-    return bn_compare(n1, n2) < 0;
-}
+// Amount of numbers that `bn_power_mod_ctx_batch` processes side by side. The
+// blocks of these lanes are interleaved, so block i of lane j is found at
+// index i * BN_BATCH_LANES + j. All inner loops then run over the independent
+// lanes, which the compiler can vectorize.
+#define BN_BATCH_LANES 8
 
-int bn_equal_to(BigNum *n1, BigNum *n2) {
-    return bn_compare(n1, n2) == 0;
-}
+// Computes the Montgomery products a * b * R^-1 mod m of the interleaved
+// `len` block operands `a` and `b` for all lanes and writes them to `result`,
+// using CIOS like `bn_mont_multiply`. `t` is scratch space of (`len` + 2) *
+// BN_BATCH_LANES blocks. `result` may alias `a` or `b`.
+static void bn_mont_multiply_lanes(bn_block_t *result, bn_block_t *a, bn_block_t *b, bn_block_t *t, bn_MontCtx *ctx) {
+    size_t len = ctx->mod->len;
+    bn_block_t *m = ctx->mod->data;
+    bn_block_t *t_len = t + len * BN_BATCH_LANES;
+    bn_block_t *t_top = t_len + BN_BATCH_LANES;
 
-BigNum *bn_add(BigNum *n1, BigNum *n2) {
-    size_t greater_len = n1->len > n2->len ? n1->len : n2->len;
-    size_t result_len = greater_len + 1;
+    memset(t, 0, (len + 2) * BN_BATCH_LANES * sizeof(bn_block_t));
 
-    BigNum *result = bn_with_len(result_len);
+    for (size_t i = 0; i < len; i++) {
+        bn_block_t *b_i = b + i * BN_BATCH_LANES;
+        bn_block_t carry[BN_BATCH_LANES] = { 0 };
 
-    int transfer = 0;
-    for (size_t offset = 0; offset < result_len; offset++) {
-        uint64_t block_result_64 = 0;
-        block_result_64 += transfer;
-        block_result_64 += bn_get_block(n1, offset);
-        block_result_64 += bn_get_block(n2, offset);
+        // t += a * b[i]
+        for (size_t j = 0; j < len; j++) {
+            bn_block_t *a_j = a + j * BN_BATCH_LANES;
+            bn_block_t *t_j = t + j * BN_BATCH_LANES;
+            for (size_t lane = 0; lane < BN_BATCH_LANES; lane++) {
+                bn_dblock_t sum = (bn_dblock_t)a_j[lane] * b_i[lane] + t_j[lane] + carry[lane];
+                t_j[lane] = sum;
+                carry[lane] = sum >> BN_BLOCK_BITS;
+            }
+        }
+        for (size_t lane = 0; lane < BN_BATCH_LANES; lane++) {
+            bn_dblock_t sum = (bn_dblock_t)t_len[lane] + carry[lane];
+            t_len[lane] = sum;
+            t_top[lane] = sum >> BN_BLOCK_BITS;
+        }
 
-        uint32_t block_result_32 = block_result_64;
-        bn_write_block(result, offset, block_result_32);
+        // t = (t + q * m) / B, where q is chosen so that the lowest block of
+        // the sum becomes 0
+        bn_block_t q[BN_BATCH_LANES];
+        for (size_t lane = 0; lane < BN_BATCH_LANES; lane++) {
+            q[lane] = t[lane] * ctx->mod_inv;
+            bn_dblock_t sum = (bn_dblock_t)q[lane] * m[0] + t[lane];
+            carry[lane] = sum >> BN_BLOCK_BITS;
+        }
+        for (size_t j = 1; j < len; j++) {
+            bn_block_t *t_j = t + j * BN_BATCH_LANES;
+            for (size_t lane = 0; lane < BN_BATCH_LANES; lane++) {
+                bn_dblock_t sum = (bn_dblock_t)q[lane] * m[j] + t_j[lane] + carry[lane];
+                t_j[lane - BN_BATCH_LANES] = sum;
+                carry[lane] = sum >> BN_BLOCK_BITS;
+            }
+        }
+        for (size_t lane = 0; lane < BN_BATCH_LANES; lane++) {
+            bn_dblock_t sum = (bn_dblock_t)t_len[lane] + carry[lane];
+            t_len[lane - BN_BATCH_LANES] = sum;
+            t_len[lane] = t_top[lane] + (bn_block_t)(sum >> BN_BLOCK_BITS);
+        }
+    }
 
-        transfer = block_result_32 != block_result_64;
+    // The lanes are less than 2 * m, so at most one subtraction per lane is
+    // needed
+    for (size_t lane = 0; lane < BN_BATCH_LANES; lane++) {
+        int subtract = t_len[lane] != 0;
+        if (!subtract) {
+            subtract = 1;
+            for (size_t _j = len; _j > 0; _j--) {
+                size_t j = _j - 1;
+                bn_block_t block = t[j * BN_BATCH_LANES + lane];
+                if (block != m[j]) {
+                    subtract = block > m[j];
+                    break;
+                }
+            }
+        }
+        bn_block_t borrow = 0;
+        for (size_t j = 0; j < len; j++) {
+            bn_block_t block = t[j * BN_BATCH_LANES + lane];
+            bn_block_t sub = subtract ? m[j] : 0;
+            result[j * BN_BATCH_LANES + lane] = block - sub - borrow;
+            borrow = (block < sub) | ((block - sub) < borrow);
+        }
     }
+}
 
-    bn_trim(result);
+// Computes (`bases[i]` ^ `exps[i]`) % m for the `count` (at most
+// BN_BATCH_LANES) lanes in lockstep and writes the results interleaved to the
+// m->len * BN_BATCH_LANES blocks at `result`. All lanes use the same fixed
+// window schedule, which depends on the longest exponent. Unused lanes
+// compute 0^0.
+static void bn_power_mod_ctx_lanes(bn_block_t *result, BigNum **bases, BigNum **exps, size_t count, bn_MontCtx *ctx) {
+    size_t len = ctx->mod->len;
+    size_t width = len * BN_BATCH_LANES;
 
-    return result;
-}
+    size_t exp_bits = 0;
+    for (size_t lane = 0; lane < count; lane++) {
+        size_t bits = bn_bit_length(exps[lane]);
+        exp_bits = bits > exp_bits ? bits : exp_bits;
+    }
+    int window_bits = bn_exp_window_bits(exp_bits);
+    size_t table_len = (size_t)1 << window_bits;
 
-BigNum *bn_subtract(BigNum *n1, BigNum *n2) {
-    if (bn_greater_than(n2, n1)) {
-        return NULL;
+    // The powers base^0 to base^(table_len - 1) in Montgomery form, one
+    // operand, R^2 for every lane and the multiplication scratch space. The
+    // accumulator is `result`.
+    size_t scratch_len = (table_len + 2) * width + (len + 2) * BN_BATCH_LANES;
+    bn_block_t *scratch = bn_scratch_alloc(scratch_len * sizeof(bn_block_t));
+    bn_block_t *table = scratch;
+    bn_block_t *acc = result;
+    bn_block_t *operand = table + table_len * width;
+    bn_block_t *r_squared = operand + width;
+    bn_block_t *t = r_squared + width;
+
+    for (size_t i = 0; i < len; i++) {
+        for (size_t lane = 0; lane < BN_BATCH_LANES; lane++) {
+            r_squared[i * BN_BATCH_LANES + lane] = bn_get_block_unchecked(ctx->r_squared, i);
+        }
     }
 
-    // n1 >= n2, so the result will be at most n1->len long
-    BigNum *result = bn_with_len(n1->len);
+    // base^0 = 1 in Montgomery form is R mod m
+    memset(operand, 0, width * sizeof(bn_block_t));
+    for (size_t lane = 0; lane < BN_BATCH_LANES; lane++) {
+        operand[lane] = 1;
+    }
+    bn_mont_multiply_lanes(table, operand, r_squared, t, ctx);
 
-    uint32_t transfer = 0;
-    for (size_t offset = 0; offset < n1->len; offset++) {
-        uint32_t n1_block = bn_get_block_unchecked(n1, offset);
-        uint32_t n2_block = bn_get_block(n2, offset);
+    // Reduced bases, converted to Montgomery form
+    memset(operand, 0, width * sizeof(bn_block_t));
+    for (size_t lane = 0; lane < count; lane++) {
+        BigNum *reduced = bases[lane];
+        if (!bn_less_than(reduced, ctx->mod)) {
+            reduced = bn_mod(reduced, ctx->mod);
+        }
+        for (size_t i = 0; i < reduced->len; i++) {
+            operand[i * BN_BATCH_LANES + lane] = bn_get_block_unchecked(reduced, i);
+        }
+        if (reduced != bases[lane]) {
+            bn_destroy(&reduced);
+        }
+    }
+    bn_mont_multiply_lanes(table + width, operand, r_squared, t, ctx);
+    for (size_t i = 2; i < table_len; i++) {
+        bn_mont_multiply_lanes(table + i * width, table + (i - 1) * width, table + width, t, ctx);
+    }
 
-        if (transfer) {
-            n2_block += transfer;
-            // Only reset transfer, if the addition of the transfer did not
-            // cause an overflow
-            if (n2_block) {
-                transfer = 0;
+    memcpy(acc, table, width * sizeof(bn_block_t));
+    size_t num_windows = (exp_bits + window_bits - 1) / window_bits;
+    for (size_t _window = num_windows; _window > 0; _window--) {
+        size_t offset = (_window - 1) * window_bits;
+        if (_window < num_windows) {
+            for (int i = 0; i < window_bits; i++) {
+                bn_mont_multiply_lanes(acc, acc, acc, t, ctx);
             }
         }
 
-        uint32_t block_diff;
-        if (n1_block >= n2_block) {
-            block_diff = n1_block - n2_block;
-        } else {
-            // n2_block is greater than n1_block, so n1_block + 1 - n2_block is
-            // <= 0. Meaning that this expression will never overflow.
-            block_diff = BN_BLOCK_MAX - n2_block + 1 + n1_block;
-            transfer = 1;
+        // Every lane selects the power for its own window
+        for (size_t lane = 0; lane < BN_BATCH_LANES; lane++) {
+            size_t value = lane < count ? bn_get_bits(exps[lane], offset, window_bits) : 0;
+            bn_block_t *power = table + value * width;
+            for (size_t i = 0; i < len; i++) {
+                operand[i * BN_BATCH_LANES + lane] = power[i * BN_BATCH_LANES + lane];
+            }
         }
-        bn_write_block(result, offset, block_diff);
+        bn_mont_multiply_lanes(acc, acc, operand, t, ctx);
     }
 
-    bn_trim(result);
+    // Convert back from Montgomery form: acc * 1 * R^-1
+    memset(operand, 0, width * sizeof(bn_block_t));
+    for (size_t lane = 0; lane < BN_BATCH_LANES; lane++) {
+        operand[lane] = 1;
+    }
+    bn_mont_multiply_lanes(acc, acc, operand, t, ctx);
 
-    return result;
+    bn_scratch_free(scratch, scratch_len * sizeof(bn_block_t));
 }
 
-BigNum *bn_multiply(BigNum *n1, BigNum *n2) {
-    // New number is at most n1->len + n2->len long. We can trim the result at
-    // the end as in `bn_add` (maybe we need to trim more than one block).
-    size_t result_len = n1->len + n2->len;
+// The exponentiations of one group of lanes as a task
+typedef struct bn_PowerModTask {
+    bn_Task task;
+    bn_block_t *result;
+    BigNum **bases;
+    BigNum **exps;
+    size_t count;
+    bn_MontCtx *ctx;
+} bn_PowerModTask;
 
-    BigNum *result = bn_with_len(result_len);
+static void bn_power_mod_task_run(bn_Task *task) {
+    bn_PowerModTask *power_mod = (bn_PowerModTask *)task;
+    bn_power_mod_ctx_lanes(power_mod->result, power_mod->bases, power_mod->exps, power_mod->count, power_mod->ctx);
+}
+
+BigNum **bn_power_mod_ctx_batch(BigNum **bases, BigNum **exps, bn_MontCtx *ctx, BigNum **out, size_t n) {
+    size_t len = ctx->mod->len;
+    size_t width = len * BN_BATCH_LANES;
+    size_t num_groups = (n + BN_BATCH_LANES - 1) / BN_BATCH_LANES;
 
-    for (size_t n1_offset = 0; n1_offset < n1->len; n1_offset++) {
-        for (size_t n2_offset = 0; n2_offset < n2->len; n2_offset++) {
-            size_t result_offset = n1_offset + n2_offset;
-            uint32_t n1_block = bn_get_block_unchecked(n1, n1_offset);
-            uint32_t n2_block = bn_get_block_unchecked(n2, n2_offset);
-            // Cast to uint64_t necessary since both operands are uint32_t, but
-            // we don't want to lose the overflow.
-            uint64_t block_result = (uint64_t)n1_block * n2_block;
-            bn_add_block_cascading_unchecked(result, result_offset, block_result);
+    // The groups are independent, so they can run on all threads. The
+    // results are only written to `out` at the end, since `out` may alias
+    // the operands.
+    bn_TaskGroup tasks = { 0 };
+    bn_TaskGroup *group = bn_worker_count && num_groups > 1 ? &tasks : NULL;
+    bn_block_t *results = bn_scratch_alloc(num_groups * width * sizeof(bn_block_t));
+    bn_PowerModTask *power_mods = bn_scratch_alloc(num_groups * sizeof(bn_PowerModTask));
+    for (size_t i = 0; i < num_groups; i++) {
+        size_t first = i * BN_BATCH_LANES;
+        size_t count = n - first < BN_BATCH_LANES ? n - first : BN_BATCH_LANES;
+        power_mods[i] = (bn_PowerModTask){ { bn_power_mod_task_run, NULL }, results + i * width, bases + first, exps + first, count, ctx };
+        if (group) {
+            bn_task_spawn(group, &power_mods[i].task);
+        } else {
+            bn_power_mod_task_run(&power_mods[i].task);
         }
     }
+    if (group) {
+        bn_task_wait(group);
+    }
 
-    bn_trim(result);
+    for (size_t item = 0; item < n; item++) {
+        bn_block_t *result = results + item / BN_BATCH_LANES * width;
+        size_t lane = item % BN_BATCH_LANES;
+        bn_resize(out[item], len);
+        for (size_t i = 0; i < len; i++) {
+            bn_write_block(out[item], i, result[i * BN_BATCH_LANES + lane]);
+        }
+        bn_trim(out[item]);
+    }
 
-    return result;
+    bn_scratch_free(power_mods, num_groups * sizeof(bn_PowerModTask));
+    bn_scratch_free(results, num_groups * width * sizeof(bn_block_t));
+    return out;
 }
 
-bn_DivideWithRemainderResult *bn_divide_with_remainder(BigNum *n1, BigNum *n2) {
-    // Catch division by zero
-    if (n2->len == 1 && *(uint32_t *)n2->data == 0) {
+BigNum **bn_power_mod_batch(BigNum **bases, BigNum **exps, BigNum *mod, BigNum **out, size_t n) {
+    if (bn_is_zero(mod)) {
         return NULL;
     }
-
-    // Quotient is at most n1->len - (n2->len - 1) long if n1->len > n2->len.
-    // Let's asume we have two big numbers n1 = 0xffffffff 0xffffffff
-    // 0xffffffff (len=3) and n2 = 1 0 (len=2). Dividing n1 by n2 merely acts
-    // as a shift right operation of one block on n1, even though n2's length
-    // is 2. We have to trim the quotient at the end, because the example shows
-    // only the most extreme case. In other cases the length of the quotient
-    // might end up smaller. When n1->len <= n2->len the result will be only
-    // one block long.
-    size_t quotient_len;
-    if (n1->len > n2->len) {
-        quotient_len = n1->len - (n2->len - 1);
-    } else {
-        quotient_len = 1;
+    bn_MontCtx *ctx = bn_mont_ctx_new(mod);
+    if (!ctx) {
+        // Even moduli can't use Montgomery form
+        for (size_t i = 0; i < n; i++) {
+            bn_power_mod_into(out[i], bases[i], exps[i], mod);
+        }
+        return out;
     }
+    bn_power_mod_ctx_batch(bases, exps, ctx, out, n);
+    bn_mont_ctx_destroy(&ctx);
+    return out;
+}
 
-    BigNum *quotient = bn_with_len(quotient_len);
-    BigNum *remainder = bn_zero();
+// Products `n1[i]` * `n2[i]` for `count` consecutive items as a task, which
+// writes them to the prepared `results[i]` with one scratch space
+typedef struct bn_MultiplyBatchTask {
+    bn_Task task;
+    BigNum **results;
+    BigNum **n1;
+    BigNum **n2;
+    size_t count;
+} bn_MultiplyBatchTask;
 
-    BigNum *block_quotient = bn_zero();
+static void bn_multiply_batch_task_run(bn_Task *task) {
+    bn_MultiplyBatchTask *batch = (bn_MultiplyBatchTask *)task;
 
-    for (size_t _offset = n1->len; _offset > 0; _offset--) {
-        size_t offset = _offset - 1;
-        // Shift left remainder by one block and set least significant block of
-        // remainder the block of n1 at offset
-        remainder->len += 1;
-        remainder->data = realloc(remainder->data, remainder->len * sizeof(uint32_t));
-        memmove(
-            (uint32_t *)remainder->data + 1,
-            (uint32_t *)remainder->data,
-            (remainder->len - 1) * sizeof(uint32_t)
-        );
-        *(uint32_t *)remainder->data = *((uint32_t *)n1->data + offset);
-        // Necessary since left-shifting a 0 leads to a leading 0.
-        bn_trim(remainder);
+    // One scratch space that is large enough for all products
+    size_t longest_len = 0;
+    for (size_t i = 0; i < batch->count; i++) {
+        longest_len = batch->n1[i]->len > longest_len ? batch->n1[i]->len : longest_len;
+        longest_len = batch->n2[i]->len > longest_len ? batch->n2[i]->len : longest_len;
+    }
+    size_t scratch_len = bn_multiply_scratch_len(longest_len);
+    bn_block_t *scratch = scratch_len ? bn_scratch_alloc(scratch_len * sizeof(bn_block_t)) : NULL;
 
-        // Check if remainder can be divided by n2
-        if (bn_compare(remainder, n2) >= 0) {
-            // Efficiently search for the block_quotient (remainder / n2).
-            *(uint32_t *)block_quotient->data = 0;
-            for (int bit_offset = 31; bit_offset >= 0; bit_offset--) {
-                *(uint32_t *)block_quotient->data |= (1 << bit_offset);
-                BigNum *product = bn_multiply(block_quotient, n2);
-                // flip the bit back to 0 if the block_quotient is too large
-                if (bn_greater_than(product, remainder)) {
-                    *(uint32_t *)block_quotient->data ^= (1 << bit_offset);
-                }
-                bn_destroy(&product);
-            }
-            BigNum *product = bn_multiply(block_quotient, n2);
+    for (size_t i = 0; i < batch->count; i++) {
+        BigNum *n1 = batch->n1[i];
+        BigNum *n2 = batch->n2[i];
+        bn_multiply_blocks(batch->results[i]->data, n1->data, n1->len, n2->data, n2->len, scratch);
+    }
+
+    bn_scratch_free(scratch, scratch_len * sizeof(bn_block_t));
+}
+
+BigNum **bn_multiply_batch(BigNum **n1, BigNum **n2, BigNum **out, size_t n) {
+    // All results are allocated up front by this thread. Products that alias
+    // an operand are built in a temporary, as in `bn_multiply_into`.
+    BigNum **results = bn_scratch_alloc(n * sizeof(BigNum *));
+    for (size_t i = 0; i < n; i++) {
+        size_t result_len = n1[i]->len + n2[i]->len;
+        if (out[i] == n1[i] || out[i] == n2[i]) {
+            results[i] = bn_with_len(result_len);
+        } else {
+            bn_resize(out[i], result_len);
+            results[i] = out[i];
+        }
+    }
 
-            // Could write a function that subtracts the second operand from
-            // the first, and saving the result in the first operand. But this
-            // should be fine to start with.
-            BigNum *new_remainder = bn_subtract(remainder, product);
-            bn_destroy(&remainder);
-            remainder = new_remainder;
-            bn_write_block(quotient, offset, *(uint32_t *)block_quotient->data);
+    // One task per thread, each with a consecutive range of items
+    size_t num_tasks = n < bn_worker_count + 1 ? n : bn_worker_count + 1;
+    bn_TaskGroup tasks = { 0 };
+    bn_TaskGroup *group = num_tasks > 1 ? &tasks : NULL;
+    bn_MultiplyBatchTask *batches = bn_scratch_alloc(num_tasks * sizeof(bn_MultiplyBatchTask));
+    for (size_t i = 0; i < num_tasks; i++) {
+        size_t first = n * i / num_tasks;
+        size_t count = n * (i + 1) / num_tasks - first;
+        batches[i] = (bn_MultiplyBatchTask){ { bn_multiply_batch_task_run, NULL }, results + first, n1 + first, n2 + first, count };
+        if (group) {
+            bn_task_spawn(group, &batches[i].task);
+        } else {
+            bn_multiply_batch_task_run(&batches[i].task);
+        }
+    }
+    if (group) {
+        bn_task_wait(group);
+    }
 
-            bn_destroy(&product);
+    for (size_t i = 0; i < n; i++) {
+        if (results[i] != out[i]) {
+            bn_move(out[i], &results[i]);
         }
+        bn_trim(out[i]);
     }
 
-    bn_destroy(&block_quotient);
+    bn_scratch_free(batches, num_tasks * sizeof(bn_MultiplyBatchTask));
+    bn_scratch_free(results, n * sizeof(BigNum *));
+    return out;
+}
 
-    bn_trim(quotient);
-    bn_trim(remainder);
+// Largest power of 10 that fits into a block and its amount of 0-digits.
+// Decimal conversion works on chunks of this many digits.
+#if BN_BLOCK_BITS == 64
+#define BN_DECIMAL_CHUNK 10000000000000000000ULL
+#define BN_DECIMAL_CHUNK_DIGITS 19
+#else
+#define BN_DECIMAL_CHUNK 1000000000
+#define BN_DECIMAL_CHUNK_DIGITS 9
+#endif
 
-    bn_DivideWithRemainderResult *result = malloc(sizeof(bn_DivideWithRemainderResult));
-    result->quotient = quotient;
-    result->remainder = remainder;
-    return result;
+// Numbers with at least this many blocks are converted by divide and conquer
+#define BN_DECIMAL_DC_THRESHOLD 32
+
+// Powers 10^(BN_DECIMAL_CHUNK_DIGITS * 2^k) for k < `len`, which are computed
+// once per conversion and shared by all recursion levels
+typedef struct bn_DecimalPowers {
+    BigNum *powers[64];
+    size_t len;
+} bn_DecimalPowers;
+
+// Returns 10^(BN_DECIMAL_CHUNK_DIGITS * 2^`k`), computing missing powers
+static BigNum *bn_decimal_power(bn_DecimalPowers *powers, size_t k) {
+    if (powers->len == 0) {
+        BigNum *chunk = bn_with_len(1);
+        bn_write_block(chunk, 0, BN_DECIMAL_CHUNK);
+        powers->powers[powers->len++] = chunk;
+    }
+    while (powers->len <= k) {
+        powers->powers[powers->len] = bn_square(powers->powers[powers->len - 1]);
+        powers->len++;
+    }
+    return powers->powers[k];
 }
 
-BigNum *bn_divide(BigNum *n1, BigNum *n2) {
-    bn_DivideWithRemainderResult *result = bn_divide_with_remainder(n1, n2);
-    BigNum *quotient = NULL;
-    if (result) {
-        quotient = result->quotient;
-        bn_destroy(&result->remainder);
-        free(result);
+static void bn_decimal_powers_destroy(bn_DecimalPowers *powers) {
+    for (size_t k = 0; k < powers->len; k++) {
+        bn_destroy(&powers->powers[k]);
     }
-    return quotient;
 }
 
-BigNum *bn_mod(BigNum *n1, BigNum *n2) {
-    bn_DivideWithRemainderResult *result = bn_divide_with_remainder(n1, n2);
-    BigNum *remainder = NULL;
-    if (result) {
-        remainder = result->remainder;
-        bn_destroy(&result->quotient);
-        free(result);
+size_t bn_decimal_max_len(BigNum *n) {
+    size_t bits = bn_bit_length(n);
+    // 30103 / 100000 is slightly more than log10(2)
+    return bits ? bits / 100000 * 30103 + bits % 100000 * 30103 / 100000 + 1 : 1;
+}
+
+// Writes exactly `width` digits of the `len` blocks at `a` to the chars
+// before `end`, padded with leading zeros. `a` is destroyed in the process.
+// `width` must be large enough for the value.
+static void bn_decimal_write_chunks(bn_block_t *a, size_t len, char *end, size_t width) {
+    while (len > 1 && a[len - 1] == 0) {
+        len--;
+    }
+    while (width) {
+        bn_block_t chunk = bn_blocks_divide_block(a, a, len, BN_DECIMAL_CHUNK);
+        while (len > 1 && a[len - 1] == 0) {
+            len--;
+        }
+        for (int i = 0; i < BN_DECIMAL_CHUNK_DIGITS && width; i++) {
+            *--end = '0' + chunk % 10;
+            chunk /= 10;
+            width--;
+        }
     }
-    return remainder;
 }
 
-BigNum *bn_power_mod(BigNum *base, BigNum *exp, BigNum *mod) {
-    if (mod->len == 1 && *((uint32_t *)mod->data) == 0) {
-        return NULL;
+// Writes exactly `width` digits of `n` to the chars before `end`, padded with
+// leading zeros. Numbers of at least BN_DECIMAL_DC_THRESHOLD blocks are split
+// into the quotient and remainder by 10^(BN_DECIMAL_CHUNK_DIGITS * 2^`k`),
+// which are converted recursively with smaller powers. `n` must be less than
+// the square of that power, so that both halves are less than the power.
+static void bn_decimal_write(BigNum *n, bn_DecimalPowers *powers, size_t k, char *end, size_t width) {
+    while (k > 0 && bn_less_than(n, bn_decimal_power(powers, k))) {
+        k--;
+    }
+    if (n->len < BN_DECIMAL_DC_THRESHOLD || k == 0) {
+        bn_block_t *scratch = bn_scratch_alloc(n->len * sizeof(bn_block_t));
+        memcpy(scratch, n->data, n->len * sizeof(bn_block_t));
+        bn_decimal_write_chunks(scratch, n->len, end, width);
+        bn_scratch_free(scratch, n->len * sizeof(bn_block_t));
+        return;
     }
 
-    BigNum *result = bn_one();
+    size_t low_width = (size_t)BN_DECIMAL_CHUNK_DIGITS << k;
+    BigNum *quotient = bn_zero();
+    BigNum *remainder = bn_zero();
+    bn_divide_with_remainder_unchecked(quotient, remainder, n, bn_decimal_power(powers, k));
+    bn_decimal_write(remainder, powers, k - 1, end, low_width);
+    bn_destroy(&remainder);
+    bn_decimal_write(quotient, powers, k - 1, end - low_width, width - low_width);
+    bn_destroy(&quotient);
+}
 
-    int search_start = 1;
-    for (size_t _exp_offset = exp->len; _exp_offset > 0; _exp_offset--) {
-        size_t exp_offset = _exp_offset - 1;
-        uint32_t exp_block = *((uint32_t *)exp->data + exp_offset);
-        for (int exp_bit_offset = 31; exp_bit_offset >= 0; exp_bit_offset--) {
-            int bit = exp_block & (1 << exp_bit_offset);
-            if (search_start) {
-                if (bit) {
-                    search_start = 0;
-                } else {
-                    continue;
-                }
-            }
+size_t bn_to_decimal(BigNum *n, char *buf, size_t cap) {
+    BN_STATS_SCOPE(BN_STATS_TO_DECIMAL, n->len);
+    size_t max_len = bn_decimal_max_len(n);
+    // Without room for `max_len` digits and the terminating 0, the digits
+    // are collected in scratch memory first
+    char *digits = cap > max_len ? buf : bn_scratch_alloc(max_len);
 
-            BigNum *new_result = bn_multiply(result, result);
-            bn_destroy(&result);
-            result = new_result;
+    // Smallest power whose square has at least `max_len` digits, so that the
+    // quotient and the remainder of the split are both below the power and
+    // can be split further by the next smaller power
+    bn_DecimalPowers powers = { { NULL }, 0 };
+    size_t k = 0;
+    if (n->len >= BN_DECIMAL_DC_THRESHOLD) {
+        while (((size_t)BN_DECIMAL_CHUNK_DIGITS << (k + 1)) < max_len) {
+            k++;
+        }
+    }
+    bn_decimal_write(n, &powers, k, digits + max_len, max_len);
+    bn_decimal_powers_destroy(&powers);
 
-            if (bit) {
-                BigNum *new_result = bn_multiply(result, base);
-                bn_destroy(&result);
-                result = new_result;
-            }
+    size_t leading_zeros = 0;
+    while (leading_zeros + 1 < max_len && digits[leading_zeros] == '0') {
+        leading_zeros++;
+    }
+    size_t len = max_len - leading_zeros;
+    if (len < cap) {
+        memmove(buf, digits + leading_zeros, len);
+        buf[len] = 0;
+    } else {
+        len = 0;
+    }
 
-            new_result = bn_mod(result, mod);
-            bn_destroy(&result);
-            result = new_result;
-        }
+    if (digits != buf) {
+        bn_scratch_free(digits, max_len);
+    }
+    return len;
+}
+
+// Writes the value of the `len` decimal digits at `str` to `result`, which
+// must have enough blocks and be 0.
+static void bn_decimal_read_chunks(BigNum *result, const char *str, size_t len) {
+    bn_block_t *a = result->data;
+    size_t a_len = 1;
+    // The first chunk takes the digits that don't fill a whole chunk, so all
+    // following chunks are complete
+    size_t chunk_digits = len % BN_DECIMAL_CHUNK_DIGITS;
+    if (!chunk_digits) {
+        chunk_digits = BN_DECIMAL_CHUNK_DIGITS;
     }
+    while (len) {
+        bn_block_t chunk = 0;
+        for (size_t i = 0; i < chunk_digits; i++) {
+            chunk = chunk * 10 + (*str++ - '0');
+        }
+        len -= chunk_digits;
+        chunk_digits = BN_DECIMAL_CHUNK_DIGITS;
 
+        // a = a * BN_DECIMAL_CHUNK + chunk
+        bn_block_t carry = chunk;
+        for (size_t offset = 0; offset < a_len; offset++) {
+            bn_dblock_t sum = (bn_dblock_t)a[offset] * BN_DECIMAL_CHUNK + carry;
+            a[offset] = sum;
+            carry = sum >> BN_BLOCK_BITS;
+        }
+        if (carry) {
+            a[a_len++] = carry;
+        }
+    }
     bn_trim(result);
+}
+
+// Returns the value of the `len` decimal digits at `str`. Long strings are
+// split into a lower part of BN_DECIMAL_CHUNK_DIGITS * 2^k digits and the
+// upper part, which are converted recursively and combined with a
+// multiplication by the cached power of 10.
+static BigNum *bn_decimal_read(const char *str, size_t len, bn_DecimalPowers *powers) {
+    if (len < BN_DECIMAL_DC_THRESHOLD * BN_DECIMAL_CHUNK_DIGITS) {
+        BigNum *result = bn_with_len(len / BN_DECIMAL_CHUNK_DIGITS + 1);
+        bn_decimal_read_chunks(result, str, len);
+        return result;
+    }
+
+    size_t k = 0;
+    while (((size_t)BN_DECIMAL_CHUNK_DIGITS << (k + 1)) < len) {
+        k++;
+    }
+    size_t low_len = (size_t)BN_DECIMAL_CHUNK_DIGITS << k;
+    BigNum *high = bn_decimal_read(str, len - low_len, powers);
+    BigNum *low = bn_decimal_read(str + len - low_len, low_len, powers);
+    BigNum *result = bn_multiply(high, bn_decimal_power(powers, k));
+    bn_add_assign(result, low);
+    bn_destroy(&high);
+    bn_destroy(&low);
+    return result;
+}
+
+BigNum *bn_from_decimal(const char *str) {
+    if (!str || !*str) {
+        return NULL;
+    }
+    size_t len = 0;
+    for (const char *c = str; *c; c++) {
+        if (*c < '0' || *c > '9') {
+            return NULL;
+        }
+        len++;
+    }
 
+    bn_DecimalPowers powers = { { NULL }, 0 };
+    BigNum *result = bn_decimal_read(str, len, &powers);
+    bn_decimal_powers_destroy(&powers);
     return result;
 }
@@ -5,21 +5,133 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
 #include <stdlib.h>
 
+// Size of a block in BigNum in bits. This is 32 by default and can be set to
+// 64 on compilers that provide `unsigned __int128` (GCC and Clang on 64-bit
+// targets) by defining BN_BLOCK_BITS as 64 for the library and all code that
+// includes this header.
+#ifndef BN_BLOCK_BITS
+#define BN_BLOCK_BITS 32
+#endif
+
+#if BN_BLOCK_BITS == 64
+// Single block of a BigNum
+typedef uint64_t bn_block_t;
+// Max value of a block in BigNum
+#define BN_BLOCK_MAX 0xffffffffffffffff
+#elif BN_BLOCK_BITS == 32
+// Single block of a BigNum
+typedef uint32_t bn_block_t;
 // Max value of a block in BigNum
 #define BN_BLOCK_MAX 0xffffffff
+#else
+#error "BN_BLOCK_BITS must be 32 or 64"
+#endif
+
+// Functions that the library uses for its heap memory. `allocate`,
+// `reallocate` and `deallocate` work like malloc, realloc and free, but the
+// latter two additionally get the size of the memory, so allocators don't
+// need to store it. `ctx` is passed to every function unchanged. See
+// `bn_set_allocator`.
+typedef struct bn_Allocator {
+    void *(*allocate)(void *ctx, size_t size);
+    void *(*reallocate)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void (*deallocate)(void *ctx, void *ptr, size_t size);
+    void *ctx;
+} bn_Allocator;
+
+// Byte order for `bn_to_bytes` and `bn_from_bytes`
+typedef enum bn_Endian {
+    // The most significant byte comes first
+    BN_BIG_ENDIAN,
+    // The least significant byte comes first
+    BN_LITTLE_ENDIAN,
+} bn_Endian;
+
+// Set BN_STATS to 1 (`make STATS=1`) to count the calls of the main
+// operations and all allocations per thread, see `bn_stats_snapshot`. It is 0
+// by default, which removes all counting from the library.
+#ifndef BN_STATS
+#define BN_STATS 0
+#endif
+
+// Operations that are counted with BN_STATS. Each one counts the calls of all
+// public functions of its kind (for example `BN_STATS_DIVIDE` those of
+// `bn_divide_with_remainder`, `bn_divide` and `bn_mod` and their variants),
+// including the calls from other functions of the library.
+typedef enum bn_StatsOp {
+    BN_STATS_ADD,
+    BN_STATS_SUBTRACT,
+    BN_STATS_MULTIPLY,
+    BN_STATS_SQUARE,
+    BN_STATS_DIVIDE,
+    BN_STATS_POWER_MOD,
+    BN_STATS_POWER_MOD_CTX,
+    BN_STATS_GCD,
+    BN_STATS_TO_HEX,
+    BN_STATS_TO_DECIMAL,
+    // Amount of operations
+    BN_STATS_OPS,
+} bn_StatsOp;
 
+// Amount of classes of the size histograms of `bn_Stats`
+#define BN_STATS_SIZE_CLASSES 32
+
+typedef struct bn_OpStats {
+    // Amount of calls
+    uint64_t calls;
+    // Time spent in the calls, including nested calls of other operations
+    uint64_t nanoseconds;
+    // Calls by the length of the longest operand in blocks. Class 0 counts
+    // the length 0 and class i the lengths from 2^(i - 1) to 2^i - 1, except
+    // that the last class counts all the longer ones too.
+    uint64_t sizes[BN_STATS_SIZE_CLASSES];
+} bn_OpStats;
+
+// Counters of `bn_stats_snapshot`. All fields are uint64_t.
+typedef struct bn_Stats {
+    bn_OpStats ops[BN_STATS_OPS];
+    // Calls of the `allocate`, `reallocate` and `deallocate` functions of the
+    // allocators
+    uint64_t allocations;
+    uint64_t reallocations;
+    uint64_t deallocations;
+    // Sum of the sizes of all allocations and reallocations in bytes
+    uint64_t allocated_bytes;
+    // Allocations and reallocations by their size in bytes, with the classes
+    // of `bn_OpStats.sizes`
+    uint64_t allocation_sizes[BN_STATS_SIZE_CLASSES];
+} bn_Stats;
+
+// Arena that hands out memory for temporaries until it is reset, see
+// `bn_arena_new`.
+typedef struct bn_Arena bn_Arena;
+
+// Amount of blocks that a BigNum holds inside of its struct. Numbers that fit
+// into them don't need a separate heap allocation for their blocks.
+#define BN_INLINE_BLOCKS 4
 
 // Unsigned big number. Do not mutate this directly but use the provided
-// functions.
+// functions. A BigNum points into itself while its blocks are stored inline,
+// so it must not be copied by value.
 typedef struct BigNum {
-    // Contiguous block of memory that holds our 32-bit ints with little
-    // endianness (the least significant int comes first in memory). The size
-    // of this block will be exactly 4 * `len` bytes.
+    // Contiguous block of memory that holds our blocks (`bn_block_t`) with
+    // little endianness (the least significant block comes first in memory).
+    // The size of this block will be exactly sizeof(bn_block_t) * `capacity`
+    // bytes. Points to `inline_blocks` as long as `capacity` is
+    // BN_INLINE_BLOCKS.
     void* data;
-    // Amount of 32-bit ints
+    // Amount of blocks
     size_t len;
+    // Amount of blocks that fit into `data` without reallocating. This is
+    // always at least `len` and at least BN_INLINE_BLOCKS.
+    size_t capacity;
+    // Allocator of the struct and of `data`
+    const bn_Allocator *allocator;
+    // Storage for small numbers, see `data`
+    bn_block_t inline_blocks[BN_INLINE_BLOCKS];
 } BigNum;
 
 typedef struct bn_DivideWithRemainderResult {
@@ -29,11 +141,112 @@ typedef struct bn_DivideWithRemainderResult {
     BigNum *remainder;
 } bn_DivideWithRemainderResult;
 
+// Precomputed values for Montgomery multiplication modulo an odd number. A
+// context can be reused for any amount of operations with the same modulus.
+typedef struct bn_MontCtx {
+    // Modulus m, which is odd
+    BigNum *mod;
+    // R^2 mod m with R = 2^(BN_BLOCK_BITS * `mod->len`). Always exactly
+    // `mod->len` blocks long, so it may have leading 0-blocks.
+    BigNum *r_squared;
+    // -m^-1 mod 2^BN_BLOCK_BITS
+    bn_block_t mod_inv;
+} bn_MontCtx;
+
+// Precomputed values for Barrett reduction modulo any number except 0. A
+// context can be reused for any amount of operations with the same modulus.
+typedef struct bn_BarrettCtx {
+    // Modulus m
+    BigNum *mod;
+    // floor(B^(2k) / m) with B = 2^BN_BLOCK_BITS and k = `mod->len`
+    BigNum *mu;
+} bn_BarrettCtx;
+
+// Precomputed powers of a fixed base for exponentiations modulo the modulus
+// of a Montgomery context. A table can be reused for any amount of exponents
+// with at most the amount of bits it was created for.
+typedef struct bn_FixedBaseTable {
+    // Context of the modulus, which must outlive the table
+    bn_MontCtx *ctx;
+    // Amount of bits w of the digits that the exponents are split into
+    int window_bits;
+    // Amount of powers
+    size_t count;
+    // base^(2^(w * i)) for each i < `count` in Montgomery form, each
+    // `ctx->mod->len` blocks long
+    BigNum *powers;
+} bn_FixedBaseTable;
+
+// Sum of many big numbers whose carries are only propagated when it is read,
+// see `bn_accumulator_new`. Do not mutate this directly but use the provided
+// functions.
+typedef struct bn_Accumulator {
+    // 32-bit digits with little endianness, each in a 64-bit slot. Slots may
+    // exceed 2^32 until the accumulator is normalized.
+    uint64_t *slots;
+    // Amount of slots in use
+    size_t len;
+    // Amount of slots that fit into `slots` without reallocating
+    size_t capacity;
+    // Additions into each slot since the last normalization
+    uint64_t additions;
+    // Allocator of the struct and of `slots`
+    const bn_Allocator *allocator;
+} bn_Accumulator;
+
 
 // Destroys `n`, freeing all its allocated heap memory and setting `*n` to
 // NULL.
 void bn_destroy(BigNum **n);
 
+// Makes sure that `n` can hold at least `capacity` blocks without
+// reallocating.
+void bn_reserve(BigNum *n, size_t capacity);
+
+// Releases all memory of `n` that is not needed to hold its current value.
+void bn_shrink_to_fit(BigNum *n);
+
+// Sets the allocator that is used for all BigNums and temporary memory that
+// are created afterwards. A null pointer restores the default, which uses
+// malloc, realloc and free. Every BigNum remembers the allocator it was
+// created with and returns its memory to it, so `allocator` must stay valid
+// as long as such BigNums exist. This is not thread-safe and should be called
+// before any other functions are running.
+void bn_set_allocator(const bn_Allocator *allocator);
+
+// Returns an allocator that keeps freed memory in per-thread lists of size
+// classes and reuses it for later allocations of the same class, which avoids
+// most calls to malloc and contention between threads. Memory may be freed by
+// another thread than the one that allocated it.
+const bn_Allocator *bn_pool_allocator();
+
+// Frees all memory that the pool allocator keeps for reuse in the calling
+// thread. Threads that used the pool allocator should call this before they
+// exit.
+void bn_pool_release();
+
+// Creates an arena, which hands out memory by bumping a pointer and releases
+// it all at once in `bn_arena_reset`. Returns a null pointer if the memory
+// can't be allocated.
+bn_Arena *bn_arena_new();
+
+// Makes `arena` the allocator of the calling thread until `bn_arena_end`, so
+// all BigNums and temporary memory of the computations in between are taken
+// from it. Scopes of different arenas can be nested.
+void bn_arena_begin(bn_Arena *arena);
+
+// Ends the scope of `arena` that was started by `bn_arena_begin` and restores
+// the allocator that was used before.
+void bn_arena_end(bn_Arena *arena);
+
+// Releases all memory that `arena` has handed out. All BigNums created in
+// the arena are invalid afterwards and must not be used or destroyed. The
+// arena keeps its largest chunk of memory for the next computation.
+void bn_arena_reset(bn_Arena *arena);
+
+// Destroys `arena`, freeing all its memory and setting `*arena` to NULL.
+void bn_arena_destroy(bn_Arena **arena);
+
 // Creates a new heap-allocated BigNum from `orig`.
 BigNum *bn_copy(BigNum *orig);
 
@@ -44,16 +257,82 @@ BigNum *bn_zero();
 BigNum *bn_one();
 
 // Returns a pointer to a newly created big number representing `n`.
-BigNum *bn_from_uint32_t();
+BigNum *bn_from_uint32_t(uint32_t n);
 
 // Converts a hex string to a big number. The string may contain all valid hex
 // chars (0-9, a-f, A-F). Spaces are ignored. This function returns a null
 // pointer, if a null pointer or an invalid string is provided.
-BigNum *bn_from_hex();
+BigNum *bn_from_hex(const char *str);
 
 // Prints `n` in big Endian representation to be more human-readable.
 void bn_print_hex(BigNum *n);
 
+// Returns the amount of hex chars of `n` without leading zeros, which is 1 for
+// 0.
+size_t bn_hex_len(BigNum *n);
+
+// Writes the hex representation of `n` in lowercase, without leading zeros
+// and spaces and with a terminating 0 to `buf`, which can hold `cap` chars.
+// Returns the amount of hex chars written, or 0 if `buf` is too small (see
+// `bn_hex_len`), in which case `buf` is left untouched.
+size_t bn_to_hex(BigNum *n, char *buf, size_t cap);
+
+// Returns the amount of bytes of `n` without leading 0-bytes, which is 0 for
+// 0.
+size_t bn_byte_len(BigNum *n);
+
+// Writes `n` as unsigned integer of exactly `len` bytes with the byte order
+// `endian` to `buf`, padded with 0-bytes. Returns 1 on success and 0 if `n`
+// doesn't fit into `len` bytes (see `bn_byte_len`), in which case `buf` is
+// left untouched.
+int bn_to_bytes(BigNum *n, unsigned char *buf, size_t len, bn_Endian endian);
+
+// Returns a new big number from the unsigned integer of `len` bytes with the
+// byte order `endian` at `buf`. Leading 0-bytes are allowed and 0 bytes give
+// 0. Returns a null pointer if `buf` is a null pointer and `len` is not 0.
+BigNum *bn_from_bytes(const unsigned char *buf, size_t len, bn_Endian endian);
+
+// Returns a big number that is stored in the file at `path` as written by
+// `bn_save_file`. Instead of being read into heap memory, the blocks are
+// mapped from the file, so even huge numbers are ready right away and their
+// pages are only loaded by the functions that read them. Additions,
+// comparisons and the other functions that walk through their operands
+// block by block read them straight from the file. The number can be used and
+// modified like every other one. Modified pages are private copies, so the
+// file is never changed, and the blocks move to the heap when the number
+// grows. `bn_destroy` unmaps the file, which must not be truncated or
+// overwritten (also not by `bn_save_file`) while it is mapped. Small numbers
+// and all numbers on big endian hosts are read into memory as usual. Returns
+// a null pointer if the file can't be mapped or isn't a valid file.
+BigNum *bn_map_file(const char *path);
+
+// Writes `n` to the file at `path`, replacing its contents. The file consists
+// of a 16-byte header (the magic bytes "BIGNUM", 0x00 and 0x01, and the
+// amount of bytes that follow as 64-bit little endian integer) and the blocks
+// in little endian, padded with 0-bytes to a multiple of 8 bytes. Files are
+// the same for both block sizes. Returns 1 on success and 0 if the file
+// couldn't be written completely.
+int bn_save_file(BigNum *n, const char *path);
+
+// Converts a decimal string to a big number. The string must only consist of
+// the digits 0-9 and may have leading zeros. Returns a null pointer if a null
+// pointer, an empty or an invalid string is provided. Long strings are
+// converted by divide and conquer, so the cost is dominated by a few large
+// multiplications.
+BigNum *bn_from_decimal(const char *str);
+
+// Returns an upper bound for the amount of decimal digits of `n`, which is
+// exact or one too large. A buffer of `bn_decimal_max_len(n) + 1` chars is
+// always large enough for `bn_to_decimal`.
+size_t bn_decimal_max_len(BigNum *n);
+
+// Writes the decimal representation of `n` without leading zeros and with a
+// terminating 0 to `buf`, which can hold `cap` chars. Returns the amount of
+// digits written, or 0 if `buf` is too small, in which case `buf` is left
+// untouched. Numbers of many blocks are converted by divide and conquer with
+// powers of 10 that are computed once per call.
+size_t bn_to_decimal(BigNum *n, char *buf, size_t cap);
+
 // Compares the big numbers `n1` and `n2`. Returns a positive result, if `n1`
 // is greater than `n2`. Returns a negative result, if `n1` is less than `n2`.
 // Returns 0, if `n1` is equal to `n2`.
@@ -71,13 +350,149 @@ int bn_equal_to(BigNum *n1, BigNum *n2);
 // Returns the result of the addition `n1` + `n2` as a new big number.
 BigNum *bn_add(BigNum *n1, BigNum *n2);
 
+// Writes the result of the addition `n1` + `n2` to `dst` and returns `dst`.
+// The existing data of `dst` is reused where possible. `dst` may alias `n1`
+// and/or `n2`.
+BigNum *bn_add_into(BigNum *dst, BigNum *n1, BigNum *n2);
+
+// Adds `n` to `acc` in place and returns `acc`.
+BigNum *bn_add_assign(BigNum *acc, BigNum *n);
+
 // Returns the result of the subtraction `n2` - `n1` as a new big number.
 // Returns a null pointer if `n2` is greater than `n1`.
 BigNum *bn_subtract(BigNum *n1, BigNum *n2);
 
+// Writes the result of the subtraction `n1` - `n2` to `dst` and returns `dst`.
+// Returns a null pointer and leaves `dst` untouched if `n2` is greater than
+// `n1`. `dst` may alias `n1` and/or `n2`.
+BigNum *bn_subtract_into(BigNum *dst, BigNum *n1, BigNum *n2);
+
+// Subtracts `n` from `acc` in place and returns `acc`. Returns a null pointer
+// and leaves `acc` untouched if `n` is greater than `acc`.
+BigNum *bn_subtract_assign(BigNum *acc, BigNum *n);
+
 // Returns the result of the multiplication `n1` * `n2` as a new big number.
+// Depending on the lengths of the operands, this uses the schoolbook method,
+// Karatsuba, Toom-Cook 3 or a number-theoretic transform (see
+// `bn_set_mul_thresholds`).
 BigNum *bn_multiply(BigNum *n1, BigNum *n2);
 
+// Writes the result of the multiplication `n1` * `n2` to `dst` and returns
+// `dst`. `dst` may alias `n1` and/or `n2`, but the product is only built in
+// the existing data of `dst` if it doesn't.
+BigNum *bn_multiply_into(BigNum *dst, BigNum *n1, BigNum *n2);
+
+// Multiplies `acc` by `n` in place and returns `acc`.
+BigNum *bn_multiply_assign(BigNum *acc, BigNum *n);
+
+// Adds the product `a` * `b` to `acc` in place and returns `acc`. Short
+// operands are multiplied row by row straight into `acc`, without storing the
+// product. `acc` may alias `a` and/or `b`.
+BigNum *bn_addmul(BigNum *acc, BigNum *a, BigNum *b);
+
+// Subtracts the product `a` * `b` from `acc` in place and returns `acc`.
+// Returns a null pointer and leaves the value of `acc` untouched if the
+// product is greater than `acc`. `acc` may alias `a` and/or `b`.
+BigNum *bn_submul(BigNum *acc, BigNum *a, BigNum *b);
+
+// Adds the product `a` * `m` to `acc` in place and returns `acc`. `acc` may
+// alias `a`.
+BigNum *bn_addmul_u32(BigNum *acc, BigNum *a, uint32_t m);
+
+// Creates an accumulator with the value 0, allocated with the current
+// allocator. Numbers added to it are only added digit by digit, and the
+// carries of all of them are propagated at once when the value is read or
+// after about 2^32 additions, when a slot could overflow. This makes long
+// sums much faster than repeated `bn_add` calls.
+bn_Accumulator *bn_accumulator_new();
+
+// Destroys `acc`, freeing all its allocated heap memory and setting `*acc` to
+// NULL.
+void bn_accumulator_destroy(bn_Accumulator **acc);
+
+// Sets the value of `acc` to 0, keeping its memory.
+void bn_accumulator_reset(bn_Accumulator *acc);
+
+// Adds `n` to `acc`.
+void bn_accumulator_add(bn_Accumulator *acc, BigNum *n);
+
+// Adds the product `a` * `m` to `acc`.
+void bn_accumulator_addmul_u32(bn_Accumulator *acc, BigNum *a, uint32_t m);
+
+// Adds the product `a` * `b` to `acc`. This takes one row per 32 bits of `b`,
+// so it is meant for short `b`.
+void bn_accumulator_addmul(bn_Accumulator *acc, BigNum *a, BigNum *b);
+
+// Returns the value of `acc` as a new big number.
+BigNum *bn_accumulator_value(bn_Accumulator *acc);
+
+// Writes the value of `acc` to `dst` and returns `dst`.
+BigNum *bn_accumulator_value_into(BigNum *dst, bn_Accumulator *acc);
+
+// Returns the result of the multiplication `n` * `n` as a new big number. This
+// is faster than `bn_multiply(n, n)`, since each cross product of two blocks
+// is only computed once.
+BigNum *bn_square(BigNum *n);
+
+// Writes the result of the multiplication `n` * `n` to `dst` and returns
+// `dst`. `dst` may alias `n`, but the square is only built in the existing
+// data of `dst` if it doesn't.
+BigNum *bn_square_into(BigNum *dst, BigNum *n);
+
+// Sets the amount of blocks that the shorter operand of a multiplication
+// needs to have for Karatsuba (`karatsuba`), Toom-Cook 3 (`toom3`) and the
+// number-theoretic transform (`ntt`) to be used. Smaller operands use the
+// schoolbook method. The same thresholds apply to `bn_square`. The defaults
+// are 32, 240 and 4096. `karatsuba` is at least 8, `toom3` at least
+// `karatsuba` and `ntt` at least `toom3`. The transform supports products of
+// up to 2^28 bits; larger ones are split by the other algorithms. This is not
+// thread-safe and should be called before any multiplications are running.
+void bn_set_mul_thresholds(size_t karatsuba, size_t toom3, size_t ntt);
+
+// Sets the amount of threads, including the calling thread, that large
+// multiplications and the batch functions use, and returns the amount that
+// is used now. 0 uses one thread per online processor. The default is 1, in
+// which case no threads are started. Results don't depend on the amount of
+// threads. With more than one thread, the global allocator must be
+// thread-safe, since the other threads allocate their temporaries with it
+// (even within an arena scope). This is not thread-safe and must not be
+// called while any operation is running.
+size_t bn_set_threads(size_t threads);
+
+// Sets the amount of blocks that the shorter operand of a Karatsuba or
+// Toom-Cook 3 multiplication needs to have for its partial products to be
+// computed by several threads. The default is 2048 and the minimum is 64.
+// This is not thread-safe and should be called before any multiplications
+// are running.
+void bn_set_parallel_threshold(size_t len);
+
+// Writes the sums of the counters of all threads since the last
+// `bn_stats_reset` to `stats`. Without BN_STATS all counters are 0. This may
+// be called from any thread at any time, for example by a metrics exporter.
+void bn_stats_snapshot(bn_Stats *stats);
+
+// Starts counting from 0 again for all threads.
+void bn_stats_reset();
+
+// Returns the name of `op`, like "multiply" for `BN_STATS_MULTIPLY`, or a null
+// pointer if there is no such operation.
+const char *bn_stats_op_name(bn_StatsOp op);
+
+// Returns the name of the kernels that the innermost loops of additions,
+// subtractions and multiplications use. They are chosen for the CPU when the
+// library is loaded: "adx" needs the BMI2 and ADX extensions of x86-64,
+// "x86-64" uses carry flag loops of any x86-64 CPU and "portable" is plain C.
+// The first two need 64-bit blocks. The environment variable `BN_KERNELS` can
+// name a supported kernel to use it instead, which is meant for benchmarks.
+const char *bn_kernels_name();
+
+// Sets the amount of blocks that the divisor and the quotient of a division
+// both need to have for the division to be split recursively as described by
+// Burnikel and Ziegler, which reduces it to multiplications. Smaller divisions
+// use Knuth's long division. The default is 64 and the minimum is 4. This is
+// not thread-safe and should be called before any divisions are running.
+void bn_set_div_threshold(size_t len);
+
 // Returns the quotient and the remainder of the division `n1` / `n2`. Returns
 // a null pointer when `n2` is 0. If you are only interested in one of the two,
 // you may use `bn_divide` or `bn_mod` respectively.
@@ -88,15 +503,294 @@ bn_DivideWithRemainderResult *bn_divide_with_remainder(BigNum *n1, BigNum *n2);
 // need the remainder, you may use `bn_divide_with_remainder`.
 BigNum *bn_divide(BigNum *n1, BigNum *n2);
 
+// Writes the quotient of the division `n1` / `n2` to `dst` and returns `dst`.
+// Returns a null pointer and leaves `dst` untouched when `n2` is 0. `dst` may
+// alias `n1` and/or `n2`.
+BigNum *bn_divide_into(BigNum *dst, BigNum *n1, BigNum *n2);
+
+// Divides `acc` by `n` in place and returns `acc`. Returns a null pointer and
+// leaves `acc` untouched when `n` is 0.
+BigNum *bn_divide_assign(BigNum *acc, BigNum *n);
+
 // Returns the remainder of the division `n1` / `n2` as a new big number.
 // Returns a null pointer when `n2` is 0.
 BigNum *bn_mod(BigNum *n1, BigNum *n2);
 
+// Writes the remainder of the division `n1` / `n2` to `dst` and returns
+// `dst`. Returns a null pointer and leaves `dst` untouched when `n2` is 0.
+// `dst` may alias `n1` and/or `n2`.
+BigNum *bn_mod_into(BigNum *dst, BigNum *n1, BigNum *n2);
+
+// Replaces `acc` by `acc` % `n` and returns `acc`. Returns a null pointer and
+// leaves `acc` untouched when `n` is 0.
+BigNum *bn_mod_assign(BigNum *acc, BigNum *n);
+
+// Returns the result of the addition `n` + `m` as a new big number.
+BigNum *bn_add_u32(BigNum *n, uint32_t m);
+
+// Writes the result of the addition `n` + `m` to `dst` and returns `dst`.
+// `dst` may alias `n`.
+BigNum *bn_add_u32_into(BigNum *dst, BigNum *n, uint32_t m);
+
+// Returns the result of the subtraction `n` - `m` as a new big number.
+// Returns a null pointer if `m` is greater than `n`.
+BigNum *bn_sub_u32(BigNum *n, uint32_t m);
+
+// Writes the result of the subtraction `n` - `m` to `dst` and returns `dst`.
+// Returns a null pointer and leaves `dst` untouched if `m` is greater than
+// `n`. `dst` may alias `n`.
+BigNum *bn_sub_u32_into(BigNum *dst, BigNum *n, uint32_t m);
+
+// Returns the result of the multiplication `n` * `m` as a new big number.
+BigNum *bn_mul_u32(BigNum *n, uint32_t m);
+
+// Writes the result of the multiplication `n` * `m` to `dst` and returns
+// `dst`. `dst` may alias `n`.
+BigNum *bn_mul_u32_into(BigNum *dst, BigNum *n, uint32_t m);
+
+// Returns the quotient of the division `n` / `d` as a new big number and
+// writes the remainder to `*remainder` unless `remainder` is a null pointer.
+// Returns a null pointer if `d` is 0.
+BigNum *bn_divmod_u32(BigNum *n, uint32_t d, uint32_t *remainder);
+
+// Writes the quotient of the division `n` / `d` to `dst`, writes the
+// remainder to `*remainder` unless `remainder` is a null pointer and returns
+// `dst`. Returns a null pointer and leaves `dst` untouched if `d` is 0. `dst`
+// may alias `n`.
+BigNum *bn_divmod_u32_into(BigNum *dst, BigNum *n, uint32_t d, uint32_t *remainder);
+
+// Returns the remainder of the division `n` / `d`, or 0 if `d` is 0.
+uint32_t bn_mod_u32(BigNum *n, uint32_t d);
+
+// Returns `n` * 2^`bits` as a new big number.
+BigNum *bn_shift_left(BigNum *n, size_t bits);
+
+// Writes `n` * 2^`bits` to `dst` and returns `dst`. `dst` may alias `n`.
+BigNum *bn_shift_left_into(BigNum *dst, BigNum *n, size_t bits);
+
+// Shifts `acc` left by `bits` bits in place and returns `acc`.
+BigNum *bn_shift_left_assign(BigNum *acc, size_t bits);
+
+// Returns `n` / 2^`bits` as a new big number.
+BigNum *bn_shift_right(BigNum *n, size_t bits);
+
+// Writes `n` / 2^`bits` to `dst` and returns `dst`. `dst` may alias `n`.
+BigNum *bn_shift_right_into(BigNum *dst, BigNum *n, size_t bits);
+
+// Shifts `acc` right by `bits` bits in place and returns `acc`.
+BigNum *bn_shift_right_assign(BigNum *acc, size_t bits);
+
+// Returns the bitwise and of `n1` and `n2` as a new big number.
+BigNum *bn_and(BigNum *n1, BigNum *n2);
+
+// Writes the bitwise and of `n1` and `n2` to `dst` and returns `dst`. `dst`
+// may alias `n1` and/or `n2`.
+BigNum *bn_and_into(BigNum *dst, BigNum *n1, BigNum *n2);
+
+// Replaces `acc` by the bitwise and of `acc` and `n` and returns `acc`.
+BigNum *bn_and_assign(BigNum *acc, BigNum *n);
+
+// Returns the bitwise or of `n1` and `n2` as a new big number.
+BigNum *bn_or(BigNum *n1, BigNum *n2);
+
+// Writes the bitwise or of `n1` and `n2` to `dst` and returns `dst`. `dst`
+// may alias `n1` and/or `n2`.
+BigNum *bn_or_into(BigNum *dst, BigNum *n1, BigNum *n2);
+
+// Replaces `acc` by the bitwise or of `acc` and `n` and returns `acc`.
+BigNum *bn_or_assign(BigNum *acc, BigNum *n);
+
+// Returns the bitwise exclusive or of `n1` and `n2` as a new big number.
+BigNum *bn_xor(BigNum *n1, BigNum *n2);
+
+// Writes the bitwise exclusive or of `n1` and `n2` to `dst` and returns
+// `dst`. `dst` may alias `n1` and/or `n2`.
+BigNum *bn_xor_into(BigNum *dst, BigNum *n1, BigNum *n2);
+
+// Replaces `acc` by the bitwise exclusive or of `acc` and `n` and returns
+// `acc`.
+BigNum *bn_xor_assign(BigNum *acc, BigNum *n);
+
+// Returns the amount of significant bits of `n`, which is 0 for 0.
+size_t bn_bit_length(BigNum *n);
+
+// Returns bit `bit` of `n`, where bit 0 is the least significant bit. Bits
+// beyond the end of `n` are 0.
+int bn_test_bit(BigNum *n, size_t bit);
+
+// Returns the amount of trailing 0-bits of `n`, which is the largest k such
+// that 2^k divides `n`. Returns 0 for 0.
+size_t bn_trailing_zeros(BigNum *n);
+
+// Returns the greatest common divisor of `n1` and `n2` as a new big number,
+// which is 0 if both are 0. This uses Lehmer's algorithm, which advances the
+// Euclidean algorithm by about a block per pass over the numbers.
+BigNum *bn_gcd(BigNum *n1, BigNum *n2);
+
+// Writes the greatest common divisor of `n1` and `n2` to `dst` and returns
+// `dst`. `dst` may alias `n1` and/or `n2`.
+BigNum *bn_gcd_into(BigNum *dst, BigNum *n1, BigNum *n2);
+
+// Returns the greatest common divisor g of `n1` and `n2` as a new big number
+// and writes Bezout cofactors to `x` and `y`, such that `n1` * `x` = g
+// (mod `n2`) and `n2` * `y` = g (mod `n1`) with `x` < `n2` / g and `y` <
+// `n1` / g. If one of the numbers is 0, the cofactor of the other one is 1
+// and its own cofactor 0. `x` and `y` may alias `n1` and/or `n2`, but not each
+// other.
+BigNum *bn_gcdext(BigNum *n1, BigNum *n2, BigNum *x, BigNum *y);
+
+// Returns the inverse x of `n` modulo `mod` with `n` * x = 1 (mod `mod`) and
+// x < `mod` as a new big number. Returns a null pointer if `mod` is 0 or `n`
+// has no inverse, i.e. the greatest common divisor of `n` and `mod` is not 1.
+BigNum *bn_modinv(BigNum *n, BigNum *mod);
+
+// Writes the inverse of `n` modulo `mod` to `dst` and returns `dst`. Returns
+// a null pointer and leaves `dst` untouched if there is none. `dst` may alias
+// `n` and/or `mod`.
+BigNum *bn_modinv_into(BigNum *dst, BigNum *n, BigNum *mod);
+
+// Creates a Barrett context for the modulus `mod`, copying `mod`. Returns a
+// null pointer if `mod` is 0.
+bn_BarrettCtx *bn_barrett_ctx_new(BigNum *mod);
+
+// Destroys `ctx`, freeing all its allocated heap memory and setting `*ctx` to
+// NULL.
+void bn_barrett_ctx_destroy(bn_BarrettCtx **ctx);
+
+// Returns `n` % m for the modulus m of `ctx` as a new big number. Each
+// m->len blocks of `n` beyond 2 * m->len take two multiplications instead of
+// a division.
+BigNum *bn_mod_ctx(BigNum *n, bn_BarrettCtx *ctx);
+
+// Writes `n` % m for the modulus m of `ctx` to `dst` and returns `dst`. `dst`
+// may alias `n`.
+BigNum *bn_mod_ctx_into(BigNum *dst, BigNum *n, bn_BarrettCtx *ctx);
+
+// Returns (`n1` * `n2`) % m for the modulus m of `ctx` as a new big number.
+BigNum *bn_mulmod_ctx(BigNum *n1, BigNum *n2, bn_BarrettCtx *ctx);
+
+// Writes (`n1` * `n2`) % m for the modulus m of `ctx` to `dst` and returns
+// `dst`. `dst` may alias `n1` and/or `n2`.
+BigNum *bn_mulmod_ctx_into(BigNum *dst, BigNum *n1, BigNum *n2, bn_BarrettCtx *ctx);
+
 // Returns the result of the modular exponentiation (`base` ^ `exp`) % `mod` as
 // a new big number. Returns a null pointer if `mod` is 0. This function uses
-// the square and multiply algorithm.
+// a sliding window exponentiation, with the window size depending on the
+// length of `exp`. For odd moduli, it works in Montgomery form like
+// `bn_power_mod_ctx`.
 BigNum *bn_power_mod(BigNum *base, BigNum *exp, BigNum *mod);
 
+// Writes the result of the modular exponentiation (`base` ^ `exp`) % `mod` to
+// `dst` and returns `dst`. Returns a null pointer and leaves `dst` untouched
+// if `mod` is 0. `dst` may alias any of the operands.
+BigNum *bn_power_mod_into(BigNum *dst, BigNum *base, BigNum *exp, BigNum *mod);
+
+// Creates a Montgomery context for the modulus `mod`, copying `mod`. Returns
+// a null pointer if `mod` is even (this includes 0).
+bn_MontCtx *bn_mont_ctx_new(BigNum *mod);
+
+// Same as `bn_mont_ctx_new`, but computes R^2 mod m by doublings and
+// Montgomery squarings, whose running time only depends on `mod->len`. Use it
+// for secret moduli, like the primes of an RSA key.
+bn_MontCtx *bn_mont_ctx_new_ct(BigNum *mod);
+
+// Destroys `ctx`, freeing all its allocated heap memory and setting `*ctx` to
+// NULL.
+void bn_mont_ctx_destroy(bn_MontCtx **ctx);
+
+// Returns the result of the modular exponentiation (`base` ^ `exp`) % m for
+// the modulus m of `ctx` as a new big number. Intermediate results are kept in
+// Montgomery form, so no division is needed besides reducing `base`.
+BigNum *bn_power_mod_ctx(BigNum *base, BigNum *exp, bn_MontCtx *ctx);
+
+// Writes the result of `bn_power_mod_ctx` to `dst` and returns `dst`. `dst`
+// may alias `base` or `exp`.
+BigNum *bn_power_mod_ctx_into(BigNum *dst, BigNum *base, BigNum *exp, bn_MontCtx *ctx);
+
+// Same as `bn_power_mod_ctx`, but uses a fixed window exponentiation. The
+// sequence of multiplications only depends on `exp->len` and the precomputed
+// powers are always read completely, so neither leaks the bits of `exp`. This
+// is slower than the sliding window for the same exponent, since it also
+// multiplies for windows which are 0.
+BigNum *bn_power_mod_ctx_fixed_window(BigNum *base, BigNum *exp, bn_MontCtx *ctx);
+
+// Computes (`base` ^ `exp`) % m for the modulus m of `ctx` in constant time
+// and returns it as a new big number. `exp` is treated as a number with as
+// many blocks as m (or as `exp` if it is longer), scanned in fixed windows
+// with a table lookup that reads every entry. The base is converted without
+// a division and all Montgomery reductions subtract without branches. So the
+// running time and the memory access pattern only depend on the lengths of
+// `base`, `exp` and m. The result is trimmed like every big number, which
+// only depends on whether its top blocks are 0.
+BigNum *bn_power_mod_ctx_ct(BigNum *base, BigNum *exp, bn_MontCtx *ctx);
+
+// Writes the result of `bn_power_mod_ctx_ct` to `dst` and returns `dst`.
+// `dst` may alias `base` or `exp`.
+BigNum *bn_power_mod_ctx_ct_into(BigNum *dst, BigNum *base, BigNum *exp, bn_MontCtx *ctx);
+
+// Same as `bn_power_mod_ctx_ct`, but creates the context for `mod` with
+// `bn_mont_ctx_new_ct` first. Returns a null pointer if `mod` is even (this
+// includes 0).
+BigNum *bn_power_mod_ct(BigNum *base, BigNum *exp, BigNum *mod);
+
+// Writes the result of `bn_power_mod_ct` to `dst` and returns `dst`. Returns a
+// null pointer and leaves `dst` untouched if `mod` is even. `dst` may alias
+// any of the operands.
+BigNum *bn_power_mod_ct_into(BigNum *dst, BigNum *base, BigNum *exp, BigNum *mod);
+
+// Returns the product of (`bases[i]` ^ `exps[i]`) % m for the `count` items
+// and the modulus m of `ctx` as a new big number. The exponents are processed
+// together with Straus' method, so all items share the squarings of one
+// exponentiation.
+BigNum *bn_multi_power_mod_ctx(BigNum **bases, BigNum **exps, size_t count, bn_MontCtx *ctx);
+
+// Writes the result of `bn_multi_power_mod_ctx` to `dst` and returns `dst`.
+// `dst` may alias any of the bases or exponents.
+BigNum *bn_multi_power_mod_ctx_into(BigNum *dst, BigNum **bases, BigNum **exps, size_t count, bn_MontCtx *ctx);
+
+// Same as `bn_multi_power_mod_ctx`, but creates the context for `mod` once.
+// Even moduli multiply the results of `bn_power_mod`. Returns a null pointer
+// if `mod` is 0.
+BigNum *bn_multi_power_mod(BigNum **bases, BigNum **exps, size_t count, BigNum *mod);
+
+// Creates a table of powers of `base` for exponents of up to `max_exp_bits`
+// bits modulo the modulus of `ctx`, which must outlive the table. The table
+// takes about `max_exp_bits` squarings to build and holds about a sixth as
+// many powers of `ctx->mod->len` blocks for exponents of a few thousand bits.
+bn_FixedBaseTable *bn_fixed_base_table_new(BigNum *base, size_t max_exp_bits, bn_MontCtx *ctx);
+
+// Destroys `table`, freeing all its allocated heap memory and setting
+// `*table` to NULL. The context of the table is not destroyed.
+void bn_fixed_base_table_destroy(bn_FixedBaseTable **table);
+
+// Returns (base ^ `exp`) % m for the base and the modulus m of `table` as a
+// new big number. This only needs about one multiplication per digit of `exp`
+// and no squarings. Returns a null pointer if `exp` has more bits than the
+// table was created for.
+BigNum *bn_power_mod_fixed_base(BigNum *exp, bn_FixedBaseTable *table);
+
+// Writes the result of `bn_power_mod_fixed_base` to `dst` and returns `dst`.
+// Returns a null pointer and leaves `dst` untouched if `exp` is too long.
+// `dst` may alias `exp`.
+BigNum *bn_power_mod_fixed_base_into(BigNum *dst, BigNum *exp, bn_FixedBaseTable *table);
+
+// Writes the products `n1[i]` * `n2[i]` of `n` pairs to the existing big
+// numbers `out[i]` and returns `out`. All products share one scratch space.
+// `out[i]` may alias `n1[i]` and/or `n2[i]`, but no other operand.
+BigNum **bn_multiply_batch(BigNum **n1, BigNum **n2, BigNum **out, size_t n);
+
+// Writes (`bases[i]` ^ `exps[i]`) % m for the modulus m of `ctx` to the
+// existing big numbers `out[i]` for all `n` items and returns `out`. Groups of
+// items are exponentiated side by side with interleaved blocks, so that the
+// Montgomery multiplications of a group run as vectorizable loops. `out[i]`
+// may alias `bases[i]` or `exps[i]`, but no other operand.
+BigNum **bn_power_mod_ctx_batch(BigNum **bases, BigNum **exps, bn_MontCtx *ctx, BigNum **out, size_t n);
+
+// Same as `bn_power_mod_ctx_batch`, but creates the context for `mod` once.
+// Even moduli are handled by `bn_power_mod_into` one item after another.
+// Returns a null pointer and leaves `out` untouched if `mod` is 0.
+BigNum **bn_power_mod_batch(BigNum **bases, BigNum **exps, BigNum *mod, BigNum **out, size_t n);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,642 @@
+// Runs microbenchmarks on arithmetic functions.
+//
+// Every operation is measured for a sweep of operand lengths. Operands are
+// generated from a fixed seed, so runs with the same arguments measure the
+// same numbers. The results can be printed as a table, as CSV or as JSON and
+// can be compared against a CSV file of an earlier run:
+//
+//   ./bench --csv > before.csv
+//   (change something)
+//   ./bench --compare before.csv
+//
+// Run `./bench --help` for all options.
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <time.h>
+
+// Allocations of the library are counted by replacing malloc and realloc
+// before including it. This also counts the memory that the pool allocator and
+// arenas get from the system. The counter is atomic, since other threads
+// allocate as well with `--threads`.
+static _Atomic size_t bench_allocations = 0;
+
+static void *bench_malloc(size_t size) {
+    bench_allocations++;
+    return malloc(size);
+}
+
+static void *bench_realloc(void *ptr, size_t size) {
+    bench_allocations++;
+    return realloc(ptr, size);
+}
+
+#define malloc(size) bench_malloc(size)
+#define realloc(ptr, size) bench_realloc(ptr, size)
+#include "arithmetic.c"
+#undef malloc
+#undef realloc
+
+typedef enum OutputFormat {
+    FORMAT_TABLE,
+    FORMAT_CSV,
+    FORMAT_JSON,
+} OutputFormat;
+
+typedef struct BenchResult {
+    const char *op;
+    size_t len;
+    double ns_per_op;
+    double ops_per_sec;
+    double allocations_per_op;
+} BenchResult;
+
+// Operands of a benchmark. Which of them are used depends on the operation.
+typedef struct BenchOperands {
+    BigNum *n1;
+    BigNum *n2;
+    BigNum *dst;
+    bn_MontCtx *ctx;
+    bn_BarrettCtx *barrett;
+    bn_FixedBaseTable *table;
+    bn_Accumulator *acc;
+    char *str;
+    size_t str_cap;
+} BenchOperands;
+
+typedef struct BenchOp {
+    const char *name;
+    // Largest operand length in blocks that is measured by default. The
+    // quadratic and cubic operations would take too long for 100k blocks.
+    size_t default_max_len;
+    void (*setup)(BenchOperands *operands, size_t len);
+    void (*run)(BenchOperands *operands);
+} BenchOp;
+
+static uint64_t bench_rng_state;
+
+// xorshift64*, which is plenty for generating operands
+static uint64_t bench_rand() {
+    bench_rng_state ^= bench_rng_state >> 12;
+    bench_rng_state ^= bench_rng_state << 25;
+    bench_rng_state ^= bench_rng_state >> 27;
+    return bench_rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+// Returns a random number with exactly `len` blocks
+static BigNum *bench_random(size_t len) {
+    BigNum *n = bn_with_len(len);
+    for (size_t offset = 0; offset < len; offset++) {
+        bn_write_block(n, offset, (bn_block_t)bench_rand());
+    }
+    if (bn_get_block_unchecked(n, len - 1) == 0) {
+        bn_write_block(n, len - 1, 1);
+    }
+    return n;
+}
+
+static void setup_two(BenchOperands *operands, size_t len) {
+    operands->n1 = bench_random(len);
+    operands->n2 = bench_random(len);
+    // Make sure that n1 - n2 is defined
+    if (bn_less_than(operands->n1, operands->n2)) {
+        BigNum *tmp = operands->n1;
+        operands->n1 = operands->n2;
+        operands->n2 = tmp;
+    }
+}
+
+static void setup_accumulator(BenchOperands *operands, size_t len) {
+    setup_two(operands, len);
+    operands->acc = bn_accumulator_new();
+}
+
+static void setup_divide(BenchOperands *operands, size_t len) {
+    // Dividend twice as long as the divisor, as in a reduction after a
+    // multiplication
+    operands->n1 = bench_random(2 * len);
+    operands->n2 = bench_random(len);
+}
+
+static void setup_mod_ctx(BenchOperands *operands, size_t len) {
+    setup_divide(operands, len);
+    operands->barrett = bn_barrett_ctx_new(operands->n2);
+}
+
+static void setup_power_mod(BenchOperands *operands, size_t len) {
+    operands->n1 = bench_random(len);
+    operands->n2 = bench_random(len);
+    operands->dst = bench_random(len);
+    // Odd modulus, so that the Montgomery context can be used
+    bn_write_block(operands->dst, 0, bn_get_block_unchecked(operands->dst, 0) | 1);
+    operands->ctx = bn_mont_ctx_new(operands->dst);
+}
+
+static void setup_fixed_base(BenchOperands *operands, size_t len) {
+    setup_power_mod(operands, len);
+    operands->table = bn_fixed_base_table_new(operands->n1, bn_bit_length(operands->n2), operands->ctx);
+}
+
+static void setup_hex(BenchOperands *operands, size_t len) {
+    operands->n1 = bench_random(len);
+    operands->str_cap = bn_hex_len(operands->n1) + 1;
+    operands->str = malloc(operands->str_cap);
+    bn_to_hex(operands->n1, operands->str, operands->str_cap);
+}
+
+static void setup_decimal(BenchOperands *operands, size_t len) {
+    operands->n1 = bench_random(len);
+    operands->str_cap = bn_decimal_max_len(operands->n1) + 1;
+    operands->str = malloc(operands->str_cap);
+    bn_to_decimal(operands->n1, operands->str, operands->str_cap);
+}
+
+static void run_add(BenchOperands *operands) {
+    BigNum *result = bn_add(operands->n1, operands->n2);
+    bn_destroy(&result);
+}
+
+static void run_subtract(BenchOperands *operands) {
+    BigNum *result = bn_subtract(operands->n1, operands->n2);
+    bn_destroy(&result);
+}
+
+// Adds into the same accumulator every time, so compare it with `add`
+static void run_accumulator_add(BenchOperands *operands) {
+    bn_accumulator_add(operands->acc, operands->n1);
+}
+
+static void run_multiply(BenchOperands *operands) {
+    BigNum *result = bn_multiply(operands->n1, operands->n2);
+    bn_destroy(&result);
+}
+
+static void run_square(BenchOperands *operands) {
+    BigNum *result = bn_square(operands->n1);
+    bn_destroy(&result);
+}
+
+static void run_divide_with_remainder(BenchOperands *operands) {
+    bn_DivideWithRemainderResult *result = bn_divide_with_remainder(operands->n1, operands->n2);
+    bn_destroy(&result->quotient);
+    bn_destroy(&result->remainder);
+    free(result);
+}
+
+// Divides by a constant that fits into 32 bits, so compare it with
+// `divide_with_remainder` by a one block number
+static void run_divmod_u32(BenchOperands *operands) {
+    uint32_t remainder;
+    BigNum *result = bn_divmod_u32(operands->n1, 1000000007, &remainder);
+    bn_destroy(&result);
+}
+
+static void run_mod(BenchOperands *operands) {
+    BigNum *result = bn_mod(operands->n1, operands->n2);
+    bn_destroy(&result);
+}
+
+static void run_mod_ctx(BenchOperands *operands) {
+    BigNum *result = bn_mod_ctx(operands->n1, operands->barrett);
+    bn_destroy(&result);
+}
+
+static void run_power_mod(BenchOperands *operands) {
+    BigNum *result = bn_power_mod(operands->n1, operands->n2, operands->dst);
+    bn_destroy(&result);
+}
+
+static void run_power_mod_ctx(BenchOperands *operands) {
+    BigNum *result = bn_power_mod_ctx(operands->n1, operands->n2, operands->ctx);
+    bn_destroy(&result);
+}
+
+static void run_power_mod_ctx_ct(BenchOperands *operands) {
+    BigNum *result = bn_power_mod_ctx_ct(operands->n1, operands->n2, operands->ctx);
+    bn_destroy(&result);
+}
+
+// One operation is BN_BATCH_LANES exponentiations, so compare it with
+// BN_BATCH_LANES times `power_mod_ctx`
+static void run_power_mod_ctx_batch(BenchOperands *operands) {
+    BigNum *bases[BN_BATCH_LANES], *exps[BN_BATCH_LANES], *out[BN_BATCH_LANES];
+    for (size_t i = 0; i < BN_BATCH_LANES; i++) {
+        bases[i] = operands->n1;
+        exps[i] = operands->n2;
+        out[i] = bn_zero();
+    }
+    bn_power_mod_ctx_batch(bases, exps, operands->ctx, out, BN_BATCH_LANES);
+    for (size_t i = 0; i < BN_BATCH_LANES; i++) {
+        bn_destroy(&out[i]);
+    }
+}
+
+// Two exponentiations, so compare it with twice `power_mod_ctx`
+static void run_multi_power_mod_ctx(BenchOperands *operands) {
+    BigNum *bases[2] = { operands->n1, operands->n2 };
+    BigNum *exps[2] = { operands->n2, operands->n1 };
+    BigNum *result = bn_multi_power_mod_ctx(bases, exps, 2, operands->ctx);
+    bn_destroy(&result);
+}
+
+static void run_power_mod_fixed_base(BenchOperands *operands) {
+    BigNum *result = bn_power_mod_fixed_base(operands->n2, operands->table);
+    bn_destroy(&result);
+}
+
+static void run_to_hex(BenchOperands *operands) {
+    bn_to_hex(operands->n1, operands->str, operands->str_cap);
+}
+
+static void run_from_hex(BenchOperands *operands) {
+    BigNum *result = bn_from_hex(operands->str);
+    bn_destroy(&result);
+}
+
+static void run_to_decimal(BenchOperands *operands) {
+    bn_to_decimal(operands->n1, operands->str, operands->str_cap);
+}
+
+static void run_from_decimal(BenchOperands *operands) {
+    BigNum *result = bn_from_decimal(operands->str);
+    bn_destroy(&result);
+}
+
+static const BenchOp bench_ops[] = {
+    { "add", 100000, setup_two, run_add },
+    { "subtract", 100000, setup_two, run_subtract },
+    { "accumulator_add", 100000, setup_accumulator, run_accumulator_add },
+    { "multiply", 100000, setup_two, run_multiply },
+    { "square", 100000, setup_two, run_square },
+    { "divide_with_remainder", 10000, setup_divide, run_divide_with_remainder },
+    { "divmod_u32", 100000, setup_two, run_divmod_u32 },
+    { "mod", 10000, setup_divide, run_mod },
+    { "mod_ctx", 10000, setup_mod_ctx, run_mod_ctx },
+    { "power_mod", 128, setup_power_mod, run_power_mod },
+    { "power_mod_ctx", 128, setup_power_mod, run_power_mod_ctx },
+    { "power_mod_ctx_ct", 128, setup_power_mod, run_power_mod_ctx_ct },
+    { "power_mod_ctx_batch", 128, setup_power_mod, run_power_mod_ctx_batch },
+    { "multi_power_mod_ctx", 128, setup_power_mod, run_multi_power_mod_ctx },
+    { "power_mod_fixed_base", 128, setup_fixed_base, run_power_mod_fixed_base },
+    { "to_hex", 100000, setup_hex, run_to_hex },
+    { "from_hex", 100000, setup_hex, run_from_hex },
+    { "to_decimal", 100000, setup_decimal, run_to_decimal },
+    { "from_decimal", 10000, setup_decimal, run_from_decimal },
+};
+
+#define NUM_BENCH_OPS (sizeof(bench_ops) / sizeof(bench_ops[0]))
+
+// Arena that every single operation runs in with `--allocator arena`
+static bn_Arena *bench_arena = NULL;
+
+// Runs `op` once, in `bench_arena` if there is one
+static void run_once(const BenchOp *op, BenchOperands *operands) {
+    if (bench_arena) {
+        bn_arena_begin(bench_arena);
+        op->run(operands);
+        bn_arena_end(bench_arena);
+        bn_arena_reset(bench_arena);
+    } else {
+        op->run(operands);
+    }
+}
+
+static double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void destroy_operands(BenchOperands *operands) {
+    if (operands->n1) {
+        bn_destroy(&operands->n1);
+    }
+    if (operands->n2) {
+        bn_destroy(&operands->n2);
+    }
+    if (operands->dst) {
+        bn_destroy(&operands->dst);
+    }
+    if (operands->ctx) {
+        bn_mont_ctx_destroy(&operands->ctx);
+    }
+    if (operands->barrett) {
+        bn_barrett_ctx_destroy(&operands->barrett);
+    }
+    if (operands->table) {
+        bn_fixed_base_table_destroy(&operands->table);
+    }
+    if (operands->acc) {
+        bn_accumulator_destroy(&operands->acc);
+    }
+    free(operands->str);
+}
+
+// Runs `op` with operands of `len` blocks until at least `min_time` seconds
+// have passed.
+static BenchResult run_bench(const BenchOp *op, size_t len, double min_time) {
+    BenchOperands operands = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0 };
+    op->setup(&operands, len);
+
+    // One warm-up run, which also makes sure that slow operations are not
+    // repeated unnecessarily often
+    run_once(op, &operands);
+
+    // The clock is read after batches of doubling size, so that reading it
+    // doesn't distort the timings of fast operations
+    size_t iterations = 0;
+    size_t batch = 1;
+    size_t allocations_before = bench_allocations;
+    double start = bench_now();
+    double elapsed;
+    do {
+        for (size_t i = 0; i < batch; i++) {
+            run_once(op, &operands);
+        }
+        iterations += batch;
+        batch *= 2;
+        elapsed = bench_now() - start;
+    } while (elapsed < min_time);
+    size_t allocations = bench_allocations - allocations_before;
+
+    destroy_operands(&operands);
+
+    BenchResult result = {
+        op->name,
+        len,
+        elapsed * 1e9 / iterations,
+        iterations / elapsed,
+        (double)allocations / iterations,
+    };
+    return result;
+}
+
+// A single line of an earlier CSV result
+typedef struct PreviousResult {
+    char op[64];
+    size_t len;
+    double ns_per_op;
+} PreviousResult;
+
+// Reads the results of an earlier run with `--csv`. Returns the amount of
+// results read, or -1 if the file can't be opened.
+static long read_previous(const char *path, PreviousResult **results) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+
+    size_t count = 0;
+    size_t capacity = 64;
+    *results = malloc(capacity * sizeof(PreviousResult));
+
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        PreviousResult result;
+        if (sscanf(line, "%63[^,],%zu,%lf", result.op, &result.len, &result.ns_per_op) != 3) {
+            // Header or garbage
+            continue;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            *results = realloc(*results, capacity * sizeof(PreviousResult));
+        }
+        (*results)[count++] = result;
+    }
+
+    fclose(file);
+    return count;
+}
+
+static const PreviousResult *find_previous(const PreviousResult *results, long count, const BenchResult *result) {
+    for (long i = 0; i < count; i++) {
+        if (results[i].len == result->len && !strcmp(results[i].op, result->op)) {
+            return &results[i];
+        }
+    }
+    return NULL;
+}
+
+static void print_header(OutputFormat format, int compare) {
+    if (format == FORMAT_CSV) {
+        printf("op,len,ns_per_op,ops_per_sec,allocations_per_op\n");
+    } else if (format == FORMAT_JSON) {
+        printf("[\n");
+    } else if (compare) {
+        printf("%-22s %8s %14s %14s %9s %10s\n", "op", "len", "ns/op", "before", "change", "allocs/op");
+    } else {
+        printf("%-22s %8s %14s %14s %10s\n", "op", "len", "ns/op", "ops/sec", "allocs/op");
+    }
+}
+
+static void print_result(OutputFormat format, const BenchResult *result, const PreviousResult *previous, int first) {
+    if (format == FORMAT_CSV) {
+        printf(
+            "%s,%zu,%.1f,%.1f,%.2f\n",
+            result->op,
+            result->len,
+            result->ns_per_op,
+            result->ops_per_sec,
+            result->allocations_per_op
+        );
+    } else if (format == FORMAT_JSON) {
+        printf(
+            "%s  {\"op\": \"%s\", \"len\": %zu, \"ns_per_op\": %.1f, \"ops_per_sec\": %.1f, \"allocations_per_op\": %.2f",
+            first ? "" : ",\n",
+            result->op,
+            result->len,
+            result->ns_per_op,
+            result->ops_per_sec,
+            result->allocations_per_op
+        );
+        if (previous) {
+            printf(", \"previous_ns_per_op\": %.1f", previous->ns_per_op);
+        }
+        printf("}");
+    } else if (previous) {
+        double change = (result->ns_per_op / previous->ns_per_op - 1) * 100;
+        printf(
+            "%-22s %8zu %14.1f %14.1f %+8.1f%% %10.2f\n",
+            result->op,
+            result->len,
+            result->ns_per_op,
+            previous->ns_per_op,
+            change,
+            result->allocations_per_op
+        );
+    } else {
+        printf(
+            "%-22s %8zu %14.1f %14.1f %10.2f\n",
+            result->op,
+            result->len,
+            result->ns_per_op,
+            result->ops_per_sec,
+            result->allocations_per_op
+        );
+    }
+    fflush(stdout);
+}
+
+static void print_usage(const char *program) {
+    fprintf(
+        stderr,
+        "usage: %s [options]\n"
+        "\n"
+        "  --csv              print results as CSV\n"
+        "  --json             print results as JSON\n"
+        "  --compare FILE     compare against the CSV output of an earlier run\n"
+        "  --ops OP,OP,...    only run the given operations\n"
+        "  --min-len N        smallest operand length in blocks (default 1)\n"
+        "  --max-len N        largest operand length in blocks (default depends\n"
+        "                     on the operation, at most 100000)\n"
+        "  --min-time SECONDS minimum time per measurement (default 0.2)\n"
+        "  --seed N           seed for the operands (default 1)\n"
+        "  --allocator NAME   allocator for the operations: system (default),\n"
+        "                     pool or arena (reset after every operation)\n"
+        "  --threads N        threads for large multiplications and batches\n"
+        "                     (default 1, 0 for one per processor)\n"
+        "\n"
+        "operations:",
+        program
+    );
+    for (size_t i = 0; i < NUM_BENCH_OPS; i++) {
+        fprintf(stderr, " %s", bench_ops[i].name);
+    }
+    fprintf(stderr, "\n");
+}
+
+// Returns whether `name` is contained in the comma separated list `ops`
+static int op_selected(const char *ops, const char *name) {
+    if (!ops) {
+        return 1;
+    }
+    size_t name_len = strlen(name);
+    for (const char *start = ops; *start; ) {
+        const char *end = strchr(start, ',');
+        size_t len = end ? (size_t)(end - start) : strlen(start);
+        if (len == name_len && !strncmp(start, name, len)) {
+            return 1;
+        }
+        if (!end) {
+            break;
+        }
+        start = end + 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    OutputFormat format = FORMAT_TABLE;
+    const char *compare_path = NULL;
+    const char *ops = NULL;
+    size_t min_len = 1;
+    size_t max_len = 0;
+    double min_time = 0.2;
+    uint64_t seed = 1;
+    const char *allocator = "system";
+    size_t threads = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(arg, "--csv")) {
+            format = FORMAT_CSV;
+        } else if (!strcmp(arg, "--json")) {
+            format = FORMAT_JSON;
+        } else if (!strcmp(arg, "--compare") && value) {
+            compare_path = value;
+            i++;
+        } else if (!strcmp(arg, "--ops") && value) {
+            ops = value;
+            i++;
+        } else if (!strcmp(arg, "--min-len") && value) {
+            min_len = strtoull(value, NULL, 10);
+            i++;
+        } else if (!strcmp(arg, "--max-len") && value) {
+            max_len = strtoull(value, NULL, 10);
+            i++;
+        } else if (!strcmp(arg, "--min-time") && value) {
+            min_time = strtod(value, NULL);
+            i++;
+        } else if (!strcmp(arg, "--seed") && value) {
+            seed = strtoull(value, NULL, 10);
+            i++;
+        } else if (!strcmp(arg, "--allocator") && value) {
+            allocator = value;
+            i++;
+        } else if (!strcmp(arg, "--threads") && value) {
+            threads = strtoull(value, NULL, 10);
+            i++;
+        } else if (!strcmp(arg, "--help") || !strcmp(arg, "-h")) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (min_len == 0) {
+        min_len = 1;
+    }
+
+    if (!strcmp(allocator, "pool")) {
+        bn_set_allocator(bn_pool_allocator());
+    } else if (!strcmp(allocator, "arena")) {
+        bench_arena = bn_arena_new();
+    } else if (strcmp(allocator, "system")) {
+        fprintf(stderr, "error: unknown allocator %s\n", allocator);
+        return 1;
+    }
+    bn_set_threads(threads);
+
+    PreviousResult *previous = NULL;
+    long num_previous = 0;
+    if (compare_path) {
+        num_previous = read_previous(compare_path, &previous);
+        if (num_previous < 0) {
+            fprintf(stderr, "error: can't open %s\n", compare_path);
+            return 1;
+        }
+    }
+
+    print_header(format, compare_path != NULL);
+
+    int first = 1;
+    for (size_t i = 0; i < NUM_BENCH_OPS; i++) {
+        const BenchOp *op = &bench_ops[i];
+        if (!op_selected(ops, op->name)) {
+            continue;
+        }
+
+        // Every operation starts with the same operands, independent of
+        // which other operations are selected
+        bench_rng_state = seed ? seed : 1;
+
+        size_t op_max_len = max_len ? max_len : op->default_max_len;
+        for (size_t len = min_len; len <= op_max_len; ) {
+            BenchResult result = run_bench(op, len, min_time);
+            print_result(format, &result, find_previous(previous, num_previous, &result), first);
+            first = 0;
+
+            // 1, 2, 5, 10, 20, 50, ... for the default minimum
+            size_t magnitude = 1;
+            while (magnitude * 10 <= len) {
+                magnitude *= 10;
+            }
+            size_t digit = len / magnitude;
+            len = (digit < 2 ? 2 : digit < 5 ? 5 : 10) * magnitude;
+        }
+    }
+
+    if (format == FORMAT_JSON) {
+        printf("\n]\n");
+    }
+
+    free(previous);
+    if (bench_arena) {
+        bn_arena_destroy(&bench_arena);
+    }
+    bn_pool_release();
+    return 0;
+}
@@ -0,0 +1,508 @@
+#ifndef BN_BIGINT_HPP_
+#define BN_BIGINT_HPP_
+
+// Header-only C++ wrapper around arithmetic.h.
+//
+// `bn::BigInt` owns a BigNum and frees it when it goes out of scope. The
+// arithmetic operators don't compute anything by themselves but return small
+// expression objects that are evaluated when they are assigned. This makes
+// `x = a * b + c` write the product directly into the existing buffer of `x`
+// and add `c` in place, instead of allocating a temporary for `a * b` and
+// another one for the sum. A temporary is only created where the operands of
+// an expression alias the destination in a way that requires it (as in
+// `x = a * b + x`) or where both operands of an operation are expressions
+// themselves.
+//
+// Expression objects keep references to their BigInt operands. They are meant
+// to be assigned in the same statement they are created in and must not be
+// stored (for example with `auto`) beyond the lifetime of their operands.
+//
+// Errors of the C functions are reported as exceptions. Subtractions with a
+// negative result and divisions by 0 throw `std::domain_error`. The
+// destination keeps its previous value if an exception is thrown. Expressions
+// in which a subtraction, division or modulo could fail after a part of the
+// expression has already been written to the destination (as in
+// `x = a * b - c`) are therefore evaluated into a temporary first.
+
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "arithmetic.h"
+
+namespace bn {
+
+class BigInt;
+
+namespace detail {
+
+// Operations of expression nodes. `into` has the semantics of the matching
+// `bn_*_into` function and returns a null pointer on errors, which are then
+// reported with `error`. `can_fail` is set for operations that may return a
+// null pointer for valid operands.
+struct Add {
+    static const bool can_fail = false;
+    static const bool commutative = true;
+    static const char *error() {
+        return "bn::BigInt: addition failed";
+    }
+    static BigNum *into(BigNum *dst, BigNum *n1, BigNum *n2) {
+        return bn_add_into(dst, n1, n2);
+    }
+};
+
+struct Subtract {
+    static const bool can_fail = true;
+    static const bool commutative = false;
+    static const char *error() {
+        return "bn::BigInt: negative result of subtraction";
+    }
+    static BigNum *into(BigNum *dst, BigNum *n1, BigNum *n2) {
+        return bn_subtract_into(dst, n1, n2);
+    }
+};
+
+struct Multiply {
+    static const bool can_fail = false;
+    static const bool commutative = true;
+    static const char *error() {
+        return "bn::BigInt: multiplication failed";
+    }
+    static BigNum *into(BigNum *dst, BigNum *n1, BigNum *n2) {
+        return bn_multiply_into(dst, n1, n2);
+    }
+};
+
+struct Divide {
+    static const bool can_fail = true;
+    static const bool commutative = false;
+    static const char *error() {
+        return "bn::BigInt: division by zero";
+    }
+    static BigNum *into(BigNum *dst, BigNum *n1, BigNum *n2) {
+        return bn_divide_into(dst, n1, n2);
+    }
+};
+
+struct Mod {
+    static const bool can_fail = true;
+    static const bool commutative = false;
+    static const char *error() {
+        return "bn::BigInt: division by zero";
+    }
+    static BigNum *into(BigNum *dst, BigNum *n1, BigNum *n2) {
+        return bn_mod_into(dst, n1, n2);
+    }
+};
+
+// Unevaluated operation `Op` on the operands `L` and `R`, which are either
+// BigInts or expressions themselves.
+template <class Op, class L, class R>
+class Expr;
+
+// How operands are stored in expressions. BigInts are referenced, nested
+// expressions are copied, since they are usually temporaries.
+template <class T>
+struct Stored {
+    typedef T type;
+};
+
+template <>
+struct Stored<BigInt> {
+    typedef const BigInt &type;
+};
+
+// Whether `T` can be used as operand of the arithmetic operators
+template <class T>
+struct IsOperand : std::false_type {};
+
+template <>
+struct IsOperand<BigInt> : std::true_type {};
+
+template <class Op, class L, class R>
+struct IsOperand<Expr<Op, L, R> > : std::true_type {};
+
+// Whether the evaluation of `T` into the destination may fail after the
+// destination has been written. `eval_node` evaluates the left operand of a
+// node into the destination before it applies the operation, unless the left
+// operand is a BigInt.
+template <class T>
+struct WritesBeforeFailing : std::false_type {};
+
+template <class Op, class L, class R>
+struct WritesBeforeFailing<Expr<Op, L, R> > : std::integral_constant<bool,
+    (Op::can_fail && !std::is_same<L, BigInt>::value) ||
+    WritesBeforeFailing<L>::value ||
+    WritesBeforeFailing<R>::value
+> {};
+
+template <class Op, class L, class R>
+class Expr {
+public:
+    Expr(const L &l, const R &r) : l_(l), r_(r) {}
+
+    // Writes the value of the expression to `dst`
+    void eval_into(BigInt &dst) const;
+
+private:
+    typename Stored<L>::type l_;
+    typename Stored<R>::type r_;
+};
+
+} // namespace detail
+
+// Unsigned big number owning a BigNum. A moved-from BigInt may only be
+// assigned to or destroyed.
+class BigInt {
+public:
+    // Creates a BigInt representing 0.
+    BigInt() : n_(checked(bn_zero())) {}
+
+    // Creates a BigInt representing `n`.
+    BigInt(uint32_t n) : n_(checked(bn_from_uint32_t(n))) {}
+
+    BigInt(const BigInt &other) : n_(checked(bn_copy(other.n_))) {}
+
+    BigInt(BigInt &&other) noexcept : n_(other.n_) {
+        other.n_ = nullptr;
+    }
+
+    // Evaluates the expression `e`. Delegating to `BigInt()` makes the
+    // destructor free the number if the evaluation throws.
+    template <class Op, class L, class R>
+    BigInt(const detail::Expr<Op, L, R> &e) : BigInt() {
+        e.eval_into(*this);
+    }
+
+    ~BigInt() {
+        if (n_) {
+            bn_destroy(&n_);
+        }
+    }
+
+    BigInt &operator=(const BigInt &other) {
+        if (this != &other) {
+            BigInt copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    BigInt &operator=(BigInt &&other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    // Evaluates the expression `e` into the existing buffer of this BigInt,
+    // or into a temporary if this BigInt would be left with a partial result
+    // when `e` throws.
+    template <class Op, class L, class R>
+    BigInt &operator=(const detail::Expr<Op, L, R> &e) {
+        if (detail::WritesBeforeFailing<detail::Expr<Op, L, R> >::value) {
+            BigInt result(e);
+            swap(result);
+        } else {
+            ensure();
+            e.eval_into(*this);
+        }
+        return *this;
+    }
+
+    // Converts a hex string to a BigInt like `bn_from_hex`. Throws
+    // `std::invalid_argument` if `str` is not a valid hex string.
+    static BigInt from_hex(const char *str) {
+        BigNum *n = bn_from_hex(str);
+        if (!n) {
+            throw std::invalid_argument("bn::BigInt: invalid hex string");
+        }
+        return BigInt(n, AdoptTag());
+    }
+
+    // Returns a BigInt that takes ownership of `n`. Throws `std::bad_alloc` if
+    // `n` is a null pointer, so results of the C functions can be passed
+    // directly.
+    static BigInt adopt(BigNum *n) {
+        return BigInt(checked(n), AdoptTag());
+    }
+
+    // Converts a decimal string to a BigInt like `bn_from_decimal`. Throws
+    // `std::invalid_argument` if `str` is not a valid decimal string.
+    static BigInt from_decimal(const char *str) {
+        BigNum *n = bn_from_decimal(str);
+        if (!n) {
+            throw std::invalid_argument("bn::BigInt: invalid decimal string");
+        }
+        return BigInt(n, AdoptTag());
+    }
+
+    // Returns the hex representation in lowercase without leading zeros.
+    std::string to_hex() const {
+        std::string str(bn_hex_len(n_) + 1, '\0');
+        str.resize(bn_to_hex(n_, &str[0], str.size()));
+        return str;
+    }
+
+    // Returns the decimal representation.
+    std::string to_decimal() const {
+        std::string str(bn_decimal_max_len(n_) + 1, '\0');
+        str.resize(bn_to_decimal(n_, &str[0], str.size()));
+        return str;
+    }
+
+    // Returns the underlying BigNum, which stays owned by this BigInt.
+    BigNum *get() const {
+        return n_;
+    }
+
+    // Gives up ownership of the underlying BigNum and returns it. The caller
+    // has to destroy it with `bn_destroy`.
+    BigNum *release() {
+        BigNum *n = n_;
+        n_ = nullptr;
+        return n;
+    }
+
+    void swap(BigInt &other) noexcept {
+        BigNum *tmp = n_;
+        n_ = other.n_;
+        other.n_ = tmp;
+    }
+
+    // Makes sure that the BigInt can hold at least `capacity` blocks without
+    // reallocating.
+    void reserve(size_t capacity) {
+        bn_reserve(n_, capacity);
+    }
+
+    // Releases all memory that is not needed to hold the current value.
+    void shrink_to_fit() {
+        bn_shrink_to_fit(n_);
+    }
+
+    // Prints the value like `bn_print_hex`.
+    void print_hex() const {
+        bn_print_hex(n_);
+    }
+
+    template <class E>
+    BigInt &operator+=(const E &e);
+
+    template <class E>
+    BigInt &operator-=(const E &e);
+
+    template <class E>
+    BigInt &operator*=(const E &e);
+
+    template <class E>
+    BigInt &operator/=(const E &e);
+
+    template <class E>
+    BigInt &operator%=(const E &e);
+
+private:
+    struct AdoptTag {};
+
+    BigInt(BigNum *n, AdoptTag) : n_(n) {}
+
+    static BigNum *checked(BigNum *n) {
+        if (!n) {
+            throw std::bad_alloc();
+        }
+        return n;
+    }
+
+    // Gives a moved-from BigInt a value again
+    void ensure() {
+        if (!n_) {
+            n_ = checked(bn_zero());
+        }
+    }
+
+    BigNum *n_;
+};
+
+namespace detail {
+
+template <class Op>
+inline void check(BigNum *result) {
+    if (!result) {
+        throw std::domain_error(Op::error());
+    }
+}
+
+inline void eval(BigInt &dst, const BigInt &n) {
+    if (&dst != &n) {
+        dst = n;
+    }
+}
+
+template <class Op, class L, class R>
+inline void eval(BigInt &dst, const Expr<Op, L, R> &e) {
+    e.eval_into(dst);
+}
+
+// Writes `l` `Op` `r` to `dst`. `l` and `r` may reference `dst`; the
+// overloads make sure that an operand is read before `dst` is overwritten.
+template <class Op>
+inline void eval_node(BigInt &dst, const BigInt &l, const BigInt &r) {
+    check<Op>(Op::into(dst.get(), l.get(), r.get()));
+}
+
+template <class Op, class L>
+inline void eval_node(BigInt &dst, const L &l, const BigInt &r) {
+    if (&r == &dst) {
+        BigInt r_copy(r);
+        eval(dst, l);
+        check<Op>(Op::into(dst.get(), dst.get(), r_copy.get()));
+    } else {
+        eval(dst, l);
+        check<Op>(Op::into(dst.get(), dst.get(), r.get()));
+    }
+}
+
+template <class Op, class R>
+inline void eval_node(BigInt &dst, const BigInt &l, const R &r) {
+    if (Op::commutative && &l != &dst) {
+        eval(dst, r);
+        check<Op>(Op::into(dst.get(), dst.get(), l.get()));
+    } else {
+        BigInt r_value(r);
+        check<Op>(Op::into(dst.get(), l.get(), r_value.get()));
+    }
+}
+
+template <class Op, class L, class R>
+inline void eval_node(BigInt &dst, const L &l, const R &r) {
+    BigInt r_value(r);
+    eval(dst, l);
+    check<Op>(Op::into(dst.get(), dst.get(), r_value.get()));
+}
+
+template <class Op, class L, class R>
+inline void Expr<Op, L, R>::eval_into(BigInt &dst) const {
+    eval_node<Op>(dst, l_, r_);
+}
+
+} // namespace detail
+
+// The left operand of the compound assignments is the destination itself, so
+// `eval_node` evaluates `e` into a temporary, and the destination is kept on
+// errors without copying it first.
+template <class E>
+inline BigInt &BigInt::operator+=(const E &e) {
+    detail::eval_node<detail::Add>(*this, *this, e);
+    return *this;
+}
+
+template <class E>
+inline BigInt &BigInt::operator-=(const E &e) {
+    detail::eval_node<detail::Subtract>(*this, *this, e);
+    return *this;
+}
+
+template <class E>
+inline BigInt &BigInt::operator*=(const E &e) {
+    detail::eval_node<detail::Multiply>(*this, *this, e);
+    return *this;
+}
+
+template <class E>
+inline BigInt &BigInt::operator/=(const E &e) {
+    detail::eval_node<detail::Divide>(*this, *this, e);
+    return *this;
+}
+
+template <class E>
+inline BigInt &BigInt::operator%=(const E &e) {
+    detail::eval_node<detail::Mod>(*this, *this, e);
+    return *this;
+}
+
+template <class L, class R>
+inline typename std::enable_if<
+    detail::IsOperand<L>::value && detail::IsOperand<R>::value,
+    detail::Expr<detail::Add, L, R>
+>::type operator+(const L &l, const R &r) {
+    return detail::Expr<detail::Add, L, R>(l, r);
+}
+
+template <class L, class R>
+inline typename std::enable_if<
+    detail::IsOperand<L>::value && detail::IsOperand<R>::value,
+    detail::Expr<detail::Subtract, L, R>
+>::type operator-(const L &l, const R &r) {
+    return detail::Expr<detail::Subtract, L, R>(l, r);
+}
+
+template <class L, class R>
+inline typename std::enable_if<
+    detail::IsOperand<L>::value && detail::IsOperand<R>::value,
+    detail::Expr<detail::Multiply, L, R>
+>::type operator*(const L &l, const R &r) {
+    return detail::Expr<detail::Multiply, L, R>(l, r);
+}
+
+template <class L, class R>
+inline typename std::enable_if<
+    detail::IsOperand<L>::value && detail::IsOperand<R>::value,
+    detail::Expr<detail::Divide, L, R>
+>::type operator/(const L &l, const R &r) {
+    return detail::Expr<detail::Divide, L, R>(l, r);
+}
+
+template <class L, class R>
+inline typename std::enable_if<
+    detail::IsOperand<L>::value && detail::IsOperand<R>::value,
+    detail::Expr<detail::Mod, L, R>
+>::type operator%(const L &l, const R &r) {
+    return detail::Expr<detail::Mod, L, R>(l, r);
+}
+
+inline bool operator==(const BigInt &n1, const BigInt &n2) {
+    return bn_equal_to(n1.get(), n2.get());
+}
+
+inline bool operator!=(const BigInt &n1, const BigInt &n2) {
+    return !bn_equal_to(n1.get(), n2.get());
+}
+
+inline bool operator<(const BigInt &n1, const BigInt &n2) {
+    return bn_compare(n1.get(), n2.get()) < 0;
+}
+
+inline bool operator<=(const BigInt &n1, const BigInt &n2) {
+    return bn_compare(n1.get(), n2.get()) <= 0;
+}
+
+inline bool operator>(const BigInt &n1, const BigInt &n2) {
+    return bn_compare(n1.get(), n2.get()) > 0;
+}
+
+inline bool operator>=(const BigInt &n1, const BigInt &n2) {
+    return bn_compare(n1.get(), n2.get()) >= 0;
+}
+
+// Returns `n` * `n`, which is faster than `n * n`.
+inline BigInt square(const BigInt &n) {
+    BigInt result;
+    bn_square_into(result.get(), n.get());
+    return result;
+}
+
+// Returns (`base` ^ `exp`) % `mod`. Throws `std::domain_error` if `mod` is 0.
+inline BigInt power_mod(const BigInt &base, const BigInt &exp, const BigInt &mod) {
+    BigInt result;
+    if (!bn_power_mod_into(result.get(), base.get(), exp.get(), mod.get())) {
+        throw std::domain_error("bn::BigInt: modulus is zero");
+    }
+    return result;
+}
+
+inline void swap(BigInt &n1, BigInt &n2) noexcept {
+    n1.swap(n2);
+}
+
+} // namespace bn
+
+#endif // BN_BIGINT_HPP_
@@ -1,17 +1,17 @@
 #include <iostream>
-#include "arithmetic.h"
+#include "bigint.hpp"
 
 int main() {
     std::cout << "This is C++" << std::endl;
-    BigNum *n1 = bn_one();
-    BigNum *n2 = bn_one();
-    BigNum *result = bn_add(n1, n2);
+    bn::BigInt n1 = 1;
+    bn::BigInt n2 = 1;
+    bn::BigInt result = n1 + n2;
     std::cout << "  ";
-    bn_print_hex(n1);
+    n1.print_hex();
     std::cout << "+ ";
-    bn_print_hex(n2);
+    n2.print_hex();
     std::cout << "----------" << std::endl;
     std::cout << "= ";
-    bn_print_hex(result);
+    result.print_hex();
     return 0;
 }
@@ -29,6 +29,9 @@ typedef struct TestResult {
         return r;                               \
     } while (0)
 
+// Amount of blocks that a number with `bits` significant bits needs
+#define BLOCKS_FOR_BITS(bits) (((bits) + BN_BLOCK_BITS - 1) / BN_BLOCK_BITS)
+
 int tests_run = 0;
 int tests_successful = 0;
 
@@ -55,6 +58,486 @@ static void print_test_results() {
         tests_run - tests_successful
     );
 }
+static TestResult test_bn_reserve() {
+    BigNum *n, *should_result;
+
+    n = bn_from_hex("EBA11829 27F45C1B");
+    bn_reserve(n, 16);
+    TEST_ASSERT("grows capacity", n->capacity == 16);
+    TEST_ASSERT("keeps len", n->len == BLOCKS_FOR_BITS(64));
+    should_result = bn_from_hex("EBA11829 27F45C1B");
+    TEST_ASSERT_EQ("keeps value", n, should_result);
+    bn_reserve(n, 4);
+    TEST_ASSERT("never shrinks capacity", n->capacity == 16);
+
+    void *data = n->data;
+    bn_add_into(n, bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF"), bn_one());
+    TEST_ASSERT("reuses reserved data", n->data == data);
+    should_result = bn_from_hex("1 00000000 00000000 00000000");
+    TEST_ASSERT_EQ("", n, should_result);
+    bn_subtract_assign(n, bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF"));
+    TEST_ASSERT("trimming keeps capacity", n->len == 1 && n->capacity == 16);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_shrink_to_fit() {
+    BigNum *n, *should_result;
+
+    n = bn_from_hex("1 00000000 00000000 00000000 00000000 00000000 00000000 00000000 00000000");
+    bn_subtract_assign(n, bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF"));
+    TEST_ASSERT("", n->capacity == BLOCKS_FOR_BITS(257));
+    bn_shrink_to_fit(n);
+    TEST_ASSERT("", n->len == 1 && n->capacity == BN_INLINE_BLOCKS);
+    TEST_ASSERT("moves small numbers inline", n->data == n->inline_blocks);
+    TEST_ASSERT_EQ("keeps value", n, bn_one());
+
+    n = bn_zero();
+    bn_reserve(n, 8);
+    bn_add_into(n, bn_from_hex("EBA11829 27F45C1B"), bn_zero());
+    bn_shrink_to_fit(n);
+    TEST_ASSERT("", n->len == BLOCKS_FOR_BITS(64) && n->capacity == BN_INLINE_BLOCKS);
+    should_result = bn_from_hex("EBA11829 27F45C1B");
+    TEST_ASSERT_EQ("keeps value", n, should_result);
+
+    n = bn_from_hex("1 00000000 00000000 00000000 00000000 00000000 00000000 00000000 00000000");
+    bn_reserve(n, 32);
+    bn_shrink_to_fit(n);
+    TEST_ASSERT("", n->capacity == BLOCKS_FOR_BITS(257) && n->data != n->inline_blocks);
+    should_result = bn_from_hex("1 00000000 00000000 00000000 00000000 00000000 00000000 00000000 00000000");
+    TEST_ASSERT_EQ("keeps value", n, should_result);
+
+    n = bn_one();
+    TEST_ASSERT("stores small numbers inline", n->data == n->inline_blocks);
+    bn_reserve(n, 16);
+    void *data = n->data;
+    TEST_ASSERT("", data != n->inline_blocks);
+    bn_multiply_assign(n, bn_from_uint32_t(3));
+    TEST_ASSERT("copies inline results into reserved data", n->data == data && n->capacity == 16);
+    TEST_ASSERT_EQ("", n, bn_from_uint32_t(3));
+
+    TEST_SUCCESS();
+}
+
+// Counts the bytes that are currently allocated through it
+typedef struct CountingAllocator {
+    size_t allocated;
+    size_t allocations;
+} CountingAllocator;
+
+static void *counting_alloc(void *ctx, size_t size) {
+    CountingAllocator *counter = ctx;
+    counter->allocated += size;
+    counter->allocations++;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    CountingAllocator *counter = ctx;
+    counter->allocated += new_size - old_size;
+    counter->allocations++;
+    return realloc(ptr, new_size);
+}
+
+static void counting_free(void *ctx, void *ptr, size_t size) {
+    CountingAllocator *counter = ctx;
+    counter->allocated -= size;
+    free(ptr);
+}
+
+static TestResult test_bn_set_allocator() {
+    BigNum *n1, *n2, *result, *should_result;
+    CountingAllocator counter = { 0, 0 };
+    bn_Allocator allocator = { counting_alloc, counting_realloc, counting_free, &counter };
+
+    BigNum *outside = bn_from_hex("EBA11829 27F45C1B");
+    BigNum *factor = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF");
+
+    bn_set_allocator(&allocator);
+    n1 = bn_from_hex("1234 56789ABC DEF01234 56789ABC DEF01234 56789ABC");
+    n2 = bn_from_hex("FEDC BA987654 32100123");
+    TEST_ASSERT("", n1->allocator == &allocator && counter.allocated > 0);
+    result = bn_divide(n1, n2);
+    bn_power_mod_into(n1, n1, n2, n2);
+    bn_destroy(&result);
+    bn_destroy(&n1);
+    bn_destroy(&n2);
+    TEST_ASSERT("returns all memory, including scratch", counter.allocated == 0);
+    size_t allocations = counter.allocations;
+
+    // Memory of BigNums that were created before is still handled by the
+    // previous allocator, only the temporaries come from the new one
+    bn_multiply_assign(outside, factor);
+    TEST_ASSERT("", outside->allocator != &allocator && counter.allocated == 0);
+    bn_set_allocator(NULL);
+
+    TEST_ASSERT("", counter.allocations > allocations);
+    n1 = bn_one();
+    TEST_ASSERT("restores the default", n1->allocator != &allocator);
+    should_result = bn_from_hex("EBA11829 27F45C1A FFFFFFFF 145EE7D6 D80BA3E5");
+    TEST_ASSERT_EQ("", outside, should_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_pool_allocator() {
+    BigNum *n1, *n2, *result, *should_result;
+
+    bn_set_allocator(bn_pool_allocator());
+    should_result = bn_from_hex("4E");
+    for (int i = 0; i < 3; i++) {
+        n1 = bn_from_hex("1234 56789ABC DEF01234 56789ABC DEF01234 56789ABC");
+        n2 = bn_from_hex("FEDC BA987654 32100123");
+        bn_multiply_assign(n1, n2);
+        bn_square_into(n1, n1);
+        result = bn_mod(n1, bn_from_uint32_t(101));
+        TEST_ASSERT_EQ("", result, should_result);
+        bn_destroy(&result);
+        bn_destroy(&n1);
+        bn_destroy(&n2);
+    }
+    size_t num_cached = 0;
+    for (size_t class = 0; class < BN_POOL_CLASSES; class++) {
+        num_cached += bn_thread_pool.num_cached[class];
+    }
+    TEST_ASSERT("keeps freed memory", num_cached > 0);
+    bn_pool_release();
+    for (size_t class = 0; class < BN_POOL_CLASSES; class++) {
+        TEST_ASSERT("", bn_thread_pool.num_cached[class] == 0 && !bn_thread_pool.free_lists[class]);
+    }
+    bn_set_allocator(NULL);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_arena() {
+    BigNum *n1, *n2, *result, *should_result;
+    bn_Arena *arena = bn_arena_new();
+
+    // Grown inside of the arena scope, but not allocated in it
+    BigNum *outside = bn_one();
+
+    bn_arena_begin(arena);
+    n1 = bn_from_hex("1234 56789ABC DEF01234 56789ABC DEF01234 56789ABC");
+    n2 = bn_from_hex("FEDC BA987654 32100123");
+    TEST_ASSERT("", n1->allocator == &arena->allocator);
+    result = bn_power_mod(n1, n2, bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF"));
+    bn_multiply_into(outside, result, n1);
+    bn_divide_with_remainder_unchecked(NULL, outside, outside, n2);
+    bn_arena_end(arena);
+
+    TEST_ASSERT("", outside->allocator != &arena->allocator);
+    n1 = bn_one();
+    TEST_ASSERT("restores the previous allocator", n1->allocator != &arena->allocator);
+
+    bn_arena_reset(arena);
+    TEST_ASSERT("keeps a chunk", arena->chunks && !arena->chunks->next && arena->chunks->used == 0);
+    should_result = bn_from_hex("92EA BB4DA2B0 3D3B888E");
+    TEST_ASSERT_EQ("keeps BigNums from outside of the arena", outside, should_result);
+
+    // Nested scopes
+    bn_Arena *inner = bn_arena_new();
+    bn_arena_begin(arena);
+    bn_arena_begin(inner);
+    n1 = bn_one();
+    TEST_ASSERT("", n1->allocator == &inner->allocator);
+    bn_arena_end(inner);
+    n1 = bn_one();
+    TEST_ASSERT("", n1->allocator == &arena->allocator);
+    bn_arena_end(arena);
+    bn_arena_destroy(&inner);
+    bn_arena_destroy(&arena);
+    TEST_ASSERT("", !arena);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_from_hex() {
+    BigNum *n, *should_result;
+
+    n = bn_from_hex("1 00000000");
+    should_result = bn_from_decimal("4294967296");
+    TEST_ASSERT_EQ("", n, should_result);
+
+    n = bn_from_hex("  EbA1 1829 27f4 5c1b ");
+    should_result = bn_from_decimal("16978878635206532123");
+    TEST_ASSERT_EQ("ignores spaces and case", n, should_result);
+
+    n = bn_from_hex("0000 0000 0000 0000 0001");
+    TEST_ASSERT_EQ("", n, bn_one());
+    TEST_ASSERT("trims", n->len == 1);
+
+    TEST_ASSERT("", bn_from_hex("12g") == NULL);
+    TEST_ASSERT("", bn_from_hex("0x12") == NULL);
+    TEST_ASSERT("", bn_from_hex("\xff") == NULL);
+    TEST_ASSERT("", bn_from_hex("  ") == NULL);
+    TEST_ASSERT("", bn_from_hex("") == NULL);
+    TEST_ASSERT("", bn_from_hex(NULL) == NULL);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_to_hex() {
+    BigNum *n;
+    char buf[64];
+
+    n = bn_zero();
+    TEST_ASSERT("", bn_hex_len(n) == 1);
+    TEST_ASSERT("", bn_to_hex(n, buf, sizeof(buf)) == 1 && !strcmp(buf, "0"));
+
+    n = bn_from_hex("EBA11829 27F45C1B");
+    TEST_ASSERT("", bn_hex_len(n) == 16);
+    TEST_ASSERT("", bn_to_hex(n, buf, sizeof(buf)) == 16 && !strcmp(buf, "eba1182927f45c1b"));
+
+    n = bn_from_hex("A 00000000 0000F00D");
+    TEST_ASSERT("", bn_hex_len(n) == 17);
+    TEST_ASSERT("fits exactly", bn_to_hex(n, buf, 18) == 17 && !strcmp(buf, "a000000000000f00d"));
+    strcpy(buf, "untouched");
+    TEST_ASSERT("too small", bn_to_hex(n, buf, 17) == 0 && !strcmp(buf, "untouched"));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_to_bytes() {
+    BigNum *n;
+    unsigned char buf[12];
+
+    n = bn_from_hex("1 02030405 06070809");
+    TEST_ASSERT("", bn_byte_len(n) == 9);
+    TEST_ASSERT("", bn_to_bytes(n, buf, 9, BN_BIG_ENDIAN));
+    TEST_ASSERT("", !memcmp(buf, "\x01\x02\x03\x04\x05\x06\x07\x08\x09", 9));
+    TEST_ASSERT("", bn_to_bytes(n, buf, 12, BN_BIG_ENDIAN));
+    TEST_ASSERT("pads", !memcmp(buf, "\x00\x00\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09", 12));
+    TEST_ASSERT("", bn_to_bytes(n, buf, 12, BN_LITTLE_ENDIAN));
+    TEST_ASSERT("", !memcmp(buf, "\x09\x08\x07\x06\x05\x04\x03\x02\x01\x00\x00\x00", 12));
+    memset(buf, 0xaa, sizeof(buf));
+    TEST_ASSERT("too small", !bn_to_bytes(n, buf, 8, BN_BIG_ENDIAN) && buf[0] == 0xaa);
+
+    n = bn_zero();
+    TEST_ASSERT("", bn_byte_len(n) == 0);
+    TEST_ASSERT("", bn_to_bytes(n, buf, 0, BN_BIG_ENDIAN));
+    TEST_ASSERT("", bn_to_bytes(n, buf, 2, BN_BIG_ENDIAN) && !memcmp(buf, "\x00\x00", 2));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_from_bytes() {
+    BigNum *n, *should_result;
+
+    n = bn_from_bytes((const unsigned char *)"\x00\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09", 11, BN_BIG_ENDIAN);
+    should_result = bn_from_hex("1 02030405 06070809");
+    TEST_ASSERT_EQ("", n, should_result);
+    TEST_ASSERT("trims", n->len == should_result->len);
+
+    n = bn_from_bytes((const unsigned char *)"\x09\x08\x07\x06\x05\x04\x03\x02\x01", 9, BN_LITTLE_ENDIAN);
+    TEST_ASSERT_EQ("", n, should_result);
+
+    n = bn_from_bytes(NULL, 0, BN_BIG_ENDIAN);
+    TEST_ASSERT_EQ("", n, bn_zero());
+    TEST_ASSERT("", bn_from_bytes(NULL, 1, BN_BIG_ENDIAN) == NULL);
+
+    TEST_SUCCESS();
+}
+
+// File that the tests of `bn_save_file` and `bn_map_file` write
+#define TEST_FILE "test_bn_file.tmp"
+
+// Writes `len` bytes from `buf` to TEST_FILE
+static void write_test_file(const char *buf, size_t len) {
+    FILE *file = fopen(TEST_FILE, "wb");
+    fwrite(buf, 1, len, file);
+    fclose(file);
+}
+
+static TestResult test_bn_save_file() {
+    BigNum *n = bn_from_hex("1 02030405 06070809");
+    TEST_ASSERT("", bn_save_file(n, TEST_FILE));
+
+    // The file is the same for both block sizes
+    unsigned char buf[64];
+    FILE *file = fopen(TEST_FILE, "rb");
+    size_t len = fread(buf, 1, sizeof(buf), file);
+    fclose(file);
+    TEST_ASSERT("size", len == 32);
+    TEST_ASSERT("header", memcmp(buf, "BIGNUM\x00\x01\x10\0\0\0\0\0\0\0", 16) == 0);
+    TEST_ASSERT("blocks", memcmp(buf + 16, "\x09\x08\x07\x06\x05\x04\x03\x02\x01\0\0\0\0\0\0\0", 16) == 0);
+
+    TEST_ASSERT("", bn_save_file(n, "no such directory/" TEST_FILE) == 0);
+
+    remove(TEST_FILE);
+    bn_destroy(&n);
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_map_file() {
+    BigNum *n, *mapped, *should_result;
+
+    n = bn_from_hex("1 02030405 06070809");
+    bn_save_file(n, TEST_FILE);
+    mapped = bn_map_file(TEST_FILE);
+    TEST_ASSERT_EQ("small", mapped, n);
+    bn_destroy(&mapped);
+
+    // Leading 0-blocks are trimmed
+    n = bn_with_len(40);
+    for (size_t i = 0; i < 30; i++) {
+        bn_write_block(n, i, BN_BLOCK_MAX - i * 7919);
+    }
+    bn_save_file(n, TEST_FILE);
+    bn_trim(n);
+    mapped = bn_map_file(TEST_FILE);
+    TEST_ASSERT("mapped", mapped->data != mapped->inline_blocks && mapped->allocator != n->allocator);
+    TEST_ASSERT_EQ("", mapped, n);
+    TEST_ASSERT("trims", mapped->len == n->len);
+    should_result = bn_add(n, n);
+    TEST_ASSERT_EQ("add", bn_add(mapped, mapped), should_result);
+    TEST_ASSERT("compare", bn_compare(mapped, should_result) < 0);
+
+    // Growing copies the blocks to the heap and leaves the file as it is
+    bn_add_assign(mapped, mapped);
+    TEST_ASSERT_EQ("grows", mapped, should_result);
+    BigNum *mapped_again = bn_map_file(TEST_FILE);
+    TEST_ASSERT_EQ("file unchanged", mapped_again, n);
+    bn_destroy(&mapped);
+    // Modified pages are private too
+    bn_sub_u32_into(mapped_again, mapped_again, 1);
+    TEST_ASSERT("modified", mapped_again->allocator != n->allocator && bn_less_than(mapped_again, n));
+    bn_destroy(&mapped_again);
+    mapped = bn_map_file(TEST_FILE);
+    TEST_ASSERT_EQ("file unchanged", mapped, n);
+    bn_shrink_to_fit(mapped);
+    TEST_ASSERT_EQ("shrinks", mapped, n);
+    bn_destroy(&mapped);
+
+    TEST_ASSERT("no file", bn_map_file("no such directory/" TEST_FILE) == NULL);
+    write_test_file("BIGNUM\x00\x01\x08\0\0\0\0\0\0\0", 16);
+    TEST_ASSERT("truncated", bn_map_file(TEST_FILE) == NULL);
+    write_test_file("BIGNUM\x00\x02\x08\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 24);
+    TEST_ASSERT("magic", bn_map_file(TEST_FILE) == NULL);
+    write_test_file("BIGNUM\x00\x01\x04\0\0\0\0\0\0\0\0\0\0\0", 20);
+    TEST_ASSERT("unpadded", bn_map_file(TEST_FILE) == NULL);
+    write_test_file("BIGNUM\x00\x01\x08\0\0\0\0\0\0\0\x2a\0\0\0\0\0\0\0", 24);
+    TEST_ASSERT_EQ("valid", bn_map_file(TEST_FILE), bn_from_uint32_t(42));
+
+    remove(TEST_FILE);
+    TEST_SUCCESS();
+}
+
+// Returns 10^`exp`
+static BigNum *power_of_ten(size_t exp) {
+    BigNum *result = bn_one();
+    BigNum *ten = bn_from_uint32_t(10);
+    for (size_t i = 0; i < exp; i++) {
+        bn_multiply_assign(result, ten);
+    }
+    return result;
+}
+
+static TestResult test_bn_from_decimal() {
+    BigNum *n, *should_result;
+
+    n = bn_from_decimal("0");
+    TEST_ASSERT_EQ("", n, bn_zero());
+
+    n = bn_from_decimal("000123");
+    should_result = bn_from_uint32_t(123);
+    TEST_ASSERT_EQ("ignores leading zeros", n, should_result);
+
+    n = bn_from_decimal("4294967296");
+    should_result = bn_from_hex("1 00000000");
+    TEST_ASSERT_EQ("", n, should_result);
+
+    n = bn_from_decimal("18446744073709551615");
+    should_result = bn_from_hex("FFFFFFFF FFFFFFFF");
+    TEST_ASSERT_EQ("", n, should_result);
+
+    // 2^1024
+    n = bn_from_decimal(
+        "17976931348623159077293051907890247336179769789423065727343008115773267580550096313270847732"
+        "24075360211201138798713933576587897688144166224928474306394741243777678934248654852763022196"
+        "01246094119453082952085005768838150682342462881473913110540827237163350510684586298239947245"
+        "938479716304835356329624224137216"
+    );
+    char hex[258];
+    hex[0] = '1';
+    memset(hex + 1, '0', 256);
+    hex[257] = 0;
+    should_result = bn_from_hex(hex);
+    TEST_ASSERT_EQ("", n, should_result);
+
+    // Long enough for the divide and conquer conversion
+    char digits[1602];
+    digits[0] = '1';
+    memset(digits + 1, '0', 1600);
+    digits[1601] = 0;
+    n = bn_from_decimal(digits);
+    should_result = power_of_ten(1600);
+    TEST_ASSERT_EQ("", n, should_result);
+    memset(digits, '9', 1600);
+    digits[1600] = 0;
+    n = bn_from_decimal(digits);
+    bn_subtract_assign(should_result, bn_one());
+    TEST_ASSERT_EQ("", n, should_result);
+
+    TEST_ASSERT("", bn_from_decimal("12a") == NULL);
+    TEST_ASSERT("", bn_from_decimal("-1") == NULL);
+    TEST_ASSERT("", bn_from_decimal("1 000") == NULL);
+    TEST_ASSERT("", bn_from_decimal("") == NULL);
+    TEST_ASSERT("", bn_from_decimal(NULL) == NULL);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_to_decimal() {
+    BigNum *n;
+    char buf[1602];
+
+    n = bn_zero();
+    TEST_ASSERT("", bn_decimal_max_len(n) == 1);
+    TEST_ASSERT("", bn_to_decimal(n, buf, sizeof(buf)) == 1 && !strcmp(buf, "0"));
+
+    n = bn_from_uint32_t(999);
+    TEST_ASSERT("", bn_decimal_max_len(n) == 4);
+    TEST_ASSERT("", bn_to_decimal(n, buf, sizeof(buf)) == 3 && !strcmp(buf, "999"));
+
+    n = bn_from_hex("1 00000000 00000000");
+    TEST_ASSERT("", bn_to_decimal(n, buf, sizeof(buf)) == 20 && !strcmp(buf, "18446744073709551616"));
+    TEST_ASSERT("fits exactly", bn_to_decimal(n, buf, 21) == 20 && !strcmp(buf, "18446744073709551616"));
+    strcpy(buf, "untouched");
+    TEST_ASSERT("too small", bn_to_decimal(n, buf, 20) == 0 && !strcmp(buf, "untouched"));
+
+    // Long enough for the divide and conquer conversion, with zeros at the
+    // boundaries of the split
+    char should_result[1602];
+    n = power_of_ten(1600);
+    should_result[0] = '1';
+    memset(should_result + 1, '0', 1600);
+    should_result[1601] = 0;
+    TEST_ASSERT("", bn_to_decimal(n, buf, sizeof(buf)) == 1601 && !strcmp(buf, should_result));
+    bn_subtract_assign(n, bn_one());
+    memset(should_result, '9', 1600);
+    should_result[1600] = 0;
+    TEST_ASSERT("", bn_to_decimal(n, buf, 1601) == 1600 && !strcmp(buf, should_result));
+
+    // Several levels of splits, where the top half of the digits has no
+    // zeros and a wrong split would put most nonzero digits into one half
+    size_t num_digits = 40000;
+    char *digits = malloc(num_digits + 1);
+    uint32_t state = 12345;
+    for (size_t i = 0; i < num_digits; i++) {
+        state = state * 1103515245 + 12345;
+        int digit = (state >> 16) % 10;
+        digits[i] = '0' + (i < num_digits / 2 ? 1 + digit % 9 : digit);
+    }
+    digits[num_digits] = 0;
+    n = bn_from_decimal(digits);
+    char *written = malloc(num_digits + 1);
+    TEST_ASSERT("long", bn_to_decimal(n, written, num_digits + 1) == num_digits && !strcmp(written, digits));
+    TEST_ASSERT_EQ("long round trip", bn_from_decimal(written), n);
+
+    TEST_SUCCESS();
+}
+
 static TestResult test_bn_compare() {
     BigNum *n1, *n2;
 
@@ -311,162 +794,1277 @@ static TestResult test_bn_multiply() {
     TEST_SUCCESS();
 }
 
-static TestResult test_bn_divide_with_remainder() {
-    BigNum *n1, *n2, *should_quotient, *should_remainder;
-    bn_DivideWithRemainderResult *got_result;
+static TestResult test_bn_kernels_name() {
+    const char *name = bn_kernels_name();
+    TEST_ASSERT("", name);
+
+    // Every supported set of kernels has to compute the same as the portable
+    // one, including lengths that the unrolled loops don't cover completely
+    const bn_Kernels *kernels = bn_kernels;
+    BigNum *n1 = bn_with_len(23);
+    BigNum *n2 = bn_with_len(21);
+    for (size_t i = 0; i < n1->len; i++) {
+        bn_write_block(n1, i, i % 3 ? BN_BLOCK_MAX : i * 2654435761u);
+    }
+    for (size_t i = 0; i < n2->len; i++) {
+        bn_write_block(n2, i, i % 2 ? BN_BLOCK_MAX - i : i * 40503u + 1);
+    }
+    bn_kernels = &bn_kernels_list[BN_KERNELS_COUNT - 1];
+    BigNum *sum = bn_add(n1, n2);
+    BigNum *difference = bn_subtract(n1, n2);
+    BigNum *product = bn_multiply(n1, n2);
+
+    int found = 0;
+    for (size_t i = 0; i < BN_KERNELS_COUNT; i++) {
+        found |= strcmp(name, bn_kernels_list[i].name) == 0;
+        if (!bn_kernels_list[i].supported()) {
+            continue;
+        }
+        bn_kernels = &bn_kernels_list[i];
+        TEST_ASSERT_EQ("sum", bn_add(n1, n2), sum);
+        TEST_ASSERT_EQ("difference", bn_subtract(n1, n2), difference);
+        TEST_ASSERT_EQ("product", bn_multiply(n1, n2), product);
+    }
+    bn_kernels = kernels;
+    TEST_ASSERT("one of the kernels", found);
 
-    n1 = bn_from_hex("EBA11829 27F45C1B");
-    n2 = bn_one();
-    got_result = bn_divide_with_remainder(n1, n2);
-    should_quotient = n1;
-    should_remainder = bn_zero();
-    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
-    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+    TEST_SUCCESS();
+}
 
-    n1 = bn_from_hex("EBA11829 27F45C1B");
-    n2 = bn_from_hex("EBA11829 27F45C1B");
-    got_result = bn_divide_with_remainder(n1, n2);
-    should_quotient = bn_one();
-    should_remainder = bn_zero();
-    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
-    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+static void *test_bn_stats_thread(void *n) {
+    BigNum *sum = bn_add(n, n);
+    bn_destroy(&sum);
+    return NULL;
+}
 
-    n1 = bn_from_hex("EBA11829 27F45C1B");
-    n2 = bn_from_hex("     ACE 12791232");
-    got_result = bn_divide_with_remainder(n1, n2);
-    should_quotient = bn_from_hex("15CEB7");
-    should_remainder = bn_from_hex("80E 08AA1E5D");
-    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
-    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+static TestResult test_bn_stats_snapshot() {
+    BigNum *n1 = bn_with_len(3);
+    BigNum *n2 = bn_with_len(2);
+    for (size_t i = 0; i < n1->len; i++) {
+        bn_write_block(n1, i, i + 1);
+    }
+    bn_write_block(n2, 1, 7);
+
+    bn_stats_reset();
+    BigNum *product = bn_multiply(n1, n2);
+    BigNum *sum = bn_add(n1, n2);
+    // Operations of threads that have exited are kept
+    pthread_t thread;
+    pthread_create(&thread, NULL, test_bn_stats_thread, n1);
+    pthread_join(thread, NULL);
+    bn_Stats stats;
+    bn_stats_snapshot(&stats);
+
+#if BN_STATS
+    TEST_ASSERT("multiply calls", stats.ops[BN_STATS_MULTIPLY].calls == 1);
+    // Length 3 is in the class of the lengths 2 and 3
+    TEST_ASSERT("multiply sizes", stats.ops[BN_STATS_MULTIPLY].sizes[2] == 1);
+    TEST_ASSERT("add calls", stats.ops[BN_STATS_ADD].calls == 2);
+    TEST_ASSERT("subtract calls", stats.ops[BN_STATS_SUBTRACT].calls == 0);
+    TEST_ASSERT("allocations", stats.allocations >= 3);
+    TEST_ASSERT("allocated bytes", stats.allocated_bytes > 0);
+
+    bn_stats_reset();
+    bn_stats_snapshot(&stats);
+    TEST_ASSERT("reset", stats.ops[BN_STATS_ADD].calls == 0 && stats.allocations == 0);
+#else
+    bn_Stats zero;
+    memset(&zero, 0, sizeof(bn_Stats));
+    TEST_ASSERT("disabled", memcmp(&stats, &zero, sizeof(bn_Stats)) == 0);
+#endif
+    TEST_ASSERT("name", strcmp(bn_stats_op_name(BN_STATS_MULTIPLY), "multiply") == 0);
+    TEST_ASSERT("no name", bn_stats_op_name(BN_STATS_OPS) == NULL);
+
+    bn_destroy(&product);
+    bn_destroy(&sum);
+    TEST_SUCCESS();
+}
 
-    n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
-    n2 = bn_from_hex("                  EBA11829 27F45C1B");
-    got_result = bn_divide_with_remainder(n1, n2);
-    should_quotient = bn_from_hex("E34E65BE ED03AB20");
-    should_remainder = bn_from_hex("C477521F C4E2EBD2");
-    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
-    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+static TestResult test_bn_square() {
+    BigNum *n, *got_result, *should_result;
 
-    n1 = bn_from_hex("AA213F 32785D1F E1190ABB");
-    n2 = bn_from_hex("       129E781A C1829FB1");
-    got_result = bn_divide_with_remainder(n1, n2);
-    should_quotient = bn_from_hex("09232E2E");
-    should_remainder = bn_from_hex("03F3ED12 94BB8AED");
-    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
-    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+    got_result = bn_square(bn_zero());
+    TEST_ASSERT_EQ("", got_result, bn_zero());
+    got_result = bn_square(bn_one());
+    TEST_ASSERT_EQ("", got_result, bn_one());
 
-    n1 = bn_from_hex("00AA213F 32785D1F E1190ABB");
-    n2 = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBA");
-    got_result = bn_divide_with_remainder(n1, n2);
-    should_quotient = bn_zero();
-    should_remainder = n1;
-    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
-    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+    n = bn_from_hex("AA213F 32785D1F E1190ABB");
+    got_result = bn_square(n);
+    should_result = bn_from_hex("7110 2C406278 978A3FF3 63247B39 97197E99 CEF92499");
+    TEST_ASSERT_EQ("", got_result, should_result);
 
-    n1 = bn_from_hex("C5367281 19283712");
-    n2 = bn_from_hex("EBA11829 27F45C1B");
-    got_result = bn_divide_with_remainder(n1, n2);
-    should_quotient = bn_zero();
-    should_remainder = n1;
-    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
-    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+    n = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF");
+    got_result = bn_square(n);
+    should_result = bn_multiply(n, n);
+    TEST_ASSERT_EQ("carries through the doubling", got_result, should_result);
 
-    n1 = bn_from_hex("C5367281 19283712");
-    n2 = bn_zero();
-    got_result = bn_divide_with_remainder(n1, n2);
-    TEST_ASSERT("dividing by zero results in null pointer", !got_result);
+    // Same pattern as in test_bn_set_mul_thresholds, compared against the
+    // multiplication for every algorithm
+    n = bn_with_len(301);
+    for (size_t i = 0; i < n->len; i++) {
+        bn_write_block(n, i, i * 2654435761u + 0x9e3779b9);
+    }
+    bn_set_mul_thresholds(1000, 1000, 1000);
+    should_result = bn_multiply(n, n);
+    got_result = bn_square(n);
+    TEST_ASSERT_EQ("schoolbook", got_result, should_result);
+    bn_set_mul_thresholds(8, 1000, 1000);
+    got_result = bn_square(n);
+    TEST_ASSERT_EQ("karatsuba", got_result, should_result);
+    bn_set_mul_thresholds(8, 100, 1000);
+    got_result = bn_square(n);
+    TEST_ASSERT_EQ("toom-3", got_result, should_result);
+    bn_set_mul_thresholds(8, 8, 8);
+    got_result = bn_square(n);
+    TEST_ASSERT_EQ("ntt", got_result, should_result);
+    bn_set_mul_thresholds(32, 240, 4096);
 
     TEST_SUCCESS();
 }
 
-static TestResult test_bn_divide() {
-    BigNum *n1, *n2, *should_result, *got_result;
-
-    n1 = bn_from_hex("EBA11829 27F45C1B");
-    n2 = bn_one();
-    got_result = bn_divide(n1, n2);
-    should_result = n1;
-    TEST_ASSERT_EQ("", got_result, should_result);
+static TestResult test_bn_square_into() {
+    BigNum *n, *dst, *should_result;
 
-    n1 = bn_from_hex("EBA11829 27F45C1B");
-    n2 = bn_from_hex("EBA11829 27F45C1B");
-    got_result = bn_divide(n1, n2);
-    should_result = bn_one();
-    TEST_ASSERT_EQ("", got_result, should_result);
+    n = bn_from_hex("EBA11829 27F45C1B");
+    should_result = bn_from_hex("D8E127BA F566A091 0FBCEDF5 EE9B6AD9");
+    dst = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF");
+    TEST_ASSERT("returns dst", bn_square_into(dst, n) == dst);
+    TEST_ASSERT_EQ("overwrites longer dst", dst, should_result);
+    bn_square_into(n, n);
+    TEST_ASSERT_EQ("dst aliases operand", n, should_result);
 
-    n1 = bn_from_hex("EBA11829 27F45C1B");
-    n2 = bn_from_hex("     ACE 12791232");
-    got_result = bn_divide(n1, n2);
-    should_result = bn_from_hex("15CEB7");
-    TEST_ASSERT_EQ("", got_result, should_result);
+    TEST_SUCCESS();
+}
 
-    n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
-    n2 = bn_from_hex("                  EBA11829 27F45C1B");
-    got_result = bn_divide(n1, n2);
-    should_result = bn_from_hex("E34E65BE ED03AB20");
-    TEST_ASSERT_EQ("", got_result, should_result);
+static TestResult test_bn_add_into() {
+    BigNum *n1, *n2, *dst, *should_result;
 
     n1 = bn_from_hex("AA213F 32785D1F E1190ABB");
-    n2 = bn_from_hex("       129E781A C1829FB1");
-    got_result = bn_divide(n1, n2);
-    should_result = bn_from_hex("09232E2E");
-    TEST_ASSERT_EQ("", got_result, should_result);
+    n2 = bn_from_hex("       EBA11829 27F45C1B");
+    should_result = bn_from_hex("00AA2140 1E197549 090D66D6");
+    dst = bn_from_hex("12345678 12345678 12345678 12345678 12345678");
+    TEST_ASSERT("returns dst", bn_add_into(dst, n1, n2) == dst);
+    TEST_ASSERT_EQ("overwrites longer dst", dst, should_result);
+    dst = bn_zero();
+    bn_add_into(dst, n1, n2);
+    TEST_ASSERT_EQ("grows shorter dst", dst, should_result);
+
+    n1 = bn_from_hex("FFFFFFFF FFFFFFFF");
+    bn_add_into(n1, n1, n1);
+    should_result = bn_from_hex("1 FFFFFFFF FFFFFFFE");
+    TEST_ASSERT_EQ("dst aliases both operands", n1, should_result);
 
-    n1 = bn_from_hex("C5367281 19283712");
-    n2 = bn_zero();
-    got_result = bn_divide(n1, n2);
-    TEST_ASSERT("dividing by zero results in null pointer", !got_result);
+    n1 = bn_from_hex("       EBA11829 27F45C1B");
+    n2 = bn_from_hex("AA213F 32785D1F E1190ABB");
+    bn_add_assign(n1, n2);
+    should_result = bn_from_hex("00AA2140 1E197549 090D66D6");
+    TEST_ASSERT_EQ("assign", n1, should_result);
 
     TEST_SUCCESS();
 }
 
-static TestResult test_bn_mod() {
-    BigNum *n1, *n2, *got_result, *should_result;
+static TestResult test_bn_subtract_into() {
+    BigNum *n1, *n2, *dst, *should_result;
 
-    n1 = bn_from_hex("EBA11829 27F45C1B");
+    n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
+    n2 = bn_from_hex("CEAFFABC FAEDEADB AEBFABEF BAEBFEBA");
+    should_result = bn_from_hex("0288066B 2A499E57 9863DD31 55597978");
+    dst = bn_one();
+    TEST_ASSERT("returns dst", bn_subtract_into(dst, n1, n2) == dst);
+    TEST_ASSERT_EQ("", dst, should_result);
+    bn_subtract_into(n2, n1, n2);
+    TEST_ASSERT_EQ("dst aliases second operand", n2, should_result);
+
+    n1 = bn_from_hex("1 00000000");
+    n2 = bn_from_hex("  FFFFFFFF");
+    bn_subtract_assign(n1, n2);
+    TEST_ASSERT_EQ("assign", n1, bn_one());
+    bn_subtract_assign(n1, n1);
+    TEST_ASSERT_EQ("dst aliases both operands", n1, bn_zero());
+
+    n1 = bn_zero();
     n2 = bn_one();
-    got_result = bn_mod(n1, n2);
-    should_result = bn_zero();
-    TEST_ASSERT_EQ("", got_result, should_result);
+    TEST_ASSERT("negative subtraction results in null pointer", !bn_subtract_assign(n1, n2));
+    TEST_ASSERT_EQ("dst is untouched on failure", n1, bn_zero());
 
-    n1 = bn_from_hex("EBA11829 27F45C1B");
-    n2 = bn_from_hex("EBA11829 27F45C1B");
-    got_result = bn_mod(n1, n2);
-    should_result = bn_zero();
-    TEST_ASSERT_EQ("", got_result, should_result);
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_multiply_into() {
+    BigNum *n1, *n2, *dst, *should_result;
+
+    n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
+    n2 = bn_from_hex("CEAFFABC FAEDEADB AEBFABEF BAEBFEBA");
+    should_result = bn_from_hex("A8EAE322 3BB9511C 9F5C249D 77A3CA8A A2A74A6F CD52AD21 1A7F75F2 69A0F054");
+    dst = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF");
+    TEST_ASSERT("returns dst", bn_multiply_into(dst, n1, n2) == dst);
+    TEST_ASSERT_EQ("overwrites longer dst", dst, should_result);
+    bn_multiply_into(dst, n1, bn_zero());
+    TEST_ASSERT_EQ("", dst, bn_zero());
+    bn_multiply_assign(n1, n2);
+    TEST_ASSERT_EQ("assign", n1, should_result);
 
     n1 = bn_from_hex("EBA11829 27F45C1B");
-    n2 = bn_from_hex("     ACE 12791232");
-    got_result = bn_mod(n1, n2);
-    should_result = bn_from_hex("80E 08AA1E5D");
-    TEST_ASSERT_EQ("", got_result, should_result);
+    bn_multiply_assign(n1, n1);
+    should_result = bn_from_hex("D8E127BA F566A091 0FBCEDF5 EE9B6AD9");
+    TEST_ASSERT_EQ("dst aliases both operands", n1, should_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_divide_into() {
+    BigNum *n1, *n2, *dst, *should_result;
 
     n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
     n2 = bn_from_hex("                  EBA11829 27F45C1B");
-    got_result = bn_mod(n1, n2);
-    should_result = bn_from_hex("C477521F C4E2EBD2");
-    TEST_ASSERT_EQ("", got_result, should_result);
-
-    n1 = bn_from_hex("AA213F 32785D1F E1190ABB");
-    n2 = bn_from_hex("       129E781A C1829FB1");
-    got_result = bn_mod(n1, n2);
-    should_result = bn_from_hex("03F3ED12 94BB8AED");
-    TEST_ASSERT_EQ("", got_result, should_result);
+    should_result = bn_from_hex("E34E65BE ED03AB20");
+    dst = bn_zero();
+    TEST_ASSERT("returns dst", bn_divide_into(dst, n1, n2) == dst);
+    TEST_ASSERT_EQ("", dst, should_result);
+    bn_divide_assign(n1, n2);
+    TEST_ASSERT_EQ("assign", n1, should_result);
 
     n1 = bn_from_hex("C5367281 19283712");
-    n2 = bn_zero();
-    got_result = bn_mod(n1, n2);
-    TEST_ASSERT("modulo by zero results in null pointer", !got_result);
+    TEST_ASSERT("dividing by zero results in null pointer", !bn_divide_assign(n1, bn_zero()));
+    TEST_ASSERT_EQ("dst is untouched on failure", n1, bn_from_hex("C5367281 19283712"));
 
     TEST_SUCCESS();
 }
 
-static TestResult test_bn_power_mod() {
-    BigNum *base, *exp, *mod, *got_result, *should_result;
+static TestResult test_bn_mod_into() {
+    BigNum *n1, *n2, *dst, *should_result;
 
-    base = bn_zero();
-    exp = bn_from_hex("10001");
-    mod = bn_from_hex("ABCDABCD");
+    n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
+    n2 = bn_from_hex("                  EBA11829 27F45C1B");
+    should_result = bn_from_hex("C477521F C4E2EBD2");
+    dst = bn_zero();
+    TEST_ASSERT("returns dst", bn_mod_into(dst, n1, n2) == dst);
+    TEST_ASSERT_EQ("", dst, should_result);
+    bn_mod_into(n2, n1, n2);
+    TEST_ASSERT_EQ("dst aliases second operand", n2, should_result);
+    n2 = bn_from_hex("EBA11829 27F45C1B");
+    bn_mod_assign(n1, n2);
+    TEST_ASSERT_EQ("assign", n1, should_result);
+
+    n1 = bn_from_hex("C5367281 19283712");
+    TEST_ASSERT("modulo by zero results in null pointer", !bn_mod_assign(n1, bn_zero()));
+    TEST_ASSERT_EQ("dst is untouched on failure", n1, bn_from_hex("C5367281 19283712"));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_addmul() {
+    BigNum *acc, *a, *b, *should_result;
+
+    acc = bn_from_hex("D1380128 25378933 47238921 10457832");
+    a = bn_from_hex("EBA11829 27F45C1B");
+    b = bn_from_hex("AA213F 32785D1F E1190ABB");
+    TEST_ASSERT("returns acc", bn_addmul(acc, a, b) == acc);
+    should_result = bn_from_hex("9C9794 CBC309A6 DEB8A6B8 47996CD6 8500CDEB");
+    TEST_ASSERT_EQ("", acc, should_result);
+
+    acc = bn_from_hex("D1380128 25378933 47238921 10457832");
+    bn_addmul(acc, b, a);
+    TEST_ASSERT_EQ("commutative", acc, should_result);
+
+    acc = bn_from_hex("D1380128 25378933 47238921 10457832");
+    bn_addmul(acc, a, bn_zero());
+    TEST_ASSERT_EQ("adding 0", acc, bn_from_hex("D1380128 25378933 47238921 10457832"));
+
+    acc = bn_from_hex("D1380128 25378933 47238921 10457832");
+    bn_addmul(acc, acc, acc);
+    should_result = bn_from_hex("AAFC7E24 0E564CE7 D66D85BD 8D566C6E 9B59C8F6 348C5479 6E66CBE5 53A861F6");
+    TEST_ASSERT_EQ("acc may alias both operands", acc, should_result);
+
+    // Long operands, which are multiplied with Karatsuba instead of row by row
+    bn_set_mul_thresholds(8, 240, 4096);
+    BigNum *n1 = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF");
+    acc = bn_one();
+    bn_addmul(acc, n1, n1);
+    should_result = bn_multiply(n1, n1);
+    bn_add_assign(should_result, bn_one());
+    bn_set_mul_thresholds(32, 240, 4096);
+    TEST_ASSERT_EQ("long operands", acc, should_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_submul() {
+    BigNum *acc, *a, *b, *should_result;
+
+    acc = bn_from_hex("D1380128 25378933 47238921 10457832");
+    a = bn_from_hex("CBA11829 27F45C1B");
+    TEST_ASSERT("returns acc", bn_submul(acc, a, a) == acc);
+    should_result = bn_from_hex("2F3F1F77 79CDFFA8 F7669B2B 21AA0D59");
+    TEST_ASSERT_EQ("", acc, should_result);
+
+    a = bn_from_hex("EBA11829 27F45C1B");
+    b = bn_from_hex("AA213F 32785D1F E1190ABB");
+    acc = bn_multiply(a, b);
+    bn_submul(acc, b, a);
+    TEST_ASSERT_EQ("difference of 0", acc, bn_zero());
+    TEST_ASSERT("difference of 0 is trimmed", acc->len == 1);
+
+    acc = bn_from_hex("D1380128 25378933 47238921 10457832");
+    TEST_ASSERT("negative result results in null pointer", !bn_submul(acc, a, a));
+    TEST_ASSERT_EQ("acc is untouched", acc, bn_from_hex("D1380128 25378933 47238921 10457832"));
+    TEST_ASSERT("longer negative result results in null pointer", !bn_submul(acc, a, b));
+    TEST_ASSERT_EQ("acc is untouched", acc, bn_from_hex("D1380128 25378933 47238921 10457832"));
+
+    acc = bn_from_hex("D1380128 25378933 47238921 10457832");
+    TEST_ASSERT("acc may alias an operand", !bn_submul(acc, acc, acc));
+    TEST_ASSERT_EQ("acc is untouched", acc, bn_from_hex("D1380128 25378933 47238921 10457832"));
+    acc = bn_from_hex("5A");
+    bn_submul(acc, acc, bn_one());
+    TEST_ASSERT_EQ("acc may alias an operand", acc, bn_zero());
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_addmul_u32() {
+    BigNum *acc, *a, *should_result;
+
+    acc = bn_from_hex("D1380128 25378933 47238921 10457832");
+    a = bn_from_hex("EBA11829 27F45C1B");
+    TEST_ASSERT("returns acc", bn_addmul_u32(acc, a, 0xFFFFFFFF) == acc);
+    should_result = bn_from_hex("D1380129 10D8A15B 8376CD12 E8511C17");
+    TEST_ASSERT_EQ("", acc, should_result);
+
+    acc = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF");
+    bn_addmul_u32(acc, bn_one(), 1);
+    TEST_ASSERT_EQ("carry through acc", acc, bn_from_hex("1 00000000 00000000 00000000"));
+
+    acc = bn_from_hex("D1380128 25378933 47238921 10457832");
+    bn_addmul_u32(acc, acc, 0xFFFFFFFF);
+    should_result = bn_from_hex("D1380128 25378933 47238921 10457832 00000000");
+    TEST_ASSERT_EQ("acc may alias a", acc, should_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_accumulator_new() {
+    bn_Accumulator *acc = bn_accumulator_new();
+    TEST_ASSERT("", acc);
+    TEST_ASSERT_EQ("starts at 0", bn_accumulator_value(acc), bn_zero());
+
+    bn_accumulator_add(acc, bn_from_hex("FFFFFFFF FFFFFFFF"));
+    bn_accumulator_reset(acc);
+    TEST_ASSERT_EQ("reset sets the value to 0", bn_accumulator_value(acc), bn_zero());
+
+    bn_accumulator_destroy(&acc);
+    TEST_ASSERT("destroy sets pointer to null", !acc);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_accumulator_add() {
+    bn_Accumulator *acc = bn_accumulator_new();
+    BigNum *a = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF");
+    BigNum *b = bn_from_hex("D1380128 25378933 47238921 10457832");
+    BigNum *should_result = bn_zero();
+
+    for (int i = 0; i < 1000; i++) {
+        bn_accumulator_add(acc, i % 2 ? a : b);
+        bn_add_into(should_result, should_result, i % 2 ? a : b);
+    }
+    TEST_ASSERT_EQ("", bn_accumulator_value(acc), should_result);
+
+    bn_accumulator_add(acc, bn_one());
+    bn_add_into(should_result, should_result, bn_one());
+    TEST_ASSERT_EQ("add after reading the value", bn_accumulator_value(acc), should_result);
+
+    // Start right below the headroom, so that the slots are normalized in
+    // between
+    bn_accumulator_reset(acc);
+    acc->additions = BN_ACCUMULATOR_MAX_ADDITIONS - 2;
+    for (int i = 0; i < 5; i++) {
+        bn_accumulator_add(acc, a);
+    }
+    TEST_ASSERT_EQ("normalizes when the headroom runs out", bn_accumulator_value(acc), bn_multiply(a, bn_from_uint32_t(5)));
+
+    bn_accumulator_destroy(&acc);
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_accumulator_addmul_u32() {
+    bn_Accumulator *acc = bn_accumulator_new();
+    BigNum *a = bn_from_hex("EBA11829 27F45C1B");
+
+    bn_accumulator_add(acc, bn_from_hex("D1380128 25378933 47238921 10457832"));
+    bn_accumulator_addmul_u32(acc, a, 0xFFFFFFFF);
+    TEST_ASSERT_EQ("", bn_accumulator_value(acc), bn_from_hex("D1380129 10D8A15B 8376CD12 E8511C17"));
+
+    bn_accumulator_reset(acc);
+    BigNum *should_result = bn_zero();
+    for (uint32_t i = 0; i < 1000; i++) {
+        bn_accumulator_addmul_u32(acc, a, 0xFFFFFFFF - i);
+        bn_addmul_u32(should_result, a, 0xFFFFFFFF - i);
+    }
+    TEST_ASSERT_EQ("many products", bn_accumulator_value(acc), should_result);
+
+    bn_accumulator_destroy(&acc);
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_accumulator_addmul() {
+    bn_Accumulator *acc = bn_accumulator_new();
+    BigNum *a = bn_from_hex("D1380128 25378933 47238921 10457832");
+    BigNum *b = bn_from_hex("FFFFFFFF 00000000 EBA11829 27F45C1B");
+    BigNum *should_result = bn_zero();
+
+    for (int i = 0; i < 100; i++) {
+        bn_accumulator_addmul(acc, a, b);
+        bn_accumulator_addmul(acc, b, a);
+        bn_addmul(should_result, a, b);
+        bn_addmul(should_result, b, a);
+    }
+    TEST_ASSERT_EQ("", bn_accumulator_value(acc), should_result);
+
+    bn_accumulator_addmul(acc, a, bn_zero());
+    TEST_ASSERT_EQ("product with 0", bn_accumulator_value(acc), should_result);
+
+    bn_accumulator_destroy(&acc);
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_accumulator_value_into() {
+    bn_Accumulator *acc = bn_accumulator_new();
+    BigNum *dst = bn_from_hex("12345678 9ABCDEF0 12345678 9ABCDEF0 12345678");
+
+    bn_accumulator_add(acc, bn_from_uint32_t(7));
+    TEST_ASSERT("returns dst", bn_accumulator_value_into(dst, acc) == dst);
+    TEST_ASSERT_EQ("shrinks dst", dst, bn_from_uint32_t(7));
+
+    bn_accumulator_add(acc, bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFF9"));
+    bn_accumulator_value_into(dst, acc);
+    TEST_ASSERT_EQ("carry out of the top", dst, bn_from_hex("1 00000000 00000000 00000000 00000000 00000000"));
+
+    bn_accumulator_destroy(&acc);
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_set_mul_thresholds() {
+    BigNum *n1, *n2, *should_result, *got_result;
+
+    // Fill the operands with a deterministic pattern and compare all
+    // algorithms against the schoolbook method. 200 and 173 blocks make
+    // Karatsuba and Toom-3 recurse with uneven splits.
+    n1 = bn_with_len(200);
+    n2 = bn_with_len(173);
+    for (size_t i = 0; i < n1->len; i++) {
+        bn_write_block(n1, i, i * 2654435761u + 0x9e3779b9);
+    }
+    for (size_t i = 0; i < n2->len; i++) {
+        bn_write_block(n2, i, BN_BLOCK_MAX - i * 40503u);
+    }
+
+    bn_set_mul_thresholds(1000, 1000, 1000);
+    should_result = bn_multiply(n1, n2);
+
+    bn_set_mul_thresholds(8, 1000, 1000);
+    got_result = bn_multiply(n1, n2);
+    TEST_ASSERT_EQ("karatsuba", got_result, should_result);
+
+    bn_set_mul_thresholds(8, 8, 1000);
+    got_result = bn_multiply(n1, n2);
+    TEST_ASSERT_EQ("toom-3", got_result, should_result);
+    got_result = bn_multiply(n2, n1);
+    TEST_ASSERT_EQ("toom-3", got_result, should_result);
+
+    bn_set_mul_thresholds(8, 8, 8);
+    got_result = bn_multiply(n1, n2);
+    TEST_ASSERT_EQ("ntt", got_result, should_result);
+
+    bn_resize(n2, 20);
+    bn_set_mul_thresholds(1000, 1000, 1000);
+    should_result = bn_multiply(n1, n2);
+    bn_set_mul_thresholds(8, 8, 1000);
+    got_result = bn_multiply(n1, n2);
+    TEST_ASSERT_EQ("unbalanced operands", got_result, should_result);
+    bn_set_mul_thresholds(8, 8, 8);
+    got_result = bn_multiply(n1, n2);
+    TEST_ASSERT_EQ("unbalanced operands with ntt", got_result, should_result);
+
+    bn_set_mul_thresholds(8, 8, 1000);
+    n1 = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF");
+    got_result = bn_multiply(n1, n1);
+    should_result = bn_from_hex(
+        "FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFE"
+        "00000000 00000000 00000000 00000000 00000000 00000000 00000000 00000000 00000000 00000001"
+    );
+    TEST_ASSERT_EQ("carries through all parts", got_result, should_result);
+    bn_set_mul_thresholds(8, 8, 8);
+    got_result = bn_multiply(n1, n1);
+    TEST_ASSERT_EQ("carries through all ntt coefficients", got_result, should_result);
+
+    bn_set_mul_thresholds(32, 240, 4096);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_set_threads() {
+    BigNum *n1, *n2, *should_result, *got_result;
+
+    // Large enough for Toom-3 and Karatsuba to be split into tasks on
+    // several levels with the lowest parallel threshold
+    n1 = bn_with_len(1500);
+    n2 = bn_with_len(1100);
+    for (size_t i = 0; i < n1->len; i++) {
+        bn_write_block(n1, i, i * 2654435761u + 0x9e3779b9);
+    }
+    for (size_t i = 0; i < n2->len; i++) {
+        bn_write_block(n2, i, BN_BLOCK_MAX - i * 40503u);
+    }
+    should_result = bn_multiply(n1, n2);
+    BigNum *should_square = bn_square(n1);
+
+    BigNum *bases[20], *exps[20], *should_powers[20], *got_powers[20];
+    BigNum *mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB");
+    for (size_t i = 0; i < 20; i++) {
+        bases[i] = bn_from_uint32_t(1000 + (uint32_t)i);
+        exps[i] = bn_from_uint32_t(65537 * (uint32_t)i);
+        should_powers[i] = bn_power_mod(bases[i], exps[i], mod);
+        got_powers[i] = bn_zero();
+    }
+
+    TEST_ASSERT("1 thread", bn_set_threads(1) == 1);
+    TEST_ASSERT("4 threads", bn_set_threads(4) == 4);
+    bn_set_parallel_threshold(0);
+
+    got_result = bn_multiply(n1, n2);
+    TEST_ASSERT_EQ("karatsuba and toom-3 with tasks", got_result, should_result);
+    got_result = bn_square(n1);
+    TEST_ASSERT_EQ("square with tasks", got_result, should_square);
+
+    bn_set_mul_thresholds(8, 1000, 1000);
+    got_result = bn_multiply(n1, n2);
+    TEST_ASSERT_EQ("karatsuba with tasks", got_result, should_result);
+    bn_set_mul_thresholds(32, 240, 4096);
+
+    BigNum *products[3] = { bn_zero(), n1, bn_zero() };
+    BigNum *factors1[3] = { n1, n1, n2 };
+    BigNum *factors2[3] = { n2, n2, bn_one() };
+    bn_multiply_batch(factors1, factors2, products, 3);
+    TEST_ASSERT_EQ("batch multiplication", products[0], should_result);
+    TEST_ASSERT_EQ("batch multiplication", products[1], should_result);
+    TEST_ASSERT_EQ("batch multiplication", products[2], n2);
+
+    bn_power_mod_batch(bases, exps, mod, got_powers, 20);
+    for (size_t i = 0; i < 20; i++) {
+        TEST_ASSERT_EQ("batch exponentiation", got_powers[i], should_powers[i]);
+    }
+
+    bn_set_parallel_threshold(2048);
+    TEST_ASSERT("back to 1 thread", bn_set_threads(1) == 1);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_divide_with_remainder() {
+    BigNum *n1, *n2, *should_quotient, *should_remainder;
+    bn_DivideWithRemainderResult *got_result;
+
+    n1 = bn_from_hex("EBA11829 27F45C1B");
+    n2 = bn_one();
+    got_result = bn_divide_with_remainder(n1, n2);
+    should_quotient = n1;
+    should_remainder = bn_zero();
+    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
+    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+
+    n1 = bn_from_hex("EBA11829 27F45C1B");
+    n2 = bn_from_hex("EBA11829 27F45C1B");
+    got_result = bn_divide_with_remainder(n1, n2);
+    should_quotient = bn_one();
+    should_remainder = bn_zero();
+    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
+    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+
+    n1 = bn_from_hex("EBA11829 27F45C1B");
+    n2 = bn_from_hex("     ACE 12791232");
+    got_result = bn_divide_with_remainder(n1, n2);
+    should_quotient = bn_from_hex("15CEB7");
+    should_remainder = bn_from_hex("80E 08AA1E5D");
+    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
+    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+
+    n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
+    n2 = bn_from_hex("                  EBA11829 27F45C1B");
+    got_result = bn_divide_with_remainder(n1, n2);
+    should_quotient = bn_from_hex("E34E65BE ED03AB20");
+    should_remainder = bn_from_hex("C477521F C4E2EBD2");
+    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
+    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+
+    n1 = bn_from_hex("AA213F 32785D1F E1190ABB");
+    n2 = bn_from_hex("       129E781A C1829FB1");
+    got_result = bn_divide_with_remainder(n1, n2);
+    should_quotient = bn_from_hex("09232E2E");
+    should_remainder = bn_from_hex("03F3ED12 94BB8AED");
+    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
+    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+
+    n1 = bn_from_hex("00AA213F 32785D1F E1190ABB");
+    n2 = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBA");
+    got_result = bn_divide_with_remainder(n1, n2);
+    should_quotient = bn_zero();
+    should_remainder = n1;
+    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
+    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+
+    n1 = bn_from_hex("C5367281 19283712");
+    n2 = bn_from_hex("EBA11829 27F45C1B");
+    got_result = bn_divide_with_remainder(n1, n2);
+    should_quotient = bn_zero();
+    should_remainder = n1;
+    TEST_ASSERT_EQ("", got_result->quotient, should_quotient);
+    TEST_ASSERT_EQ("", got_result->remainder, should_remainder);
+
+#if BN_BLOCK_BITS == 64
+    n1 = bn_from_hex("7FFFFFFFFFFFFFFF 8000000000000000 0000000000000000 0000000000000000");
+    n2 = bn_from_hex("                 8000000000000000 0000000000000000 0000000000000001");
+    got_result = bn_divide_with_remainder(n1, n2);
+    should_quotient = bn_from_hex("FFFFFFFFFFFFFFFE");
+    should_remainder = bn_from_hex("7FFFFFFFFFFFFFFF FFFFFFFFFFFFFFFF 0000000000000002");
+#else
+    n1 = bn_from_hex("7FFFFFFF 80000000 00000000 00000000");
+    n2 = bn_from_hex("         80000000 00000000 00000001");
+    got_result = bn_divide_with_remainder(n1, n2);
+    should_quotient = bn_from_hex("FFFFFFFE");
+    should_remainder = bn_from_hex("7FFFFFFF FFFFFFFF 00000002");
+#endif
+    TEST_ASSERT_EQ("quotient estimate needs add back", got_result->quotient, should_quotient);
+    TEST_ASSERT_EQ("quotient estimate needs add back", got_result->remainder, should_remainder);
+
+    n1 = bn_from_hex("C5367281 19283712");
+    n2 = bn_zero();
+    got_result = bn_divide_with_remainder(n1, n2);
+    TEST_ASSERT("dividing by zero results in null pointer", !got_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_set_div_threshold() {
+    BigNum *n1, *n2;
+    bn_DivideWithRemainderResult *should_result, *got_result;
+
+    // Compare the recursive division against Knuth's long division. 300 and
+    // 111 blocks give two whole quotient pieces and an uneven rest.
+    n1 = bn_with_len(300);
+    n2 = bn_with_len(111);
+    for (size_t i = 0; i < n1->len; i++) {
+        bn_write_block(n1, i, i * 2654435761u + 0x9e3779b9);
+    }
+    for (size_t i = 0; i < n2->len; i++) {
+        bn_write_block(n2, i, BN_BLOCK_MAX - i * 40503u);
+    }
+
+    bn_set_div_threshold(1000);
+    should_result = bn_divide_with_remainder(n1, n2);
+    bn_set_div_threshold(4);
+    got_result = bn_divide_with_remainder(n1, n2);
+    TEST_ASSERT_EQ("quotient", got_result->quotient, should_result->quotient);
+    TEST_ASSERT_EQ("remainder", got_result->remainder, should_result->remainder);
+    TEST_ASSERT_EQ("bn_mod", bn_mod(n1, n2), should_result->remainder);
+
+    // A dividend just below a multiple of the divisor makes the estimated
+    // quotients too large, so all corrections run
+    BigNum *n3 = bn_multiply(n2, n2);
+    bn_subtract_assign(n3, bn_one());
+    bn_set_div_threshold(1000);
+    should_result = bn_divide_with_remainder(n3, n2);
+    bn_set_div_threshold(4);
+    got_result = bn_divide_with_remainder(n3, n2);
+    TEST_ASSERT_EQ("quotient with corrections", got_result->quotient, should_result->quotient);
+    TEST_ASSERT_EQ("remainder with corrections", got_result->remainder, should_result->remainder);
+
+    n3 = bn_from_hex(
+        "FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF"
+        "FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF"
+    );
+    BigNum *n4 = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF");
+    got_result = bn_divide_with_remainder(n3, n4);
+    TEST_ASSERT_EQ("all bits set", got_result->quotient, bn_add(n4, bn_from_uint32_t(2)));
+    TEST_ASSERT_EQ("all bits set", got_result->remainder, bn_zero());
+
+    bn_set_div_threshold(64);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_divide() {
+    BigNum *n1, *n2, *should_result, *got_result;
+
+    n1 = bn_from_hex("EBA11829 27F45C1B");
+    n2 = bn_one();
+    got_result = bn_divide(n1, n2);
+    should_result = n1;
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    n1 = bn_from_hex("EBA11829 27F45C1B");
+    n2 = bn_from_hex("EBA11829 27F45C1B");
+    got_result = bn_divide(n1, n2);
+    should_result = bn_one();
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    n1 = bn_from_hex("EBA11829 27F45C1B");
+    n2 = bn_from_hex("     ACE 12791232");
+    got_result = bn_divide(n1, n2);
+    should_result = bn_from_hex("15CEB7");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
+    n2 = bn_from_hex("                  EBA11829 27F45C1B");
+    got_result = bn_divide(n1, n2);
+    should_result = bn_from_hex("E34E65BE ED03AB20");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    n1 = bn_from_hex("AA213F 32785D1F E1190ABB");
+    n2 = bn_from_hex("       129E781A C1829FB1");
+    got_result = bn_divide(n1, n2);
+    should_result = bn_from_hex("09232E2E");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    n1 = bn_from_hex("C5367281 19283712");
+    n2 = bn_zero();
+    got_result = bn_divide(n1, n2);
+    TEST_ASSERT("dividing by zero results in null pointer", !got_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_mod() {
+    BigNum *n1, *n2, *got_result, *should_result;
+
+    n1 = bn_from_hex("EBA11829 27F45C1B");
+    n2 = bn_one();
+    got_result = bn_mod(n1, n2);
+    should_result = bn_zero();
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    n1 = bn_from_hex("EBA11829 27F45C1B");
+    n2 = bn_from_hex("EBA11829 27F45C1B");
+    got_result = bn_mod(n1, n2);
+    should_result = bn_zero();
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    n1 = bn_from_hex("EBA11829 27F45C1B");
+    n2 = bn_from_hex("     ACE 12791232");
+    got_result = bn_mod(n1, n2);
+    should_result = bn_from_hex("80E 08AA1E5D");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
+    n2 = bn_from_hex("                  EBA11829 27F45C1B");
+    got_result = bn_mod(n1, n2);
+    should_result = bn_from_hex("C477521F C4E2EBD2");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    n1 = bn_from_hex("AA213F 32785D1F E1190ABB");
+    n2 = bn_from_hex("       129E781A C1829FB1");
+    got_result = bn_mod(n1, n2);
+    should_result = bn_from_hex("03F3ED12 94BB8AED");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    n1 = bn_from_hex("C5367281 19283712");
+    n2 = bn_zero();
+    got_result = bn_mod(n1, n2);
+    TEST_ASSERT("modulo by zero results in null pointer", !got_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_add_u32() {
+    BigNum *n, *got_result, *should_result;
+
+    n = bn_from_hex("D1380128 25378933 47238921 10457832");
+    got_result = bn_add_u32(n, 0xFFFFFFFF);
+    should_result = bn_from_hex("D1380128 25378933 47238922 10457831");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    n = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF");
+    got_result = bn_add_u32(n, 1);
+    should_result = bn_from_hex("1 00000000 00000000 00000000 00000000");
+    TEST_ASSERT_EQ("carry into new block", got_result, should_result);
+
+    n = bn_zero();
+    got_result = bn_add_u32(n, 0);
+    TEST_ASSERT_EQ("0 + 0", got_result, bn_zero());
+
+    n = bn_from_hex("FFFFFFFF FFFFFFFF");
+    TEST_ASSERT("into returns dst", bn_add_u32_into(n, n, 7) == n);
+    should_result = bn_from_hex("1 00000000 00000006");
+    TEST_ASSERT_EQ("dst may alias n", n, should_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_sub_u32() {
+    BigNum *n, *got_result, *should_result;
+
+    n = bn_from_hex("D1380128 25378933 47238921 10457832");
+    got_result = bn_sub_u32(n, 0xFFFFFFFF);
+    should_result = bn_from_hex("D1380128 25378933 47238920 10457833");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    n = bn_from_hex("1 00000000 00000000 00000000 00000000");
+    got_result = bn_sub_u32(n, 1);
+    should_result = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF");
+    TEST_ASSERT_EQ("borrow through all blocks", got_result, should_result);
+
+    n = bn_from_uint32_t(0x1234);
+    got_result = bn_sub_u32(n, 0x1234);
+    TEST_ASSERT_EQ("n - n", got_result, bn_zero());
+
+    n = bn_from_uint32_t(0x1234);
+    TEST_ASSERT("negative result results in null pointer", !bn_sub_u32(n, 0x1235));
+    TEST_ASSERT("into with negative result results in null pointer", !bn_sub_u32_into(n, n, 0x1235));
+    TEST_ASSERT_EQ("dst is untouched", n, bn_from_uint32_t(0x1234));
+
+    n = bn_from_hex("1 00000000 00000006");
+    TEST_ASSERT("into returns dst", bn_sub_u32_into(n, n, 7) == n);
+    should_result = bn_from_hex("FFFFFFFF FFFFFFFF");
+    TEST_ASSERT_EQ("dst may alias n", n, should_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_mul_u32() {
+    BigNum *n, *got_result, *should_result;
+
+    n = bn_from_hex("D1380128 25378933 47238921 10457832");
+    got_result = bn_mul_u32(n, 0xFFFFFFFF);
+    should_result = bn_from_hex("D1380127 53FF880B 21EBFFED C921EF10 EFBA87CE");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    got_result = bn_mul_u32(n, 0);
+    TEST_ASSERT_EQ("multiplication by 0", got_result, bn_zero());
+
+    got_result = bn_mul_u32(n, 1);
+    TEST_ASSERT_EQ("multiplication by 1", got_result, n);
+
+    n = bn_from_hex("D1380128 25378933 47238921 10457832");
+    TEST_ASSERT("into returns dst", bn_mul_u32_into(n, n, 0xFFFFFFFF) == n);
+    TEST_ASSERT_EQ("dst may alias n", n, should_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_divmod_u32() {
+    BigNum *n, *got_result, *should_result;
+    uint32_t remainder;
+
+    n = bn_from_hex("D1380128 25378933 47238921 10457832");
+    got_result = bn_divmod_u32(n, 0xFFFFFFFB, &remainder);
+    should_result = bn_from_hex("D138012C 3B4F8F10 6FB15473");
+    TEST_ASSERT_EQ("", got_result, should_result);
+    TEST_ASSERT("remainder", remainder == 0x3EBC1E71);
+
+    got_result = bn_divmod_u32(n, 10, &remainder);
+    should_result = bn_from_hex("14EC001D 9D525A85 20B6C0E9 B4D3BF38");
+    TEST_ASSERT_EQ("", got_result, should_result);
+    TEST_ASSERT("remainder", remainder == 2);
+
+    got_result = bn_divmod_u32(n, 1, NULL);
+    TEST_ASSERT_EQ("remainder may be null", got_result, n);
+
+    got_result = bn_divmod_u32(bn_from_uint32_t(9), 10, &remainder);
+    TEST_ASSERT_EQ("divisor greater than n", got_result, bn_zero());
+    TEST_ASSERT("remainder", remainder == 9);
+
+    TEST_ASSERT("division by zero results in null pointer", !bn_divmod_u32(n, 0, &remainder));
+    TEST_ASSERT("into with division by zero results in null pointer", !bn_divmod_u32_into(n, n, 0, NULL));
+
+    // Compares against the generic division
+    BigNum *m = bn_from_hex("FFFFFFFF FFFFFFFE 80000000 00000001 7FFFFFFF 12345678");
+    uint32_t divisors[] = {2, 3, 0x7FFFFFFF, 0x80000000, 0x80000001, 0xFFFFFFFF};
+    for (size_t i = 0; i < sizeof(divisors) / sizeof(divisors[0]); i++) {
+        bn_DivideWithRemainderResult *expected = bn_divide_with_remainder(m, bn_from_uint32_t(divisors[i]));
+        got_result = bn_divmod_u32(m, divisors[i], &remainder);
+        TEST_ASSERT_EQ("quotient matches bn_divide_with_remainder", got_result, expected->quotient);
+        TEST_ASSERT_EQ("remainder matches bn_divide_with_remainder", bn_from_uint32_t(remainder), expected->remainder);
+    }
+
+    n = bn_from_hex("D1380128 25378933 47238921 10457832");
+    TEST_ASSERT("into returns dst", bn_divmod_u32_into(n, n, 10, &remainder) == n);
+    should_result = bn_from_hex("14EC001D 9D525A85 20B6C0E9 B4D3BF38");
+    TEST_ASSERT_EQ("dst may alias n", n, should_result);
+    TEST_ASSERT("remainder", remainder == 2);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_mod_u32() {
+    BigNum *n = bn_from_hex("D1380128 25378933 47238921 10457832");
+    TEST_ASSERT("", bn_mod_u32(n, 0xFFFFFFFB) == 0x3EBC1E71);
+    TEST_ASSERT("", bn_mod_u32(n, 10) == 2);
+    TEST_ASSERT("modulo by 1", bn_mod_u32(n, 1) == 0);
+    TEST_ASSERT("modulo by 0 results in 0", bn_mod_u32(n, 0) == 0);
+    TEST_ASSERT("n less than d", bn_mod_u32(bn_from_uint32_t(9), 10) == 9);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_shift_left() {
+    BigNum *n, *got_result, *should_result;
+
+    n = bn_from_hex("D1380128 25378933 47238921 10457832");
+    got_result = bn_shift_left(n, 1);
+    should_result = bn_from_hex("1 A2700250 4A6F1266 8E471242 208AF064");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    got_result = bn_shift_left(n, 32);
+    should_result = bn_from_hex("D1380128 25378933 47238921 10457832 00000000");
+    TEST_ASSERT_EQ("whole block", got_result, should_result);
+
+    got_result = bn_shift_left(n, 100);
+    should_result = bn_from_hex("D 13801282 53789334 72389211 04578320 00000000 00000000 00000000");
+    TEST_ASSERT_EQ("blocks and bits", got_result, should_result);
+
+    got_result = bn_shift_left(n, 0);
+    TEST_ASSERT_EQ("shift by 0", got_result, n);
+
+    got_result = bn_shift_left(bn_zero(), 1000);
+    TEST_ASSERT_EQ("0 stays 0", got_result, bn_zero());
+    TEST_ASSERT("0 stays one block", got_result->len == 1);
+
+    TEST_ASSERT("assign returns acc", bn_shift_left_assign(n, 36) == n);
+    should_result = bn_from_hex("D 13801282 53789334 72389211 04578320 00000000");
+    TEST_ASSERT_EQ("dst may alias n", n, should_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_shift_right() {
+    BigNum *n, *got_result, *should_result;
+
+    n = bn_from_hex("D1380128 25378933 47238921 10457832");
+    got_result = bn_shift_right(n, 1);
+    should_result = bn_from_hex("689C0094 129BC499 A391C490 8822BC19");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    got_result = bn_shift_right(n, 32);
+    should_result = bn_from_hex("D1380128 25378933 47238921");
+    TEST_ASSERT_EQ("whole block", got_result, should_result);
+
+    got_result = bn_shift_right(n, 100);
+    should_result = bn_from_hex("0D138012");
+    TEST_ASSERT_EQ("blocks and bits", got_result, should_result);
+
+    got_result = bn_shift_right(n, 0);
+    TEST_ASSERT_EQ("shift by 0", got_result, n);
+
+    got_result = bn_shift_right(n, 128);
+    TEST_ASSERT_EQ("all bits shifted out", got_result, bn_zero());
+
+    got_result = bn_shift_right(n, (size_t)-1);
+    TEST_ASSERT_EQ("shift beyond the length", got_result, bn_zero());
+
+    TEST_ASSERT("assign returns acc", bn_shift_right_assign(n, 36) == n);
+    should_result = bn_from_hex("0D138012 82537893 34723892");
+    TEST_ASSERT_EQ("dst may alias n", n, should_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_and() {
+    BigNum *n1, *n2, *got_result, *should_result;
+
+    n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
+    n2 = bn_from_hex("                  EBA11829 27F45C1B");
+    should_result = bn_from_hex("43210821 00445812");
+    got_result = bn_and(n1, n2);
+    TEST_ASSERT_EQ("", got_result, should_result);
+    got_result = bn_and(n2, n1);
+    TEST_ASSERT_EQ("commutative", got_result, should_result);
+
+    got_result = bn_and(n1, bn_from_hex("FFFFFFFF 00000000 00000000 00000000"));
+    should_result = bn_from_hex("D1380128 00000000 00000000 00000000");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    got_result = bn_and(bn_from_hex("1 00000000"), bn_from_hex("F 00000000 FFFFFFFF"));
+    TEST_ASSERT_EQ("result is trimmed", got_result, bn_zero());
+    TEST_ASSERT("result is trimmed", got_result->len == 1);
+
+    TEST_ASSERT("assign returns acc", bn_and_assign(n1, n2) == n1);
+    TEST_ASSERT_EQ("dst may alias n1", n1, bn_from_hex("43210821 00445812"));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_or() {
+    BigNum *n1, *n2, *got_result, *should_result;
+
+    n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
+    n2 = bn_from_hex("                  EBA11829 27F45C1B");
+    should_result = bn_from_hex("D1380128 25378933 EFA39929 37F57C3B");
+    got_result = bn_or(n1, n2);
+    TEST_ASSERT_EQ("", got_result, should_result);
+    got_result = bn_or(n2, n1);
+    TEST_ASSERT_EQ("commutative", got_result, should_result);
+
+    got_result = bn_or(n1, bn_zero());
+    TEST_ASSERT_EQ("or with 0", got_result, n1);
+
+    TEST_ASSERT("into returns dst", bn_or_into(n2, n1, n2) == n2);
+    TEST_ASSERT_EQ("dst may alias the shorter operand", n2, should_result);
+
+    n2 = bn_from_hex("EBA11829 27F45C1B");
+    TEST_ASSERT("assign returns acc", bn_or_assign(n1, n2) == n1);
+    TEST_ASSERT_EQ("dst may alias the longer operand", n1, should_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_xor() {
+    BigNum *n1, *n2, *got_result, *should_result;
+
+    n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
+    n2 = bn_from_hex("                  EBA11829 27F45C1B");
+    should_result = bn_from_hex("D1380128 25378933 AC829108 37B12429");
+    got_result = bn_xor(n1, n2);
+    TEST_ASSERT_EQ("", got_result, should_result);
+    got_result = bn_xor(n2, n1);
+    TEST_ASSERT_EQ("commutative", got_result, should_result);
+
+    got_result = bn_xor(n1, n1);
+    TEST_ASSERT_EQ("n ^ n", got_result, bn_zero());
+    TEST_ASSERT("result is trimmed", got_result->len == 1);
+
+    TEST_ASSERT("assign returns acc", bn_xor_assign(n1, n1) == n1);
+    TEST_ASSERT_EQ("dst may alias both operands", n1, bn_zero());
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_bit_length() {
+    TEST_ASSERT("0 has no bits", bn_bit_length(bn_zero()) == 0);
+    TEST_ASSERT("", bn_bit_length(bn_one()) == 1);
+    TEST_ASSERT("", bn_bit_length(bn_from_hex("80000000")) == 32);
+    TEST_ASSERT("", bn_bit_length(bn_from_hex("1 00000000")) == 33);
+    TEST_ASSERT("", bn_bit_length(bn_from_hex("D1380128 25378933 47238921 10457832")) == 128);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_test_bit() {
+    BigNum *n = bn_from_hex("80000001 00000000 00000002");
+    TEST_ASSERT("", !bn_test_bit(n, 0));
+    TEST_ASSERT("", bn_test_bit(n, 1));
+    TEST_ASSERT("", !bn_test_bit(n, 2));
+    TEST_ASSERT("", bn_test_bit(n, 64));
+    TEST_ASSERT("", bn_test_bit(n, 95));
+    TEST_ASSERT("bits beyond the end are 0", !bn_test_bit(n, 96));
+    TEST_ASSERT("bits beyond the end are 0", !bn_test_bit(n, 100000));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_trailing_zeros() {
+    TEST_ASSERT("0 results in 0", bn_trailing_zeros(bn_zero()) == 0);
+    TEST_ASSERT("", bn_trailing_zeros(bn_one()) == 0);
+    TEST_ASSERT("", bn_trailing_zeros(bn_from_hex("80000000")) == 31);
+    TEST_ASSERT("", bn_trailing_zeros(bn_from_hex("10 00000000 00000000")) == 68);
+    TEST_ASSERT("", bn_trailing_zeros(bn_shift_left(bn_from_hex("D1380128 25378938"), 1000)) == 1003);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_gcd() {
+    BigNum *n1, *n2, *got_result, *should_result;
+
+    n1 = bn_from_hex("19857A65 810D1F3B 8D5AA00E E942B982 D0D0D73E");
+    n2 = bn_from_hex("1CBE3987 E1BAAA01 9B8F542F 762D0FAC E5C6AFB6 3AE00265");
+    should_result = bn_from_hex("1F3A5C77");
+    got_result = bn_gcd(n1, n2);
+    TEST_ASSERT_EQ("", got_result, should_result);
+    got_result = bn_gcd(n2, n1);
+    TEST_ASSERT_EQ("commutative", got_result, should_result);
+
+    got_result = bn_gcd(n1, n1);
+    TEST_ASSERT_EQ("gcd(n, n) = n", got_result, n1);
+    got_result = bn_gcd(n1, bn_zero());
+    TEST_ASSERT_EQ("gcd(n, 0) = n", got_result, n1);
+    got_result = bn_gcd(bn_zero(), bn_zero());
+    TEST_ASSERT_EQ("gcd(0, 0) = 0", got_result, bn_zero());
+
+    n2 = bn_multiply(n1, bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF"));
+    got_result = bn_gcd(n2, n1);
+    TEST_ASSERT_EQ("divisor", got_result, n1);
+
+    // Consecutive Fibonacci numbers take the most steps
+    n1 = bn_one();
+    n2 = bn_one();
+    for (int i = 0; i < 500; i++) {
+        BigNum *next = bn_add(n1, n2);
+        n1 = n2;
+        n2 = next;
+    }
+    got_result = bn_gcd(n2, n1);
+    TEST_ASSERT_EQ("fibonacci numbers", got_result, bn_one());
+
+    n1 = bn_from_hex("19857A65 810D1F3B 8D5AA00E E942B982 D0D0D73E");
+    n2 = bn_from_hex("1CBE3987 E1BAAA01 9B8F542F 762D0FAC E5C6AFB6 3AE00265");
+    TEST_ASSERT("into returns dst", bn_gcd_into(n1, n1, n2) == n1);
+    TEST_ASSERT_EQ("dst may alias n1", n1, should_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_gcdext() {
+    BigNum *n1, *n2, *x, *y, *gcd;
+
+    n1 = bn_from_hex("19857A65 810D1F3B 8D5AA00E E942B982 D0D0D73E");
+    n2 = bn_from_hex("1CBE3987 E1BAAA01 9B8F542F 762D0FAC E5C6AFB6 3AE00265");
+    x = bn_zero();
+    y = bn_zero();
+    gcd = bn_gcdext(n1, n2, x, y);
+    TEST_ASSERT_EQ("", gcd, bn_from_hex("1F3A5C77"));
+    TEST_ASSERT_EQ("", x, bn_from_hex("57EABDB3 F8129A02 09D18B91 5104631B 0A725209"));
+    TEST_ASSERT_EQ("", y, bn_from_hex("8327EE7A 94F31462 66799385 921CF147"));
+
+    gcd = bn_gcdext(n2, n1, x, y);
+    TEST_ASSERT_EQ("swapped", x, bn_from_hex("8327EE7A 94F31462 66799385 921CF147"));
+    TEST_ASSERT_EQ("swapped", y, bn_from_hex("57EABDB3 F8129A02 09D18B91 5104631B 0A725209"));
+
+    n2 = bn_multiply(n1, bn_from_uint32_t(3));
+    gcd = bn_gcdext(n2, n1, x, y);
+    TEST_ASSERT_EQ("divisor", gcd, n1);
+    TEST_ASSERT_EQ("divisor", x, bn_zero());
+    TEST_ASSERT_EQ("divisor", y, bn_one());
+
+    gcd = bn_gcdext(n1, bn_zero(), x, y);
+    TEST_ASSERT_EQ("gcd(n, 0) = n", gcd, n1);
+    TEST_ASSERT_EQ("gcd(n, 0) = 1 * n", x, bn_one());
+    TEST_ASSERT_EQ("gcd(n, 0) = 1 * n", y, bn_zero());
+    gcd = bn_gcdext(bn_zero(), n1, x, y);
+    TEST_ASSERT_EQ("gcd(0, n) = n", gcd, n1);
+    TEST_ASSERT_EQ("gcd(0, n) = 1 * n", x, bn_zero());
+    TEST_ASSERT_EQ("gcd(0, n) = 1 * n", y, bn_one());
+
+    n1 = bn_from_hex("19857A65 810D1F3B 8D5AA00E E942B982 D0D0D73E");
+    n2 = bn_from_hex("1CBE3987 E1BAAA01 9B8F542F 762D0FAC E5C6AFB6 3AE00265");
+    gcd = bn_gcdext(n1, n2, n1, n2);
+    TEST_ASSERT_EQ("cofactors may alias the operands", n1, bn_from_hex("57EABDB3 F8129A02 09D18B91 5104631B 0A725209"));
+    TEST_ASSERT_EQ("cofactors may alias the operands", n2, bn_from_hex("8327EE7A 94F31462 66799385 921CF147"));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_modinv() {
+    BigNum *n, *mod, *got_result, *should_result;
+
+    n = bn_from_hex("D1380128 25378933 47238921 10457832");
+    mod = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFC5");
+    should_result = bn_from_hex("56280502 4B3B217A 9F550961 2B20EC8C F296E69D 20105742 84C9D507 1E89CEE7");
+    got_result = bn_modinv(n, mod);
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    got_result = bn_modinv(bn_from_uint32_t(3), bn_from_hex("1 00000000 00000000 00000000 00000000"));
+    should_result = bn_from_hex("AAAAAAAA AAAAAAAA AAAAAAAA AAAAAAAB");
+    TEST_ASSERT_EQ("inverse modulo a power of two", got_result, should_result);
+
+    got_result = bn_modinv(bn_from_uint32_t(5), bn_one());
+    TEST_ASSERT_EQ("everything is 0 modulo 1", got_result, bn_zero());
+
+    TEST_ASSERT("no inverse results in null pointer", !bn_modinv(bn_from_uint32_t(6), bn_from_uint32_t(9)));
+    TEST_ASSERT("0 has no inverse", !bn_modinv(bn_zero(), bn_from_uint32_t(9)));
+    TEST_ASSERT("modulo 0 results in null pointer", !bn_modinv(n, bn_zero()));
+    TEST_ASSERT("into with no inverse results in null pointer", !bn_modinv_into(n, bn_from_uint32_t(6), bn_from_uint32_t(9)));
+    TEST_ASSERT_EQ("dst is untouched", n, bn_from_hex("D1380128 25378933 47238921 10457832"));
+
+    TEST_ASSERT("into returns dst", bn_modinv_into(n, n, mod) == n);
+    should_result = bn_from_hex("56280502 4B3B217A 9F550961 2B20EC8C F296E69D 20105742 84C9D507 1E89CEE7");
+    TEST_ASSERT_EQ("dst may alias n", n, should_result);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_barrett_ctx_new() {
+    BigNum *mod, *should_result;
+    bn_BarrettCtx *ctx;
+
+    mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBA");
+    ctx = bn_barrett_ctx_new(mod);
+    TEST_ASSERT("", ctx);
+    TEST_ASSERT_EQ("copies modulus", ctx->mod, mod);
+#if BN_BLOCK_BITS == 64
+    should_result = bn_from_hex("1 393DD2BF F82FB670 A7CE7883 AB36BA0D 67E4AC57 86891F7B 9737B3B8");
+#else
+    should_result = bn_from_hex("1 393DD2BF F82FB670 A7CE7883 AB36BA0D 67E4AC57");
+#endif
+    TEST_ASSERT_EQ("B^2k / m", ctx->mu, should_result);
+    bn_barrett_ctx_destroy(&ctx);
+    TEST_ASSERT("destroy sets pointer to null", !ctx);
+
+    TEST_ASSERT("`mod` = 0 results in null pointer", !bn_barrett_ctx_new(bn_zero()));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_mod_ctx() {
+    BigNum *n, *mod, *got_result, *should_result;
+    bn_BarrettCtx *ctx;
+
+    mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBA");
+    ctx = bn_barrett_ctx_new(mod);
+
+    n = bn_from_hex("FEDCBA98 76543210 F0E1D2C3 B4A59687 78695A4B 3C2D1E0F 01234567 89ABCDEF");
+    got_result = bn_mod_ctx(n, ctx);
+    TEST_ASSERT_EQ("", got_result, bn_mod(n, mod));
+    TEST_ASSERT_EQ("less than the modulus", bn_mod_ctx(bn_from_uint32_t(12345), ctx), bn_from_uint32_t(12345));
+    TEST_ASSERT_EQ("modulus", bn_mod_ctx(mod, ctx), bn_zero());
+
+    // More than twice as long as the modulus, reduced in several steps
+    n = bn_with_len(23);
+    for (size_t i = 0; i < n->len; i++) {
+        bn_write_block(n, i, BN_BLOCK_MAX - i * 40503u);
+    }
+    should_result = bn_mod(n, mod);
+    got_result = bn_mod_ctx(n, ctx);
+    TEST_ASSERT_EQ("long number", got_result, should_result);
+    bn_mod_ctx_into(n, n, ctx);
+    TEST_ASSERT_EQ("dst aliases n", n, should_result);
+    bn_barrett_ctx_destroy(&ctx);
+
+    // Powers of B, for which B^2k / m has an additional block
+    mod = bn_from_hex("1 00000000");
+    ctx = bn_barrett_ctx_new(mod);
+    n = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF");
+    TEST_ASSERT_EQ("power of B", bn_mod_ctx(n, ctx), bn_mod(n, mod));
+    bn_barrett_ctx_destroy(&ctx);
+    ctx = bn_barrett_ctx_new(bn_one());
+    TEST_ASSERT_EQ("modulus 1", bn_mod_ctx(n, ctx), bn_zero());
+    bn_barrett_ctx_destroy(&ctx);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_mulmod_ctx() {
+    BigNum *n1, *n2, *mod, *got_result, *should_result;
+    bn_BarrettCtx *ctx;
+
+    mod = bn_from_hex("10000000 00000000 00000000");
+    ctx = bn_barrett_ctx_new(mod);
+    n1 = bn_from_hex("D1380128 25378933 47238921 10457832");
+    n2 = bn_from_hex("FEDCBA98 76543210 F0E1D2C3 B4A59687 78695A4B");
+    should_result = bn_mod(bn_multiply(n1, n2), mod);
+    got_result = bn_mulmod_ctx(n1, n2, ctx);
+    TEST_ASSERT_EQ("even modulus", got_result, should_result);
+    bn_mulmod_ctx_into(n1, n1, n2, ctx);
+    TEST_ASSERT_EQ("dst aliases n1", n1, should_result);
+    TEST_ASSERT_EQ("product with 0", bn_mulmod_ctx(n2, bn_zero(), ctx), bn_zero());
+    bn_barrett_ctx_destroy(&ctx);
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_power_mod() {
+    BigNum *base, *exp, *mod, *got_result, *should_result;
+
+    base = bn_zero();
+    exp = bn_from_hex("10001");
+    mod = bn_from_hex("ABCDABCD");
     got_result = bn_power_mod(base, exp, mod);
     should_result = bn_zero();
     TEST_ASSERT_EQ("base 0 results in 0", got_result, should_result);
@@ -506,6 +2104,13 @@ static TestResult test_bn_power_mod() {
     should_result = bn_from_hex("004D4632 D1651F795 FE624A515 EE2CF5E0 095B4020");
     TEST_ASSERT_EQ("", got_result, should_result);
 
+    base = bn_from_hex("D1380128 25378933 47238921 10457832");
+    exp = bn_from_hex("FEDCBA98 76543210 F0E1D2C3 B4A59687 78695A4B 3C2D1E0F 01234567 89ABCDEF");
+    mod = bn_from_hex("CEAFFABC FAEDEADB AEBFABEF BAEBFEBA");
+    got_result = bn_power_mod(base, exp, mod);
+    should_result = bn_from_hex("2DA9D834 9A45CB75 40F8D097 075222CC");
+    TEST_ASSERT_EQ("exponent with multiple windows", got_result, should_result);
+
     base = bn_from_hex("25378933 47238921 10457832");
     exp = bn_from_hex("FE21");
     mod = bn_zero();
@@ -515,7 +2120,431 @@ static TestResult test_bn_power_mod() {
     TEST_SUCCESS();
 }
 
+static TestResult test_bn_power_mod_into() {
+    BigNum *base, *exp, *mod, *dst, *should_result;
+
+    base = bn_from_hex("D1380128 25378933 47238921 10457832");
+    exp = bn_from_hex("1001");
+    mod = bn_from_hex("CEAFFABC FAEDEADB AEBFABEF BAEBFEBA");
+    should_result = bn_from_hex("218CAD4A 31FC7FD4 2999356B 6BC523EA");
+    dst = bn_zero();
+    TEST_ASSERT("returns dst", bn_power_mod_into(dst, base, exp, mod) == dst);
+    TEST_ASSERT_EQ("", dst, should_result);
+    bn_power_mod_into(base, base, exp, mod);
+    TEST_ASSERT_EQ("dst aliases base", base, should_result);
+
+    base = bn_from_hex("25378933 47238921 10457832");
+    TEST_ASSERT("`mod` = 0 results in null pointer", !bn_power_mod_into(base, base, exp, bn_zero()));
+    TEST_ASSERT_EQ("dst is untouched on failure", base, bn_from_hex("25378933 47238921 10457832"));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_mont_ctx_new() {
+    BigNum *mod, *should_result;
+    bn_MontCtx *ctx;
+
+    mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB");
+    ctx = bn_mont_ctx_new(mod);
+    TEST_ASSERT("", ctx);
+    TEST_ASSERT_EQ("copies modulus", ctx->mod, mod);
+    TEST_ASSERT("", ctx->r_squared->len == BLOCKS_FOR_BITS(160));
+#if BN_BLOCK_BITS == 64
+    should_result = bn_from_hex("A24A493A 91B3EC5F 8C29EA82 69FE8F18 9F355BDD");
+    TEST_ASSERT_EQ("R^2 mod m", ctx->r_squared, should_result);
+    TEST_ASSERT("-m^-1 mod 2^64", ctx->mod_inv == 0x557fd128d9fe698d);
+#else
+    should_result = bn_from_hex("05ED8FB7 9B290BF3 8496C44C 54DDF0B5 8A06C92E");
+    TEST_ASSERT_EQ("R^2 mod m", ctx->r_squared, should_result);
+    TEST_ASSERT("-m^-1 mod 2^32", ctx->mod_inv == 0xd9fe698d);
+#endif
+    bn_mont_ctx_destroy(&ctx);
+    TEST_ASSERT("destroy sets pointer to null", !ctx);
+
+    mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBA");
+    TEST_ASSERT("even modulus results in null pointer", !bn_mont_ctx_new(mod));
+    TEST_ASSERT("`mod` = 0 results in null pointer", !bn_mont_ctx_new(bn_zero()));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_mont_ctx_new_ct() {
+    BigNum *mod, *should_result;
+    bn_MontCtx *ctx;
+
+    mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB");
+    ctx = bn_mont_ctx_new_ct(mod);
+    TEST_ASSERT("", ctx);
+    TEST_ASSERT_EQ("copies modulus", ctx->mod, mod);
+    TEST_ASSERT("", ctx->r_squared->len == BLOCKS_FOR_BITS(160));
+#if BN_BLOCK_BITS == 64
+    should_result = bn_from_hex("A24A493A 91B3EC5F 8C29EA82 69FE8F18 9F355BDD");
+    TEST_ASSERT_EQ("R^2 mod m", ctx->r_squared, should_result);
+    TEST_ASSERT("-m^-1 mod 2^64", ctx->mod_inv == 0x557fd128d9fe698d);
+#else
+    should_result = bn_from_hex("05ED8FB7 9B290BF3 8496C44C 54DDF0B5 8A06C92E");
+    TEST_ASSERT_EQ("R^2 mod m", ctx->r_squared, should_result);
+    TEST_ASSERT("-m^-1 mod 2^32", ctx->mod_inv == 0xd9fe698d);
+#endif
+    bn_mont_ctx_destroy(&ctx);
+
+    mod = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF 00000001");
+    ctx = bn_mont_ctx_new_ct(mod);
+    bn_MontCtx *should_ctx = bn_mont_ctx_new(mod);
+    TEST_ASSERT_EQ("same R^2 as bn_mont_ctx_new", ctx->r_squared, should_ctx->r_squared);
+    bn_mont_ctx_destroy(&ctx);
+    bn_mont_ctx_destroy(&should_ctx);
+
+    ctx = bn_mont_ctx_new_ct(bn_one());
+    TEST_ASSERT_EQ("modulus 1", bn_power_mod_ctx_ct(bn_from_uint32_t(5), bn_from_uint32_t(3), ctx), bn_zero());
+    bn_mont_ctx_destroy(&ctx);
+
+    mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBA");
+    TEST_ASSERT("even modulus results in null pointer", !bn_mont_ctx_new_ct(mod));
+    TEST_ASSERT("`mod` = 0 results in null pointer", !bn_mont_ctx_new_ct(bn_zero()));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_power_mod_ctx() {
+    BigNum *base, *exp, *got_result, *should_result;
+    bn_MontCtx *ctx;
+
+    ctx = bn_mont_ctx_new(bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB"));
+
+    base = bn_from_hex("25378933 47238921 10457832");
+    exp = bn_from_hex("FE21");
+    got_result = bn_power_mod_ctx(base, exp, ctx);
+    should_result = bn_from_hex("B7F3F508 6B522253 AF824B4C 81B4C101 708CB55A");
+    TEST_ASSERT_EQ("", got_result, should_result);
+    got_result = bn_power_mod_ctx(base, bn_zero(), ctx);
+    TEST_ASSERT_EQ("exponent 0 results in 1", got_result, bn_one());
+    got_result = bn_power_mod_ctx(bn_zero(), exp, ctx);
+    TEST_ASSERT_EQ("base 0 results in 0", got_result, bn_zero());
+
+    ctx = bn_mont_ctx_new(bn_from_hex("CEAFFABC FAEDEADB AEBFABEF BAEBFEB9"));
+    base = bn_from_hex("D1380128 25378933 47238921 10457832");
+    exp = bn_from_hex("10001");
+    should_result = bn_from_hex("8C44B5F4 CD557DD0 7A9C9F18 28F18915");
+    got_result = bn_power_mod_ctx(base, exp, ctx);
+    TEST_ASSERT_EQ("base greater than modulus", got_result, should_result);
+    TEST_ASSERT_EQ("same result as bn_power_mod", bn_power_mod(base, exp, ctx->mod), should_result);
+    bn_power_mod_ctx_into(exp, base, exp, ctx);
+    TEST_ASSERT_EQ("dst aliases exp", exp, should_result);
+
+    ctx = bn_mont_ctx_new(bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB"));
+    base = bn_from_hex("D1380128 25378933 47238921 10457832");
+    exp = bn_from_hex("FEDCBA98 76543210 F0E1D2C3 B4A59687 78695A4B 3C2D1E0F 01234567 89ABCDEF");
+    got_result = bn_power_mod_ctx(base, exp, ctx);
+    should_result = bn_from_hex("2E162203 DE3ACDC7 1D99050B 62183F0E E2677096");
+    TEST_ASSERT_EQ("exponent with multiple windows", got_result, should_result);
+
+    ctx = bn_mont_ctx_new(bn_one());
+    got_result = bn_power_mod_ctx(base, bn_zero(), ctx);
+    TEST_ASSERT_EQ("modulus 1 results in 0", got_result, bn_zero());
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_power_mod_ctx_fixed_window() {
+    BigNum *base, *exp, *got_result, *should_result;
+    bn_MontCtx *ctx;
+
+    ctx = bn_mont_ctx_new(bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB"));
+    base = bn_from_hex("D1380128 25378933 47238921 10457832");
+
+    exp = bn_from_hex("FEDCBA98 76543210 F0E1D2C3 B4A59687 78695A4B 3C2D1E0F 01234567 89ABCDEF");
+    got_result = bn_power_mod_ctx_fixed_window(base, exp, ctx);
+    should_result = bn_from_hex("2E162203 DE3ACDC7 1D99050B 62183F0E E2677096");
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    exp = bn_from_hex("10001");
+    got_result = bn_power_mod_ctx_fixed_window(base, exp, ctx);
+    should_result = bn_from_hex("42378EF8 899C7570 3110AC7C EF25FB67 72B5F80E");
+    TEST_ASSERT_EQ("windows with leading zeros", got_result, should_result);
+
+    got_result = bn_power_mod_ctx_fixed_window(base, bn_zero(), ctx);
+    TEST_ASSERT_EQ("exponent 0 results in 1", got_result, bn_one());
+    got_result = bn_power_mod_ctx_fixed_window(bn_zero(), exp, ctx);
+    TEST_ASSERT_EQ("base 0 results in 0", got_result, bn_zero());
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_power_mod_ctx_ct() {
+    BigNum *base, *exp, *got_result, *should_result;
+    bn_MontCtx *ctx;
+
+    ctx = bn_mont_ctx_new(bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB"));
+    base = bn_from_hex("D1380128 25378933 47238921 10457832");
+
+    exp = bn_from_hex("FEDCBA98 76543210 F0E1D2C3 B4A59687 78695A4B 3C2D1E0F 01234567 89ABCDEF");
+    got_result = bn_power_mod_ctx_ct(base, exp, ctx);
+    should_result = bn_from_hex("2E162203 DE3ACDC7 1D99050B 62183F0E E2677096");
+    TEST_ASSERT_EQ("exponent longer than the modulus", got_result, should_result);
+
+    exp = bn_from_hex("10001");
+    got_result = bn_power_mod_ctx_ct(base, exp, ctx);
+    should_result = bn_from_hex("42378EF8 899C7570 3110AC7C EF25FB67 72B5F80E");
+    TEST_ASSERT_EQ("exponent shorter than the modulus", got_result, should_result);
+
+    base = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF");
+    got_result = bn_power_mod_ctx_ct(base, exp, ctx);
+    TEST_ASSERT_EQ("base longer than the modulus", got_result, bn_power_mod_ctx(base, exp, ctx));
+
+    got_result = bn_power_mod_ctx_ct(base, bn_zero(), ctx);
+    TEST_ASSERT_EQ("exponent 0 results in 1", got_result, bn_one());
+    got_result = bn_power_mod_ctx_ct(bn_zero(), exp, ctx);
+    TEST_ASSERT_EQ("base 0 results in 0", got_result, bn_zero());
+
+    got_result = bn_power_mod_ctx_ct_into(exp, base, exp, ctx);
+    TEST_ASSERT("returns dst", got_result == exp);
+    TEST_ASSERT_EQ("dst aliases the exponent", exp, bn_power_mod_ctx(base, bn_from_hex("10001"), ctx));
+
+    bn_mont_ctx_destroy(&ctx);
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_power_mod_ct() {
+    BigNum *mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB");
+    BigNum *base = bn_from_hex("D1380128 25378933 47238921 10457832");
+    BigNum *exp = bn_from_hex("10001");
+
+    TEST_ASSERT_EQ("", bn_power_mod_ct(base, exp, mod), bn_from_hex("42378EF8 899C7570 3110AC7C EF25FB67 72B5F80E"));
+
+    BigNum *dst = bn_from_uint32_t(5);
+    TEST_ASSERT("even modulus results in an error", !bn_power_mod_ct(base, exp, bn_from_uint32_t(10)));
+    TEST_ASSERT("error leaves dst untouched", !bn_power_mod_ct_into(dst, base, exp, bn_zero()));
+    TEST_ASSERT_EQ("error leaves dst untouched", dst, bn_from_uint32_t(5));
+
+    TEST_ASSERT("returns dst", bn_power_mod_ct_into(mod, base, exp, mod) == mod);
+    TEST_ASSERT_EQ("dst aliases the modulus", mod, bn_from_hex("42378EF8 899C7570 3110AC7C EF25FB67 72B5F80E"));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_multi_power_mod_ctx() {
+    BigNum *bases[4], *exps[4];
+    BigNum *mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB");
+    bn_MontCtx *ctx = bn_mont_ctx_new(mod);
+
+    bases[0] = bn_from_hex("D1380128 25378933 47238921 10457832");
+    bases[1] = bn_from_uint32_t(3);
+    bases[2] = bn_from_hex("FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF");
+    bases[3] = bn_from_hex("12345678 9ABCDEF0");
+    exps[0] = bn_from_hex("FEDCBA98 76543210 F0E1D2C3 B4A59687 78695A4B 3C2D1E0F 01234567 89ABCDEF");
+    exps[1] = bn_from_hex("10001");
+    exps[2] = bn_from_uint32_t(1);
+    exps[3] = bn_zero();
+
+    BigNum *should_result = bn_one();
+    for (size_t i = 0; i < 4; i++) {
+        bn_multiply_assign(should_result, bn_power_mod(bases[i], exps[i], mod));
+        bn_mod_assign(should_result, mod);
+    }
+
+    BigNum *got_result = bn_multi_power_mod_ctx(bases, exps, 4, ctx);
+    TEST_ASSERT_EQ("", got_result, should_result);
+
+    got_result = bn_multi_power_mod_ctx(bases, exps, 1, ctx);
+    TEST_ASSERT_EQ("one base", got_result, bn_power_mod(bases[0], exps[0], mod));
+    got_result = bn_multi_power_mod_ctx(bases, exps, 0, ctx);
+    TEST_ASSERT_EQ("no bases result in 1", got_result, bn_one());
+    got_result = bn_multi_power_mod_ctx(bases + 3, exps + 3, 1, ctx);
+    TEST_ASSERT_EQ("exponent 0 results in 1", got_result, bn_one());
+
+    bases[2] = bn_zero();
+    got_result = bn_multi_power_mod_ctx(bases, exps, 4, ctx);
+    TEST_ASSERT_EQ("base 0 results in 0", got_result, bn_zero());
+
+    bn_mont_ctx_destroy(&ctx);
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_multi_power_mod() {
+    BigNum *bases[2], *exps[2];
+    bases[0] = bn_from_hex("D1380128 25378933 47238921 10457832");
+    bases[1] = bn_from_uint32_t(3);
+    exps[0] = bn_from_hex("10001");
+    exps[1] = bn_from_uint32_t(1000);
+
+    BigNum *mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB");
+    BigNum *should_result = bn_multiply(bn_power_mod(bases[0], exps[0], mod), bn_power_mod(bases[1], exps[1], mod));
+    bn_mod_assign(should_result, mod);
+    TEST_ASSERT_EQ("odd modulus", bn_multi_power_mod(bases, exps, 2, mod), should_result);
+
+    mod = bn_from_hex("10000000 00000000");
+    should_result = bn_multiply(bn_power_mod(bases[0], exps[0], mod), bn_power_mod(bases[1], exps[1], mod));
+    bn_mod_assign(should_result, mod);
+    TEST_ASSERT_EQ("even modulus", bn_multi_power_mod(bases, exps, 2, mod), should_result);
+    TEST_ASSERT_EQ("modulus 1 results in 0", bn_multi_power_mod(bases, exps, 2, bn_one()), bn_zero());
+
+    TEST_ASSERT("modulus 0 results in an error", !bn_multi_power_mod(bases, exps, 2, bn_zero()));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_fixed_base_table_new() {
+    BigNum *mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB");
+    bn_MontCtx *ctx = bn_mont_ctx_new(mod);
+    BigNum *base = bn_from_hex("D1380128 25378933 47238921 10457832");
+
+    bn_FixedBaseTable *table = bn_fixed_base_table_new(base, 256, ctx);
+    TEST_ASSERT("keeps the context", table->ctx == ctx);
+    TEST_ASSERT("digits cover the exponent bits", table->count * table->window_bits >= 256);
+    TEST_ASSERT("one power per digit", table->powers->len == table->count * mod->len);
+
+    bn_fixed_base_table_destroy(&table);
+    TEST_ASSERT("destroy sets the table to NULL", table == NULL);
+
+    table = bn_fixed_base_table_new(base, 0, ctx);
+    TEST_ASSERT("0 bits still allows exponent 0", table->count == 1);
+    bn_fixed_base_table_destroy(&table);
+
+    bn_mont_ctx_destroy(&ctx);
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_power_mod_fixed_base() {
+    BigNum *mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB");
+    bn_MontCtx *ctx = bn_mont_ctx_new(mod);
+    BigNum *base = bn_from_hex("D1380128 25378933 47238921 10457832");
+    bn_FixedBaseTable *table = bn_fixed_base_table_new(base, 256, ctx);
+    BigNum *exp, *got_result;
+
+    exp = bn_from_hex("FEDCBA98 76543210 F0E1D2C3 B4A59687 78695A4B 3C2D1E0F 01234567 89ABCDEF");
+    got_result = bn_power_mod_fixed_base(exp, table);
+    TEST_ASSERT_EQ("", got_result, bn_from_hex("2E162203 DE3ACDC7 1D99050B 62183F0E E2677096"));
+
+    exp = bn_from_hex("10001");
+    got_result = bn_power_mod_fixed_base(exp, table);
+    TEST_ASSERT_EQ("short exponent", got_result, bn_from_hex("42378EF8 899C7570 3110AC7C EF25FB67 72B5F80E"));
+
+    got_result = bn_power_mod_fixed_base(bn_zero(), table);
+    TEST_ASSERT_EQ("exponent 0 results in 1", got_result, bn_one());
+
+    got_result = bn_power_mod_fixed_base_into(exp, exp, table);
+    TEST_ASSERT("returns dst", got_result == exp);
+    TEST_ASSERT_EQ("dst aliases the exponent", exp, bn_from_hex("42378EF8 899C7570 3110AC7C EF25FB67 72B5F80E"));
+
+    exp = bn_from_hex("1 00000000 00000000 00000000 00000000 00000000 00000000 00000000 00000000");
+    TEST_ASSERT("exponent longer than the table results in an error", !bn_power_mod_fixed_base(exp, table));
+    got_result = bn_from_uint32_t(5);
+    TEST_ASSERT("error leaves dst untouched", !bn_power_mod_fixed_base_into(got_result, exp, table));
+    TEST_ASSERT_EQ("error leaves dst untouched", got_result, bn_from_uint32_t(5));
+
+    bn_fixed_base_table_destroy(&table);
+
+    table = bn_fixed_base_table_new(bn_zero(), 64, ctx);
+    TEST_ASSERT_EQ("base 0 results in 0", bn_power_mod_fixed_base(bn_from_uint32_t(7), table), bn_zero());
+    bn_fixed_base_table_destroy(&table);
+
+    bn_mont_ctx_destroy(&ctx);
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_multiply_batch() {
+    BigNum *n1[3], *n2[3], *out[3];
+
+    n1[0] = bn_from_hex("FFFFFFFF FFFFFFFF");
+    n2[0] = bn_from_hex("FFFFFFFF");
+    n1[1] = bn_from_hex("F00F0000 00000000 00000000 00000000 00001111");
+    n2[1] = bn_zero();
+    n1[2] = bn_from_hex("12345678 9ABCDEF0 12345678");
+    n2[2] = n1[2];
+    out[0] = bn_zero();
+    out[1] = n1[1];
+    out[2] = n1[2];
+
+    BigNum **got_result = bn_multiply_batch(n1, n2, out, 3);
+    TEST_ASSERT("returns out", got_result == out);
+    TEST_ASSERT_EQ("", out[0], bn_from_hex("FFFFFFFE FFFFFFFF 00000001"));
+    TEST_ASSERT_EQ("product with 0", out[1], bn_zero());
+    TEST_ASSERT_EQ("out aliases both operands", out[2],
+                   bn_from_hex("14B66DC 33F6ACDC A878D649 4490A61C 49A5A7DC 1DF4D840"));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_power_mod_ctx_batch() {
+    // More items than are processed side by side, with different exponent
+    // lengths in one group
+    BigNum *bases[11], *exps[11], *out[11];
+    BigNum *mod = bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB");
+    bn_MontCtx *ctx = bn_mont_ctx_new(mod);
+
+    for (size_t i = 0; i < 11; i++) {
+        bases[i] = bn_from_hex("D1380128 25378933 47238921 10457832");
+        for (size_t j = 0; j < i; j++) {
+            bn_multiply_assign(bases[i], bases[i]);
+        }
+        exps[i] = bn_from_uint32_t(65537 * (uint32_t)i);
+        out[i] = bn_zero();
+    }
+    exps[3] = bn_from_hex("FEDCBA98 76543210 F0E1D2C3 B4A59687 78695A4B 3C2D1E0F 01234567 89ABCDEF");
+    bases[4] = bn_zero();
+    out[5] = bases[5];
+    out[6] = exps[6];
+
+    BigNum *should_result[11];
+    for (size_t i = 0; i < 11; i++) {
+        should_result[i] = bn_power_mod(bases[i], exps[i], mod);
+    }
+
+    BigNum **got_result = bn_power_mod_ctx_batch(bases, exps, ctx, out, 11);
+    TEST_ASSERT("returns out", got_result == out);
+    TEST_ASSERT_EQ("exponent 0 results in 1", out[0], bn_one());
+    TEST_ASSERT_EQ("base larger than the modulus", out[2], should_result[2]);
+    TEST_ASSERT_EQ("longest exponent of the group", out[3], should_result[3]);
+    TEST_ASSERT_EQ("base 0 results in 0", out[4], bn_zero());
+    TEST_ASSERT_EQ("out aliases the base", out[5], should_result[5]);
+    TEST_ASSERT_EQ("out aliases the exponent", out[6], should_result[6]);
+    for (size_t i = 0; i < 11; i++) {
+        TEST_ASSERT_EQ("all items", out[i], should_result[i]);
+    }
+
+    bn_mont_ctx_destroy(&ctx);
+    TEST_SUCCESS();
+}
+
+static TestResult test_bn_power_mod_batch() {
+    BigNum *bases[2], *exps[2], *out[2];
+    bases[0] = bn_from_hex("D1380128 25378933 47238921 10457832");
+    bases[1] = bn_from_uint32_t(3);
+    exps[0] = bn_from_hex("10001");
+    exps[1] = bn_from_uint32_t(1000);
+
+    out[0] = bn_zero();
+    out[1] = bn_zero();
+    BigNum **got_result = bn_power_mod_batch(bases, exps, bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB"), out, 2);
+    TEST_ASSERT("returns out", got_result == out);
+    TEST_ASSERT_EQ("odd modulus", out[0], bn_from_hex("42378EF8 899C7570 3110AC7C EF25FB67 72B5F80E"));
+    TEST_ASSERT_EQ("odd modulus", out[1], bn_power_mod(bases[1], exps[1], bn_from_hex("D1380128 CEAFFABC FAEDEADB AEBFABEF BAEBFEBB")));
+
+    BigNum *mod = bn_from_hex("10000000 00000000");
+    bn_power_mod_batch(bases, exps, mod, out, 2);
+    TEST_ASSERT_EQ("even modulus", out[0], bn_power_mod(bases[0], exps[0], mod));
+    TEST_ASSERT_EQ("even modulus", out[1], bn_power_mod(bases[1], exps[1], mod));
+
+    TEST_ASSERT("modulus 0 results in an error", !bn_power_mod_batch(bases, exps, bn_zero(), out, 2));
+
+    TEST_SUCCESS();
+}
+
 int main(void) {
+    run_test(test_bn_reserve, "bn_reserve");
+    run_test(test_bn_shrink_to_fit, "bn_shrink_to_fit");
+    run_test(test_bn_set_allocator, "bn_set_allocator");
+    run_test(test_bn_pool_allocator, "bn_pool_allocator");
+    run_test(test_bn_arena, "bn_arena");
+    run_test(test_bn_from_hex, "bn_from_hex");
+    run_test(test_bn_to_hex, "bn_to_hex");
+    run_test(test_bn_to_bytes, "bn_to_bytes");
+    run_test(test_bn_from_bytes, "bn_from_bytes");
+    run_test(test_bn_save_file, "bn_save_file");
+    run_test(test_bn_map_file, "bn_map_file");
+    run_test(test_bn_from_decimal, "bn_from_decimal");
+    run_test(test_bn_to_decimal, "bn_to_decimal");
     run_test(test_bn_compare, "bn_compare");
     run_test(test_bn_greater_than, "bn_greater_than");
     run_test(test_bn_less_than, "bn_less_than");
@@ -523,10 +2552,63 @@ int main(void) {
     run_test(test_bn_add, "bn_add");
     run_test(test_bn_subtract, "bn_subtract");
     run_test(test_bn_multiply, "bn_multiply");
+    run_test(test_bn_addmul, "bn_addmul");
+    run_test(test_bn_submul, "bn_submul");
+    run_test(test_bn_addmul_u32, "bn_addmul_u32");
+    run_test(test_bn_accumulator_new, "bn_accumulator_new");
+    run_test(test_bn_accumulator_add, "bn_accumulator_add");
+    run_test(test_bn_accumulator_addmul_u32, "bn_accumulator_addmul_u32");
+    run_test(test_bn_accumulator_addmul, "bn_accumulator_addmul");
+    run_test(test_bn_accumulator_value_into, "bn_accumulator_value_into");
+    run_test(test_bn_set_mul_thresholds, "bn_set_mul_thresholds");
+    run_test(test_bn_set_threads, "bn_set_threads");
+    run_test(test_bn_kernels_name, "bn_kernels_name");
+    run_test(test_bn_stats_snapshot, "bn_stats_snapshot");
+    run_test(test_bn_square, "bn_square");
+    run_test(test_bn_square_into, "bn_square_into");
+    run_test(test_bn_add_into, "bn_add_into");
+    run_test(test_bn_subtract_into, "bn_subtract_into");
+    run_test(test_bn_multiply_into, "bn_multiply_into");
+    run_test(test_bn_multiply_batch, "bn_multiply_batch");
     run_test(test_bn_divide_with_remainder, "bn_divide_with_remainder");
+    run_test(test_bn_set_div_threshold, "bn_set_div_threshold");
     run_test(test_bn_divide, "bn_divide");
     run_test(test_bn_mod, "bn_mod");
+    run_test(test_bn_divide_into, "bn_divide_into");
+    run_test(test_bn_mod_into, "bn_mod_into");
+    run_test(test_bn_add_u32, "bn_add_u32");
+    run_test(test_bn_sub_u32, "bn_sub_u32");
+    run_test(test_bn_mul_u32, "bn_mul_u32");
+    run_test(test_bn_divmod_u32, "bn_divmod_u32");
+    run_test(test_bn_mod_u32, "bn_mod_u32");
+    run_test(test_bn_shift_left, "bn_shift_left");
+    run_test(test_bn_shift_right, "bn_shift_right");
+    run_test(test_bn_and, "bn_and");
+    run_test(test_bn_or, "bn_or");
+    run_test(test_bn_xor, "bn_xor");
+    run_test(test_bn_bit_length, "bn_bit_length");
+    run_test(test_bn_test_bit, "bn_test_bit");
+    run_test(test_bn_trailing_zeros, "bn_trailing_zeros");
+    run_test(test_bn_gcd, "bn_gcd");
+    run_test(test_bn_gcdext, "bn_gcdext");
+    run_test(test_bn_modinv, "bn_modinv");
+    run_test(test_bn_barrett_ctx_new, "bn_barrett_ctx_new");
+    run_test(test_bn_mod_ctx, "bn_mod_ctx");
+    run_test(test_bn_mulmod_ctx, "bn_mulmod_ctx");
     run_test(test_bn_power_mod, "bn_power_mod");
+    run_test(test_bn_power_mod_into, "bn_power_mod_into");
+    run_test(test_bn_mont_ctx_new, "bn_mont_ctx_new");
+    run_test(test_bn_mont_ctx_new_ct, "bn_mont_ctx_new_ct");
+    run_test(test_bn_power_mod_ctx, "bn_power_mod_ctx");
+    run_test(test_bn_power_mod_ctx_fixed_window, "bn_power_mod_ctx_fixed_window");
+    run_test(test_bn_power_mod_ctx_ct, "bn_power_mod_ctx_ct");
+    run_test(test_bn_power_mod_ct, "bn_power_mod_ct");
+    run_test(test_bn_multi_power_mod_ctx, "bn_multi_power_mod_ctx");
+    run_test(test_bn_multi_power_mod, "bn_multi_power_mod");
+    run_test(test_bn_fixed_base_table_new, "bn_fixed_base_table_new");
+    run_test(test_bn_power_mod_fixed_base, "bn_power_mod_fixed_base");
+    run_test(test_bn_power_mod_ctx_batch, "bn_power_mod_ctx_batch");
+    run_test(test_bn_power_mod_batch, "bn_power_mod_batch");
 
     print_test_results();
     return !(tests_successful == tests_run);
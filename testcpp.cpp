@@ -0,0 +1,254 @@
+// Runs unit tests on the C++ wrapper in bigint.hpp.
+//
+// The expected values are computed with the C functions, so that these tests
+// check the evaluation of expressions (in particular their aliasing with the
+// destination) and not the arithmetic itself, which test.c covers.
+
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+#include "bigint.hpp"
+
+using bn::BigInt;
+
+struct TestResult {
+    int success;
+    const char *file;
+    int line;
+    const char *message;
+};
+
+#define TEST_ASSERT(message, test)                                      \
+    do {                                                                \
+        if (!(test)) {                                                  \
+            TestResult result = { 0, __FILE__, __LINE__, message };     \
+            return result;                                              \
+        }                                                               \
+    } while (0)
+
+// Asserts that `statement` throws `std::domain_error`
+#define TEST_ASSERT_THROWS(message, statement)                          \
+    do {                                                                \
+        bool thrown = false;                                            \
+        try {                                                           \
+            statement;                                                  \
+        } catch (const std::domain_error &) {                           \
+            thrown = true;                                              \
+        }                                                               \
+        TEST_ASSERT(message, thrown);                                   \
+    } while (0)
+
+#define TEST_SUCCESS()                          \
+    do {                                        \
+        TestResult r = {1, NULL, 0, NULL};      \
+        return r;                               \
+    } while (0)
+
+int tests_run = 0;
+int tests_successful = 0;
+
+static void run_test(TestResult (*test)(), const char *test_name) {
+    printf("running test %s\n", test_name);
+    TestResult r = test();
+    tests_run++;
+    if (!r.success) {
+        if (r.message && *r.message) {
+            fprintf(stderr, "%s failed (assertion at %s:%d): %s\n", test_name, r.file, r.line, r.message);
+        } else {
+            fprintf(stderr, "%s failed (line %d)\n", test_name, r.line);
+        }
+    } else {
+        tests_successful++;
+    }
+}
+
+static void print_test_results() {
+    printf(
+        "\nfinished: %d test(s) -- %d successful -- %d failed\n",
+        tests_run,
+        tests_successful,
+        tests_run - tests_successful
+    );
+}
+
+// Operands that span several blocks with both block sizes
+static BigInt operand_a() {
+    return BigInt::from_hex("123456789abcdef0 fedcba9876543210 0f1e2d3c4b5a6978");
+}
+
+static BigInt operand_b() {
+    return BigInt::from_hex("fedcba98 76543210 00000001 ffffffff");
+}
+
+static BigInt operand_c() {
+    return BigInt::from_hex("1 00000000 00000000 00000000 00000000 00000003");
+}
+
+static BigInt c_add(const BigInt &n1, const BigInt &n2) {
+    return BigInt::adopt(bn_add(n1.get(), n2.get()));
+}
+
+static BigInt c_subtract(const BigInt &n1, const BigInt &n2) {
+    return BigInt::adopt(bn_subtract(n1.get(), n2.get()));
+}
+
+static BigInt c_multiply(const BigInt &n1, const BigInt &n2) {
+    return BigInt::adopt(bn_multiply(n1.get(), n2.get()));
+}
+
+static BigInt c_divide(const BigInt &n1, const BigInt &n2) {
+    return BigInt::adopt(bn_divide(n1.get(), n2.get()));
+}
+
+static TestResult test_expression() {
+    BigInt a = operand_a();
+    BigInt b = operand_b();
+    BigInt c = operand_c();
+
+    BigInt x = a * b + c;
+    TEST_ASSERT("", x == c_add(c_multiply(a, b), c));
+
+    BigInt y = c;
+    y = (a - b) * (y + a);
+    TEST_ASSERT("both operands are expressions", y == c_multiply(c_subtract(a, b), c_add(c, a)));
+
+    y = c;
+    x = (y * c) / (y + a);
+    TEST_ASSERT("division of expressions", x == c_divide(c_multiply(c, c), c_add(c, a)));
+
+    x = a;
+    TEST_ASSERT("copy", x == a && x.get() != a.get());
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_expression_aliasing() {
+    BigInt a = operand_a();
+    BigInt b = operand_b();
+    BigInt c = operand_c();
+
+    BigInt x = c;
+    x = a * b + x;
+    TEST_ASSERT("x = a * b + x", x == c_add(c_multiply(a, b), c));
+
+    x = c;
+    x = x * x + x;
+    TEST_ASSERT("x = x * x + x", x == c_add(c_multiply(c, c), c));
+
+    x = b;
+    x = a - x;
+    TEST_ASSERT("x = a - x", x == c_subtract(a, b));
+
+    x = b;
+    x = a - (x + c);
+    TEST_ASSERT("x = a - (x + c)", x == c_subtract(a, c_add(b, c)));
+
+    x = c;
+    x = (x * c) / (x + a);
+    TEST_ASSERT("x = (x * c) / (x + a)", x == c_divide(c_multiply(c, c), c_add(c, a)));
+
+    x = c;
+    x = x;
+    TEST_ASSERT("self assignment", x == operand_c());
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_compound_assignment() {
+    BigInt a = operand_a();
+    BigInt b = operand_b();
+    BigInt c = operand_c();
+
+    BigInt x = c;
+    x += x * x;
+    TEST_ASSERT("x += x * x", x == c_add(c, c_multiply(c, c)));
+
+    x = c;
+    x -= x;
+    TEST_ASSERT("x -= x", x == BigInt());
+
+    x = c;
+    x *= a + b;
+    TEST_ASSERT("x *= a + b", x == c_multiply(c, c_add(a, b)));
+
+    x = c;
+    x /= b;
+    TEST_ASSERT("x /= b", x == c_divide(c, b));
+
+    x = c;
+    x %= b;
+    TEST_ASSERT("x %= b", x == BigInt::adopt(bn_mod(c.get(), b.get())));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_moved_from() {
+    BigInt a = operand_a();
+    BigInt b = operand_b();
+
+    BigInt x = a;
+    BigInt moved = std::move(x);
+    TEST_ASSERT("moved", moved == a);
+    x = a + b;
+    TEST_ASSERT("expression", x == c_add(a, b));
+
+    BigInt y = a;
+    moved = std::move(y);
+    y = b;
+    TEST_ASSERT("copy", y == b);
+
+    BigInt z = a;
+    moved = std::move(z);
+    z = a * b - b;
+    TEST_ASSERT("expression in a temporary", z == c_subtract(c_multiply(a, b), b));
+
+    TEST_SUCCESS();
+}
+
+static TestResult test_domain_error() {
+    BigInt a = operand_a();
+    BigInt b = operand_b();
+    BigInt c = operand_c();
+    BigInt zero;
+
+    // The destination keeps its value, also if a part of the expression has
+    // already been evaluated
+    BigInt y = c;
+    TEST_ASSERT_THROWS("negative difference", y = b - a);
+    TEST_ASSERT("negative difference keeps y", y == c);
+    TEST_ASSERT_THROWS("division by 0", y = (a + b) / zero);
+    TEST_ASSERT("division by 0 keeps y", y == c);
+    TEST_ASSERT_THROWS("modulo by 0", y = (a + b) % zero);
+    TEST_ASSERT("modulo by 0 keeps y", y == c);
+    TEST_ASSERT_THROWS("negative difference of products", y = b * b - a * b);
+    TEST_ASSERT("negative difference of products keeps y", y == c);
+    TEST_ASSERT_THROWS("nested", y = a + (b * b - a * b));
+    TEST_ASSERT("nested keeps y", y == c);
+    TEST_ASSERT_THROWS("aliased", y = (y + b) / (y - y));
+    TEST_ASSERT("aliased keeps y", y == c);
+
+    TEST_ASSERT_THROWS("compound subtraction", y -= a);
+    TEST_ASSERT("compound subtraction keeps y", y == c);
+    TEST_ASSERT_THROWS("compound subtraction of expression", y -= a * b);
+    TEST_ASSERT("compound subtraction of expression keeps y", y == c);
+    TEST_ASSERT_THROWS("compound division", y /= zero);
+    TEST_ASSERT("compound division keeps y", y == c);
+    TEST_ASSERT_THROWS("compound modulo", y %= a - a);
+    TEST_ASSERT("compound modulo keeps y", y == c);
+
+    TEST_ASSERT_THROWS("construction", BigInt z = b - a);
+    TEST_ASSERT_THROWS("power_mod", bn::power_mod(a, b, zero));
+
+    TEST_SUCCESS();
+}
+
+int main() {
+    run_test(test_expression, "expression");
+    run_test(test_expression_aliasing, "expression_aliasing");
+    run_test(test_compound_assignment, "compound_assignment");
+    run_test(test_moved_from, "moved_from");
+    run_test(test_domain_error, "domain_error");
+
+    print_test_results();
+    return !(tests_successful == tests_run);
+}